@@ -0,0 +1,556 @@
+// FftwBenchmark.cpp
+//
+// Standalone native benchmark of the FFT problems FftwInterop plans (in place, forward, 1d complex), used to
+// pick SamplesPerScan and the FFTW settings for a deployment. Plans go through the same Planner as the
+// scanner, so threading behaves the same. Every combination of
+//
+//   size       powers of two, 2^a 3^b 5^c sizes and primes in [--min, --max]
+//   precision  double (fftw_) and single (fftwf_)
+//   flags      FFTW_ESTIMATE, FFTW_MEASURE, FFTW_PATIENT
+//   alignment  fftw_malloc'd buffers, and buffers offset by one real sample planned with FFTW_UNALIGNED
+//   threads    1 and --threads
+//
+// is planned from scratch (wisdom is forgotten first) and executed for at least --min-time seconds. The
+// results are written as JSON (default) or CSV, one record per combination, to stdout or --out.
+//
+// Example: FftwBenchmark.exe --sizes pow2,smooth --max 65536 --flags measure --format csv --out fftw.csv
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "fftw3.h"
+#include "FftwPlanner.h"
+
+using namespace FftwInterop;
+
+namespace {
+
+    typedef std::chrono::steady_clock Clock;
+
+    // Precision specific parts of the FFTW API, everything else is shared by RunCase
+    struct DoublePrecision
+    {
+        typedef double Real;
+        typedef fftw_complex Complex;
+        typedef fftw_plan Plan;
+
+        static const char* Name() { return "double"; }
+        static void* Malloc(size_t bytes) { return fftw_malloc(bytes); }
+        static void Free(void* p) { fftw_free(p); }
+        static void ForgetWisdom() { fftw_forget_wisdom(); }
+        static void Execute(Plan plan, Complex* data) { fftw_execute_dft(plan, data, data); }
+    };
+
+    struct SinglePrecision
+    {
+        typedef float Real;
+        typedef fftwf_complex Complex;
+        typedef fftwf_plan Plan;
+
+        static const char* Name() { return "single"; }
+        // Only libfftw3-3 is linked, the fftwf_ functions come from the Planner (see FftwPlanner.h)
+        static void* Malloc(size_t bytes) { return fftw_malloc(bytes); }
+        static void Free(void* p) { fftw_free(p); }
+        static void ForgetWisdom() { Planner::ForgetWisdomF(); }
+        static void Execute(Plan plan, Complex* data) { Planner::ExecuteDftF(plan, data, data); }
+    };
+
+    struct Options
+    {
+        Options()
+            : minSize(64), maxSize(262144), powersOfTwo(true), smooth(true), primes(true), doublePrecision(true),
+              singlePrecision(true), aligned(true), unaligned(true),
+              threads(static_cast<int>(std::thread::hardware_concurrency())), minTime(0.2), csv(false)
+        {
+            flags.push_back(FFTW_ESTIMATE);
+            flags.push_back(FFTW_MEASURE);
+        }
+
+        int minSize;
+        int maxSize;
+        bool powersOfTwo;
+        bool smooth;
+        bool primes;
+        bool doublePrecision;
+        bool singlePrecision;
+        std::vector<unsigned> flags;
+        bool aligned;
+        bool unaligned;
+        int threads;
+        double minTime;
+        bool csv;
+        std::string outputPath;
+    };
+
+    struct Result
+    {
+        int size;
+        const char* kind;
+        const char* precision;
+        unsigned flags;
+        bool aligned;
+        int threads;
+        bool planned;
+        double planSeconds;
+        long long iterations;
+        double nanosecondsPerTransform;
+        double mflops;
+    };
+
+    const char* FlagsName(unsigned flags)
+    {
+        switch (flags)
+        {
+            case FFTW_ESTIMATE: return "estimate";
+            case FFTW_MEASURE: return "measure";
+            case FFTW_PATIENT: return "patient";
+            case FFTW_EXHAUSTIVE: return "exhaustive";
+            default: return "other";
+        }
+    }
+
+    bool IsPrime(int n)
+    {
+        if (n < 2)
+        {
+            return false;
+        }
+
+        for (int d = 2; static_cast<long long>(d) * d <= n; d++)
+        {
+            if (n % d == 0)
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    bool IsPowerOfTwo(int n)
+    {
+        return n > 0 && (n & (n - 1)) == 0;
+    }
+
+    struct Size
+    {
+        int size;
+        const char* kind;
+    };
+
+    // Powers of two, the other 2^a 3^b 5^c sizes (what FFTW does best after powers of two) and the largest
+    // prime below each power of two (the worst case, Rader / Bluestein)
+    std::vector<Size> SelectSizes(const Options& options)
+    {
+        std::vector<Size> sizes;
+
+        for (long long n = 1; n <= options.maxSize; n *= 2)
+        {
+            if (n >= options.minSize)
+            {
+                if (options.powersOfTwo)
+                {
+                    sizes.push_back({ static_cast<int>(n), "pow2" });
+                }
+
+                if (options.primes)
+                {
+                    int p = static_cast<int>(n) - 1;
+                    while (p >= options.minSize && !IsPrime(p))
+                    {
+                        p--;
+                    }
+
+                    if (p >= options.minSize)
+                    {
+                        sizes.push_back({ p, "prime" });
+                    }
+                }
+            }
+        }
+
+        if (options.smooth)
+        {
+            for (long long a = 1; a <= options.maxSize; a *= 2)
+            {
+                for (long long b = a; b <= options.maxSize; b *= 3)
+                {
+                    for (long long c = b; c <= options.maxSize; c *= 5)
+                    {
+                        int n = static_cast<int>(c);
+                        if (n >= options.minSize && !IsPowerOfTwo(n))
+                        {
+                            sizes.push_back({ n, "smooth" });
+                        }
+                    }
+                }
+            }
+        }
+
+        std::sort(sizes.begin(), sizes.end(), [](const Size& x, const Size& y) { return x.size < y.size; });
+
+        return sizes;
+    }
+
+    template <typename P>
+    double TimeLoop(typename P::Plan plan, typename P::Complex* data, const typename P::Complex* input, int n, long long iterations)
+    {
+        Clock::time_point start = Clock::now();
+
+        for (long long i = 0; i < iterations; i++)
+        {
+            // In place transforms grow the data every pass, start every pass from the same input so the
+            // values never reach inf / NaN. TimeTransforms subtracts the time of the copies.
+            memcpy(data, input, sizeof(typename P::Complex) * n);
+
+            if (plan != NULL)
+            {
+                P::Execute(plan, data);
+            }
+        }
+
+        return std::chrono::duration<double>(Clock::now() - start).count();
+    }
+
+    // Seconds per transform, copy of the input excluded, and the number of transforms that were timed
+    template <typename P>
+    double TimeTransforms(typename P::Plan plan, typename P::Complex* data, const typename P::Complex* input, int n, double minTime, long long* iterations)
+    {
+        long long count = 1;
+        double elapsed = TimeLoop<P>(plan, data, input, n, count);
+
+        while (elapsed < minTime)
+        {
+            count *= 2;
+            elapsed = TimeLoop<P>(plan, data, input, n, count);
+        }
+
+        double copies = TimeLoop<P>(NULL, data, input, n, count);
+
+        *iterations = count;
+        return std::max(elapsed - copies, 0.0) / count;
+    }
+
+    template <typename P>
+    Result RunCase(const Size& size, unsigned flags, bool aligned, int threads, const Options& options)
+    {
+        typedef typename P::Complex Complex;
+        typedef typename P::Real Real;
+
+        int n = size.size;
+
+        Result result = {};
+        result.size = n;
+        result.kind = size.kind;
+        result.precision = P::Name();
+        result.flags = flags;
+        result.aligned = aligned;
+        result.threads = threads;
+
+        // One spare complex sample, so the unaligned buffer can start one real sample in
+        void* block = P::Malloc(sizeof(Complex) * (n + 1));
+        Complex* input = static_cast<Complex*>(P::Malloc(sizeof(Complex) * n));
+        if (block == NULL || input == NULL)
+        {
+            P::Free(block);
+            P::Free(input);
+            return result;
+        }
+
+        Complex* data = aligned ? static_cast<Complex*>(block) : reinterpret_cast<Complex*>(static_cast<Real*>(block) + 1);
+        unsigned planFlags = aligned ? flags : flags | FFTW_UNALIGNED;
+
+        // Threads apply to every size here, Planner::EnableThreads(count, 0)
+        Planner::EnableThreads(threads, 0);
+        P::ForgetWisdom();
+
+        Clock::time_point start = Clock::now();
+        typename P::Plan plan = Planner::PlanDft1d(n, data, data, FFTW_FORWARD, planFlags);
+        result.planSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+        if (plan != NULL)
+        {
+            std::mt19937 random(n);
+            std::uniform_real_distribution<Real> uniform(-1, 1);
+            for (int i = 0; i < n; i++)
+            {
+                input[i][0] = uniform(random);
+                input[i][1] = uniform(random);
+            }
+
+            double seconds = TimeTransforms<P>(plan, data, input, n, options.minTime, &result.iterations);
+
+            result.planned = true;
+            result.nanosecondsPerTransform = seconds * 1e9;
+
+            // FFTW's convention (see its benchFFT), 5 N log2 N flops for a complex transform of any size
+            result.mflops = seconds > 0 ? (5.0 * n * log2(static_cast<double>(n))) / (seconds * 1e6) : 0;
+
+            Planner::DestroyPlan(plan);
+        }
+
+        P::Free(block);
+        P::Free(input);
+
+        return result;
+    }
+
+    template <typename P>
+    void RunPrecision(const std::vector<Size>& sizes, const std::vector<int>& threadCounts, const Options& options, std::vector<Result>* results)
+    {
+        for (const Size& size : sizes)
+        {
+            for (unsigned flags : options.flags)
+            {
+                for (int threads : threadCounts)
+                {
+                    for (int a = 0; a < 2; a++)
+                    {
+                        bool aligned = a == 0;
+                        if ((aligned && !options.aligned) || (!aligned && !options.unaligned))
+                        {
+                            continue;
+                        }
+
+                        results->push_back(RunCase<P>(size, flags, aligned, threads, options));
+
+                        const Result& r = results->back();
+                        fprintf(stderr, "%s %8d %-6s %-8s %-9s %2d threads  plan %9.3f ms  %12.1f ns  %8.0f MFLOPS\n",
+                            r.precision, r.size, r.kind, FlagsName(r.flags), r.aligned ? "aligned" : "unaligned", r.threads,
+                            r.planSeconds * 1e3, r.nanosecondsPerTransform, r.mflops);
+                    }
+                }
+            }
+        }
+    }
+
+    void WriteCsv(FILE* out, const std::vector<Result>& results)
+    {
+        fprintf(out, "size,kind,precision,flags,aligned,threads,planned,plan_ms,iterations,ns_per_transform,mflops\n");
+
+        for (const Result& r : results)
+        {
+            fprintf(out, "%d,%s,%s,%s,%d,%d,%d,%.6f,%lld,%.3f,%.1f\n",
+                r.size, r.kind, r.precision, FlagsName(r.flags), r.aligned ? 1 : 0, r.threads, r.planned ? 1 : 0,
+                r.planSeconds * 1e3, r.iterations, r.nanosecondsPerTransform, r.mflops);
+        }
+    }
+
+    void WriteJson(FILE* out, const std::vector<Result>& results, const Options& options)
+    {
+        fprintf(out, "{\n  \"minTime\": %g,\n  \"results\": [\n", options.minTime);
+
+        for (size_t i = 0; i < results.size(); i++)
+        {
+            const Result& r = results[i];
+
+            fprintf(out, "    { \"size\": %d, \"kind\": \"%s\", \"precision\": \"%s\", \"flags\": \"%s\", \"aligned\": %s, \"threads\": %d, "
+                "\"planned\": %s, \"planMs\": %.6f, \"iterations\": %lld, \"nsPerTransform\": %.3f, \"mflops\": %.1f }%s\n",
+                r.size, r.kind, r.precision, FlagsName(r.flags), r.aligned ? "true" : "false", r.threads,
+                r.planned ? "true" : "false", r.planSeconds * 1e3, r.iterations, r.nanosecondsPerTransform, r.mflops,
+                i + 1 < results.size() ? "," : "");
+        }
+
+        fprintf(out, "  ]\n}\n");
+    }
+
+    std::vector<std::string> Split(const std::string& list)
+    {
+        std::vector<std::string> items;
+        std::stringstream stream(list);
+        std::string item;
+
+        while (std::getline(stream, item, ','))
+        {
+            items.push_back(item);
+        }
+
+        return items;
+    }
+
+    void Usage()
+    {
+        fprintf(stderr,
+            "Usage: FftwBenchmark [options]\n"
+            "  --sizes pow2,smooth,prime     size families (default all)\n"
+            "  --min N, --max N              size range (default 64 to 262144)\n"
+            "  --precision double,single     (default both)\n"
+            "  --flags estimate,measure,patient\n"
+            "                                planner flags (default estimate,measure, patient can take minutes per size)\n"
+            "  --alignment aligned,unaligned (default both)\n"
+            "  --threads N                   thread count compared with 1 thread (default one per processor, 1 = no comparison)\n"
+            "  --min-time S                  seconds of transforms per result (default 0.2)\n"
+            "  --format json|csv             (default json)\n"
+            "  --out FILE                    write the results to FILE instead of stdout\n");
+    }
+
+    bool ParseArguments(int argc, char* argv[], Options* options)
+    {
+        for (int i = 1; i < argc; i++)
+        {
+            std::string name = argv[i];
+            if (i + 1 >= argc)
+            {
+                return false;
+            }
+
+            std::string value = argv[++i];
+
+            if (name == "--sizes")
+            {
+                options->powersOfTwo = options->smooth = options->primes = false;
+                for (const std::string& s : Split(value))
+                {
+                    if (s == "pow2") options->powersOfTwo = true;
+                    else if (s == "smooth") options->smooth = true;
+                    else if (s == "prime") options->primes = true;
+                    else return false;
+                }
+            }
+            else if (name == "--min")
+            {
+                options->minSize = atoi(value.c_str());
+            }
+            else if (name == "--max")
+            {
+                options->maxSize = atoi(value.c_str());
+            }
+            else if (name == "--precision")
+            {
+                options->doublePrecision = options->singlePrecision = false;
+                for (const std::string& s : Split(value))
+                {
+                    if (s == "double") options->doublePrecision = true;
+                    else if (s == "single") options->singlePrecision = true;
+                    else return false;
+                }
+            }
+            else if (name == "--flags")
+            {
+                options->flags.clear();
+                for (const std::string& s : Split(value))
+                {
+                    if (s == "estimate") options->flags.push_back(FFTW_ESTIMATE);
+                    else if (s == "measure") options->flags.push_back(FFTW_MEASURE);
+                    else if (s == "patient") options->flags.push_back(FFTW_PATIENT);
+                    else return false;
+                }
+            }
+            else if (name == "--alignment")
+            {
+                options->aligned = options->unaligned = false;
+                for (const std::string& s : Split(value))
+                {
+                    if (s == "aligned") options->aligned = true;
+                    else if (s == "unaligned") options->unaligned = true;
+                    else return false;
+                }
+            }
+            else if (name == "--threads")
+            {
+                options->threads = atoi(value.c_str());
+            }
+            else if (name == "--min-time")
+            {
+                options->minTime = atof(value.c_str());
+            }
+            else if (name == "--format")
+            {
+                if (value != "json" && value != "csv")
+                {
+                    return false;
+                }
+
+                options->csv = value == "csv";
+            }
+            else if (name == "--out")
+            {
+                options->outputPath = value;
+            }
+            else
+            {
+                return false;
+            }
+        }
+
+        return options->minSize >= 1 && options->maxSize >= options->minSize && options->minTime >= 0;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    Options options;
+    if (!ParseArguments(argc, argv, &options))
+    {
+        Usage();
+        return 1;
+    }
+
+    std::vector<int> threadCounts = { 1 };
+    if (options.threads > 1)
+    {
+        if (Planner::EnableThreads(options.threads, 0))
+        {
+            threadCounts.push_back(options.threads);
+        }
+        else
+        {
+            fprintf(stderr, "FFTW could not start its threads, only timing single threaded plans\n");
+        }
+    }
+
+    std::vector<Size> sizes = SelectSizes(options);
+    std::vector<Result> results;
+
+    if (options.doublePrecision)
+    {
+        RunPrecision<DoublePrecision>(sizes, threadCounts, options, &results);
+    }
+
+    if (options.singlePrecision)
+    {
+        if (Planner::SinglePrecisionAvailable())
+        {
+            RunPrecision<SinglePrecision>(sizes, threadCounts, options, &results);
+        }
+        else
+        {
+            fprintf(stderr, "libfftw3f-3.dll could not be loaded, skipping single precision\n");
+        }
+    }
+
+    FILE* out = stdout;
+    if (!options.outputPath.empty())
+    {
+        out = fopen(options.outputPath.c_str(), "w");
+        if (out == NULL)
+        {
+            fprintf(stderr, "Unable to open %s\n", options.outputPath.c_str());
+            return 1;
+        }
+    }
+
+    if (options.csv)
+    {
+        WriteCsv(out, results);
+    }
+    else
+    {
+        WriteJson(out, results, options);
+    }
+
+    if (out != stdout)
+    {
+        fclose(out);
+    }
+
+    return 0;
+}
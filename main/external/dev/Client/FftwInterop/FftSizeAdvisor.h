@@ -0,0 +1,129 @@
+// FftSizeAdvisor.h
+
+#pragma once
+
+#include <cmath>
+#include "fftw3.h"
+#include "FftSizes.h"
+#include "FftwInterop.h"
+#include "ISampleBuffer.h"
+
+using namespace System;
+
+namespace FftwInterop {
+
+    // What FftSizeAdvisor found for one requested FFT size
+    public value class FftSizeAdvice
+    {
+        public:
+            // The size that was asked for
+            int RequestedSize;
+
+            // The fast size (only factors 2, 3, 5 and 7) nearest to RequestedSize, RequestedSize if it is fast
+            int Size;
+
+            // Measured nanoseconds per transform of RequestedSize and of Size, 0 if the requested size is fast
+            // and nothing had to be measured
+            double RequestedNanoseconds;
+            double Nanoseconds;
+
+            // How much slower RequestedSize is than Size per N log2 N (i.e. per unit of FFT work), 1 if the
+            // requested size is fast
+            double SlowdownFactor;
+
+            property bool IsFast
+            {
+                bool get() { return RequestedSize == Size; }
+            }
+
+            // True if the requested size is slow enough that it should not be used
+            property bool IsSlow
+            {
+                bool get() { return SlowdownFactor >= FftSizeAdvice::SlowFactor; }
+            }
+
+            literal double SlowFactor = 2.0;
+
+            virtual String^ ToString() override
+            {
+                return String::Format("Requested: {0} ({1:F0} ns), Nearest fast: {2} ({3:F0} ns), Slowdown: {4:F1}x", RequestedSize, RequestedNanoseconds, Size, Nanoseconds, SlowdownFactor);
+            }
+    };
+
+    // Points configurations away from FFT sizes FFTW is slow at.
+    //
+    // Any size FFTW has codelets for (2^a 3^b 5^c 7^d) is accepted as is. For any other size the nearest fast
+    // size is found and both are measured with the planner flags Fftw uses. The timing plans are released right
+    // after, but planning the size that is then configured is still cheap: FFTW keeps the wisdom it gathered while
+    // measuring for the rest of the process.
+    public ref class FftSizeAdvisor abstract sealed
+    {
+        private:
+            // Transforms are timed for at least this long per size
+            literal double MinimumTimingSeconds = 0.01;
+
+            static double WorkPerTransform(int n)
+            {
+                return n < 2 ? 1.0 : n * log2(static_cast<double>(n));
+            }
+
+        public:
+            static bool IsFastSize(int size)
+            {
+                return Sizes::IsFastSize(size);
+            }
+
+            static int NearestFastSize(int size)
+            {
+                return Sizes::NearestFastSize(size);
+            }
+
+            // The size that gives resolutionBandwidthHz bins at sampleRateHz, snapped to a fast size
+            static FftSizeAdvice Advise(double resolutionBandwidthHz, double sampleRateHz, SamplePrecision precision)
+            {
+                if (resolutionBandwidthHz <= 0 || sampleRateHz < resolutionBandwidthHz)
+                {
+                    throw gcnew ArgumentOutOfRangeException("resolutionBandwidthHz");
+                }
+
+                return Advise(static_cast<int>(Math::Round(sampleRateHz / resolutionBandwidthHz)), precision);
+            }
+
+            static FftSizeAdvice Advise(int requestedSize, SamplePrecision precision)
+            {
+                if (requestedSize < 1)
+                {
+                    throw gcnew ArgumentOutOfRangeException("requestedSize");
+                }
+
+                FftSizeAdvice advice;
+                advice.RequestedSize = requestedSize;
+                advice.Size = Sizes::NearestFastSize(requestedSize);
+                advice.SlowdownFactor = 1.0;
+
+                if (advice.IsFast)
+                {
+                    return advice;
+                }
+
+                bool single = precision == SamplePrecision::Single;
+
+                double requestedSeconds = Sizes::SecondsPerTransform(requestedSize, single, Fftw::PlanFlags, MinimumTimingSeconds);
+                double seconds = Sizes::SecondsPerTransform(advice.Size, single, Fftw::PlanFlags, MinimumTimingSeconds);
+                if (requestedSeconds < 0 || seconds < 0)
+                {
+                    throw gcnew InvalidOperationException(String::Format("FFTW was unable to plan {0} or {1} samples", requestedSize, advice.Size));
+                }
+
+                advice.RequestedNanoseconds = requestedSeconds * 1e9;
+                advice.Nanoseconds = seconds * 1e9;
+
+                if (seconds > 0)
+                {
+                    advice.SlowdownFactor = (requestedSeconds / WorkPerTransform(requestedSize)) / (seconds / WorkPerTransform(advice.Size));
+                }
+
+                return advice;
+            }
+    };
+}
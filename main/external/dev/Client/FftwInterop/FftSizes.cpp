@@ -0,0 +1,112 @@
+// FftSizes.cpp
+
+#include <chrono>
+#include <climits>
+#include <cstring>
+#include "fftw3.h"
+#include "FftSizes.h"
+#include "FftwPlanner.h"
+
+namespace FftwInterop { namespace Sizes {
+
+    typedef std::chrono::steady_clock Clock;
+
+    bool IsFastSize(int n)
+    {
+        if (n < 1)
+        {
+            return false;
+        }
+
+        static const int factors[] = { 2, 3, 5, 7 };
+
+        for (int p : factors)
+        {
+            while (n % p == 0)
+            {
+                n /= p;
+            }
+        }
+
+        return n == 1;
+    }
+
+    int NearestFastSize(int n)
+    {
+        if (n <= 1)
+        {
+            return 1;
+        }
+
+        // 7-smooth numbers are dense (there is one within a few percent of any n), so this stays short
+        for (int distance = 0; distance < n; distance++)
+        {
+            if (n <= INT_MAX - distance && IsFastSize(n + distance))
+            {
+                return n + distance;
+            }
+
+            if (IsFastSize(n - distance))
+            {
+                return n - distance;
+            }
+        }
+
+        return 1;
+    }
+
+    template <typename C, typename P>
+    static double TimeTransforms(P plan, C* data, void (*execute)(P, C*, C*), double minimumSeconds)
+    {
+        long long count = 0;
+        Clock::time_point start = Clock::now();
+        double elapsed = 0;
+
+        // FFTW's run time does not depend on the data, all zeros stays all zeros however often it is transformed
+        do
+        {
+            execute(plan, data, data);
+            count++;
+            elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+        }
+        while (elapsed < minimumSeconds || count < 3);
+
+        return elapsed / count;
+    }
+
+    double SecondsPerTransform(int n, bool singlePrecision, unsigned flags, double minimumSeconds)
+    {
+        double seconds = -1;
+
+        if (singlePrecision)
+        {
+            fftwf_plan plan = Planner::AcquirePlanF(n, FFTW_FORWARD, flags);
+            fftwf_complex* data = static_cast<fftwf_complex*>(fftw_malloc(sizeof(fftwf_complex) * n));
+
+            if (plan != NULL && data != NULL)
+            {
+                memset(data, 0, sizeof(fftwf_complex) * n);
+                seconds = TimeTransforms(plan, data, Planner::ExecuteDftF, minimumSeconds);
+            }
+
+            fftw_free(data);
+            Planner::ReleasePlan(plan);
+        }
+        else
+        {
+            fftw_plan plan = Planner::AcquirePlan(n, 1, FFTW_FORWARD, flags);
+            fftw_complex* data = static_cast<fftw_complex*>(fftw_malloc(sizeof(fftw_complex) * n));
+
+            if (plan != NULL && data != NULL)
+            {
+                memset(data, 0, sizeof(fftw_complex) * n);
+                seconds = TimeTransforms(plan, data, fftw_execute_dft, minimumSeconds);
+            }
+
+            fftw_free(data);
+            Planner::ReleasePlan(plan);
+        }
+
+        return seconds;
+    }
+}}
@@ -0,0 +1,21 @@
+// FftSizes.h
+//
+// Which FFT sizes FFTW is fast at, and what a given size actually costs on this machine. FftSizes.cpp is
+// native code, like the planner (FftwPlanner.h) it takes its plans from.
+
+#pragma once
+
+namespace FftwInterop { namespace Sizes {
+
+    // True if n only has the factors FFTW has hard coded codelets for (2, 3, 5 and 7). Any other prime
+    // factor is done with Rader's or Bluestein's algorithm, which is several times slower per sample.
+    bool IsFastSize(int n);
+
+    // The fast size closest to n, the larger one on a tie (finer resolution)
+    int NearestFastSize(int n);
+
+    // Seconds per in place forward transform of n samples, planned through the plan registry with flags (so
+    // the plan, or at least its wisdom, is reused when the size is used for real). Times transforms for at
+    // least minimumSeconds. Returns a negative value if FFTW could not plan the size.
+    double SecondsPerTransform(int n, bool singlePrecision, unsigned flags, double minimumSeconds);
+}}
@@ -2,5 +2,12 @@
 
 #include "stdafx.h"
 
+#include "FftSizeAdvisor.h"
 #include "FftwInterop.h"
+#include "PolyphaseFilterBank.h"
+#include "SampleBufferPool.h"
+#include "SparseSpectrum.h"
+#include "SpectrumPipeline.h"
+#include "WelchPsd.h"
+#include "ZoomFft.h"
 
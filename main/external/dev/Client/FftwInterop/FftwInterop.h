@@ -3,84 +3,150 @@
 #pragma once
 
 #include "fftw3.h"
+#include "FftwPlanHandle.h"
+#include "FftwPlanner.h"
+#include "FftwWisdom.h"
+#include "SampleBuffer.h"
+#include "SampleBufferF.h"
+#include "SampleBufferPool.h"
 
 using namespace System;
 using namespace System::Diagnostics;
 using namespace System::Numerics;
 
-#define fftwPlanDft1d fftw_plan_dft_1d
-
 namespace FftwInterop {
 
-	public ref class Fftw
+	public ref class Fftw : IDisposable
 	{
         private:
-            fftw_plan plan1d;
-            //fftw_plan planWnd;
+            // Shared with every other Fftw of the same size and precision, see FftwPlanHandle
+            FftwPlanHandle^ plan1d;
+            ISampleBuffer^ work;
 
         public:
+            // The plan is built on (and only ever executed on) fftw_malloc'd buffers, so FFTW is free to pick its
+            // aligned SIMD codelets. Execute1d(array<Complex>^) copies through an aligned work buffer instead of
+            // asking for FFTW_UNALIGNED.
+            literal unsigned int PlanFlags = FFTW_MEASURE;
+
             Fftw()
             {
-                plan1d = NULL;
-                //planWnd = NULL;
+            }
+
+            ~Fftw()
+            {
+                delete plan1d;
+                delete work;
+            }
+
+            // Transforms below this many samples gain nothing from extra threads
+            literal int DefaultThreadingMinimumSize = 262144;
+
+            // Plans built from now on (by any FftwInterop class) use threadCount threads for transforms of at
+            // least minimumSize samples. threadCount <= 0 means one thread per processor. Existing plans are not
+            // affected, so call this before the devices are configured.
+            static bool EnableThreads(int threadCount, int minimumSize)
+            {
+                if (threadCount <= 0)
+                {
+                    threadCount = Environment::ProcessorCount;
+                }
+
+                return Planner::EnableThreads(threadCount, minimumSize);
+            }
+
+            // Whether libfftw3f-3.dll is deployed, without it only SamplePrecision::Double can be planned
+            static property bool SinglePrecisionAvailable
+            {
+                bool get() { return Planner::SinglePrecisionAvailable(); }
+            }
+
+            static FftwPlanKey PlanKey(int dataLength)
+            {
+                return PlanKey(dataLength, SamplePrecision::Double);
+            }
+
+            static FftwPlanKey PlanKey(int dataLength, SamplePrecision precision)
+            {
+                return FftwPlanKey(dataLength, 1, FFTW_FORWARD, PlanFlags, precision);
+            }
+
+            property int DataLength
+            {
+                int get() { return work == nullptr ? 0 : work->Length; }
+            }
+
+            property SamplePrecision Precision
+            {
+                SamplePrecision get() { return work == nullptr ? SamplePrecision::Double : work->Precision; }
             }
 
             void BuildPlan1d(int dataLength)
+            {
+                BuildPlan1d(dataLength, SamplePrecision::Double);
+            }
+
+            // SamplePrecision::Single plans with fftwf_, the plan then only executes SampleBufferF buffers
+            void BuildPlan1d(int dataLength, SamplePrecision precision)
             {
                 // From the help file...
                 // in and out point to the input and output arrays of the transform, which may be the
                 // same (yielding an in-place transform). These arrays are overwritten during planning,
                 // unless FFTW_ESTIMATE is used in the flags. (The arrays need not be initialized, but
                 // they must be allocated.)
+                //
+                // The registry plans on its own scratch buffer, and only the first Fftw of a given size does.
+
+                delete plan1d;
+                delete work;
+
+                plan1d = gcnew FftwPlanHandle(PlanKey(dataLength, precision));
+                work = SampleBufferPool::CreateBuffer(precision, dataLength);
+            }
 
-                array<Complex>^ input = gcnew array<Complex>(dataLength);
-                pin_ptr<Complex> mp = &input[0];
-                fftw_complex* np = reinterpret_cast<fftw_complex*>(mp);
+            // In place on data's first DataLength samples. fftw_malloc always returns the same alignment, so
+            // any buffer of the plan's precision can be used with the plan. Safe to call from several threads
+            // as long as each uses its own buffer.
+            void Execute1d(ISampleBuffer^ data)
+            {
+                Debug::Assert(plan1d != nullptr);
 
-                plan1d = fftwPlanDft1d(dataLength, np, np, FFTW_FORWARD, FFTW_MEASURE | FFTW_UNALIGNED);
+                plan1d->Execute(data);
             }
 
+            // Uses the work buffer, so unlike Execute1d(ISampleBuffer^) only one thread at a time per Fftw
             void Execute1d(array<Complex>^ data)
             {
-                Debug::Assert(plan1d != NULL);
+                Debug::Assert(plan1d != nullptr);
+                Debug::Assert(data->Length <= DataLength);
 
                 pin_ptr<Complex> mp = &data[0];
-                fftw_complex* np = reinterpret_cast<fftw_complex*>(mp);
-
-                // Allows the reuse of a plan with different buffers than were used to create the plan
-                fftw_execute_dft(plan1d, np, np);
+                double* np = reinterpret_cast<double*>(mp);
+                int count = SampleBuffer::ComplexWidth * data->Length;
+
+                // A pinned managed array has no alignment guarantee, so run the plan on the work buffer.
+                // A shorter array is zero padded rather than letting the plan run past its end.
+                if (data->Length < DataLength)
+                {
+                    work->Clear();
+                }
+
+                if (Precision == SamplePrecision::Single)
+                {
+                    fftwf_complex* wp = safe_cast<SampleBufferF^>(work)->NativePointer;
+
+                    Kernels::Narrow(np, reinterpret_cast<float*>(wp), count);
+                    plan1d->Execute(wp);
+                    Kernels::Widen(reinterpret_cast<float*>(wp), np, count);
+                }
+                else
+                {
+                    fftw_complex* wp = safe_cast<SampleBuffer^>(work)->NativePointer;
+
+                    memcpy(wp, np, sizeof(double) * count);
+                    plan1d->Execute(wp);
+                    memcpy(np, wp, sizeof(double) * count);
+                }
             }
-
-            //void BuildPlanWindow(int samplesPerWindow, int numberOfWindows)
-            //{
-            //    // From the help file...
-            //    // in and out point to the input and output arrays of the transform, which may be the
-            //    // same (yielding an in-place transform). These arrays are overwritten during planning,
-            //    // unless FFTW_ESTIMATE is used in the flags. (The arrays need not be initialized, but
-            //    // they must be allocated.)
-            //    array<Complex>^ input = gcnew array<Complex>(samplesPerWindow * numberOfWindows);
-            //    pin_ptr<Complex> mpInOut = &input[0];
-            //    fftw_complex* npInOut = reinterpret_cast<fftw_complex*>(mpInOut);
-
-            //    int rank = 1;
-            //    const int* n = &samplesPerWindow;
-            //    int howmany = numberOfWindows;
-            //    const int* nembed = n;
-            //    int stride = 1; // Contiguous in memory
-            //    int dist = samplesPerWindow;
-
-            //    planWnd = fftw_plan_many_dft(rank, n, howmany, npInOut, nembed, stride, dist, npInOut, nembed, stride, dist, FFTW_FORWARD, FFTW_MEASURE | FFTW_UNALIGNED);
-            //}
-
-            //void ExecuteWindow(array<Complex>^ data)
-            //{
-            //    Debug::Assert(planWnd != NULL);
-
-            //    pin_ptr<Complex> mp = &data[0];
-            //    fftw_complex* np = reinterpret_cast<fftw_complex*>(mp);
-
-            //    // Allows the reuse of a plan with different buffers than were used to create the plan
-            //    fftw_execute_dft(planWnd, np, np);
-            //}
 	};
 }
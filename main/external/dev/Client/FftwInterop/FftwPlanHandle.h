@@ -0,0 +1,118 @@
+// FftwPlanHandle.h
+
+#pragma once
+
+#include "fftw3.h"
+#include "FftwPlanner.h"
+#include "FftwWisdom.h"
+#include "SampleBuffer.h"
+#include "SampleBufferF.h"
+
+using namespace System;
+using namespace System::Diagnostics;
+
+namespace FftwInterop {
+
+    // An execute-only reference to a plan in the process wide plan registry (see Planner::AcquirePlan).
+    //
+    // Every Fftw, SpectrumPipeline and WelchPsd asking for the same problem gets the same plan, planned once
+    // under the planner lock. A handle can only execute, in place, on buffers it is given, and execution is
+    // thread safe, so devices running on different threads can use handles to the same plan concurrently.
+    public ref class FftwPlanHandle : IDisposable
+    {
+        private:
+            fftw_plan plan;
+            fftwf_plan planF;
+            FftwPlanKey key;
+
+        internal:
+            void Execute(fftw_complex* data)
+            {
+                Debug::Assert(plan != NULL);
+
+                fftw_execute_dft(plan, data, data);
+            }
+
+            void Execute(fftwf_complex* data)
+            {
+                Debug::Assert(planF != NULL);
+
+                Planner::ExecuteDftF(planF, data, data);
+            }
+
+        public:
+            FftwPlanHandle(FftwPlanKey key)
+            {
+                if (key.Size < 1 || key.HowMany < 1)
+                {
+                    throw gcnew ArgumentOutOfRangeException("key");
+                }
+
+                if (key.Precision == SamplePrecision::Single && key.HowMany != 1)
+                {
+                    throw gcnew ArgumentException("Only single transforms are planned in single precision", "key");
+                }
+
+                if (key.Precision == SamplePrecision::Single && !Planner::SinglePrecisionAvailable())
+                {
+                    throw gcnew InvalidOperationException("Single precision needs libfftw3f-3.dll, which could not be loaded");
+                }
+
+                this->key = key;
+
+                if (key.Precision == SamplePrecision::Single)
+                {
+                    planF = Planner::AcquirePlanF(key.Size, key.Direction, key.Flags);
+                }
+                else
+                {
+                    plan = Planner::AcquirePlan(key.Size, key.HowMany, key.Direction, key.Flags);
+                }
+
+                if (plan == NULL && planF == NULL)
+                {
+                    throw gcnew InvalidOperationException(String::Format("FFTW was unable to plan {0}", key));
+                }
+            }
+
+            ~FftwPlanHandle() { this->!FftwPlanHandle(); }
+
+            !FftwPlanHandle()
+            {
+                Planner::ReleasePlan(plan);
+                plan = NULL;
+
+                Planner::ReleasePlan(planF);
+                planF = NULL;
+            }
+
+            // Number of distinct plans shared by all of the handles in the process
+            static property int SharedPlanCount
+            {
+                int get() { return Planner::SharedPlanCount(); }
+            }
+
+            property FftwPlanKey Key
+            {
+                FftwPlanKey get() { return key; }
+            }
+
+            // Transforms the first Size * HowMany samples of data in place
+            void Execute(ISampleBuffer^ data)
+            {
+                if (data->Precision != key.Precision || data->Length < key.Size * key.HowMany)
+                {
+                    throw gcnew ArgumentException(String::Format("The buffer does not fit the plan {0}", key), "data");
+                }
+
+                if (key.Precision == SamplePrecision::Single)
+                {
+                    Execute(safe_cast<SampleBufferF^>(data)->NativePointer);
+                }
+                else
+                {
+                    Execute(safe_cast<SampleBuffer^>(data)->NativePointer);
+                }
+            }
+    };
+}
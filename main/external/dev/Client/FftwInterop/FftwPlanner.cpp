@@ -0,0 +1,425 @@
+// FftwPlanner.cpp
+
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+
+#include <map>
+#include <mutex>
+#include <tuple>
+#include <windows.h>
+#include "FftwPlanner.h"
+
+namespace FftwInterop { namespace Planner {
+
+    static std::mutex plannerMutex;
+
+    // The fftwf_ functions of libfftw3f-3.dll
+    struct SingleApi
+    {
+        fftwf_plan (*planDft1d)(int n, fftwf_complex* in, fftwf_complex* out, int sign, unsigned flags);
+        void (*destroyPlan)(fftwf_plan plan);
+        void (*executeDft)(const fftwf_plan plan, fftwf_complex* in, fftwf_complex* out);
+        int (*initThreads)(void);
+        void (*planWithNthreads)(int threads);
+        int (*importWisdomFromString)(const char* wisdom);
+        void (*exportWisdom)(void (*writeChar)(char c, void* data), void* data);
+        void (*forgetWisdom)(void);
+    };
+
+    static std::once_flag singleLoaded;
+    static SingleApi singleApi;
+    static bool singleAvailable = false;
+
+    template <typename F>
+    static bool Resolve(HMODULE module, const char* name, F& function)
+    {
+        function = reinterpret_cast<F>(GetProcAddress(module, name));
+        return function != NULL;
+    }
+
+    static void LoadSingle()
+    {
+        HMODULE module = LoadLibraryW(L"libfftw3f-3.dll");
+        if (module == NULL)
+        {
+            return;
+        }
+
+        SingleApi api;
+        if (Resolve(module, "fftwf_plan_dft_1d", api.planDft1d)
+            && Resolve(module, "fftwf_destroy_plan", api.destroyPlan)
+            && Resolve(module, "fftwf_execute_dft", api.executeDft)
+            && Resolve(module, "fftwf_init_threads", api.initThreads)
+            && Resolve(module, "fftwf_plan_with_nthreads", api.planWithNthreads)
+            && Resolve(module, "fftwf_import_wisdom_from_string", api.importWisdomFromString)
+            && Resolve(module, "fftwf_export_wisdom", api.exportWisdom)
+            && Resolve(module, "fftwf_forget_wisdom", api.forgetWisdom))
+        {
+            singleApi = api;
+            singleAvailable = true;
+        }
+        else
+        {
+            FreeLibrary(module);
+        }
+    }
+
+    // NULL if the library isn't there. The library stays loaded for the life of the process.
+    static const SingleApi* Single()
+    {
+        std::call_once(singleLoaded, LoadSingle);
+
+        return singleAvailable ? &singleApi : NULL;
+    }
+
+    bool SinglePrecisionAvailable()
+    {
+        return Single() != NULL;
+    }
+
+    void ExecuteDftF(const fftwf_plan plan, fftwf_complex* in, fftwf_complex* out)
+    {
+        singleApi.executeDft(plan, in, out);
+    }
+
+    // Guarded by plannerMutex
+    static bool threadsInitialized = false;
+    static int plannerThreads = 1;
+    static int threadingMinimumSize = 0;
+
+    // Must be called with plannerMutex held, right before planning a problem of problemSize complex samples.
+    // The thread count is part of the problem as far as wisdom is concerned, so a given size is always planned
+    // with the same count.
+    static void SelectThreads(long long problemSize)
+    {
+        if (!threadsInitialized)
+        {
+            return;
+        }
+
+        int threads = problemSize >= threadingMinimumSize ? plannerThreads : 1;
+
+        fftw_plan_with_nthreads(threads);
+
+        if (Single() != NULL)
+        {
+            Single()->planWithNthreads(threads);
+        }
+    }
+
+    bool EnableThreads(int threadCount, int minimumSize)
+    {
+        std::lock_guard<std::mutex> lock(plannerMutex);
+
+        if (!threadsInitialized)
+        {
+            if (fftw_init_threads() == 0 || (Single() != NULL && Single()->initThreads() == 0))
+            {
+                return false;
+            }
+
+            threadsInitialized = true;
+        }
+
+        plannerThreads = threadCount < 1 ? 1 : threadCount;
+        threadingMinimumSize = minimumSize;
+
+        return true;
+    }
+
+    fftw_plan PlanDft1d(int n, fftw_complex* in, fftw_complex* out, int sign, unsigned flags)
+    {
+        std::lock_guard<std::mutex> lock(plannerMutex);
+
+        SelectThreads(n);
+        return fftw_plan_dft_1d(n, in, out, sign, flags);
+    }
+
+    fftw_plan PlanManyDft(int n, int howMany, fftw_complex* in, fftw_complex* out, int sign, unsigned flags)
+    {
+        std::lock_guard<std::mutex> lock(plannerMutex);
+
+        SelectThreads(static_cast<long long>(n) * howMany);
+
+        // Contiguous transforms of n samples each, transform i starts at in[i * n]
+        return fftw_plan_many_dft(1, &n, howMany, in, NULL, 1, n, out, NULL, 1, n, sign, flags);
+    }
+
+    void DestroyPlan(fftw_plan plan)
+    {
+        if (plan == NULL)
+        {
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock(plannerMutex);
+
+        fftw_destroy_plan(plan);
+    }
+
+    fftwf_plan PlanDft1d(int n, fftwf_complex* in, fftwf_complex* out, int sign, unsigned flags)
+    {
+        if (Single() == NULL)
+        {
+            return NULL;
+        }
+
+        std::lock_guard<std::mutex> lock(plannerMutex);
+
+        SelectThreads(n);
+        return Single()->planDft1d(n, in, out, sign, flags);
+    }
+
+    static void DestroyPlanF(fftwf_plan plan)
+    {
+        singleApi.destroyPlan(plan);
+    }
+
+    void DestroyPlan(fftwf_plan plan)
+    {
+        if (plan == NULL)
+        {
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock(plannerMutex);
+
+        DestroyPlanF(plan);
+    }
+
+    // (n, howMany, sign, flags)
+    typedef std::tuple<int, int, int, unsigned> ProblemKey;
+
+    template <typename P>
+    struct SharedPlan
+    {
+        P plan;
+        int users;
+    };
+
+    // Guarded by plannerMutex
+    static std::map<ProblemKey, SharedPlan<fftw_plan>> sharedPlans;
+    static std::map<ProblemKey, SharedPlan<fftwf_plan>> sharedPlansF;
+
+    fftw_plan AcquirePlan(int n, int howMany, int sign, unsigned flags)
+    {
+        ProblemKey key(n, howMany, sign, flags);
+
+        {
+            std::lock_guard<std::mutex> lock(plannerMutex);
+
+            auto found = sharedPlans.find(key);
+            if (found != sharedPlans.end())
+            {
+                found->second.users++;
+                return found->second.plan;
+            }
+        }
+
+        // Planning takes the lock itself. Two threads may race to plan the same new problem, the loser's plan is
+        // destroyed below and it uses the winner's.
+        fftw_complex* scratch = static_cast<fftw_complex*>(fftw_malloc(sizeof(fftw_complex) * n * howMany));
+        if (scratch == NULL)
+        {
+            return NULL;
+        }
+
+        fftw_plan plan = howMany == 1
+            ? PlanDft1d(n, scratch, scratch, sign, flags)
+            : PlanManyDft(n, howMany, scratch, scratch, sign, flags);
+
+        // The plan remembers scratch, but shared plans are only run through fftw_execute_dft with the caller's arrays
+        fftw_free(scratch);
+
+        if (plan == NULL)
+        {
+            return NULL;
+        }
+
+        std::lock_guard<std::mutex> lock(plannerMutex);
+
+        auto inserted = sharedPlans.insert(std::make_pair(key, SharedPlan<fftw_plan>{ plan, 0 }));
+        if (!inserted.second)
+        {
+            fftw_destroy_plan(plan);
+        }
+
+        inserted.first->second.users++;
+        return inserted.first->second.plan;
+    }
+
+    fftwf_plan AcquirePlanF(int n, int sign, unsigned flags)
+    {
+        ProblemKey key(n, 1, sign, flags);
+
+        {
+            std::lock_guard<std::mutex> lock(plannerMutex);
+
+            auto found = sharedPlansF.find(key);
+            if (found != sharedPlansF.end())
+            {
+                found->second.users++;
+                return found->second.plan;
+            }
+        }
+
+        // fftw_malloc aligns like fftwf_malloc, the double precision library allocates for both
+        fftwf_complex* scratch = static_cast<fftwf_complex*>(fftw_malloc(sizeof(fftwf_complex) * n));
+        if (scratch == NULL)
+        {
+            return NULL;
+        }
+
+        fftwf_plan plan = PlanDft1d(n, scratch, scratch, sign, flags);
+        fftw_free(scratch);
+
+        if (plan == NULL)
+        {
+            return NULL;
+        }
+
+        std::lock_guard<std::mutex> lock(plannerMutex);
+
+        auto inserted = sharedPlansF.insert(std::make_pair(key, SharedPlan<fftwf_plan>{ plan, 0 }));
+        if (!inserted.second)
+        {
+            DestroyPlanF(plan);
+        }
+
+        inserted.first->second.users++;
+        return inserted.first->second.plan;
+    }
+
+    template <typename P, typename Destroy>
+    static void Release(std::map<ProblemKey, SharedPlan<P>>& plans, P plan, Destroy destroy)
+    {
+        if (plan == NULL)
+        {
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock(plannerMutex);
+
+        for (auto entry = plans.begin(); entry != plans.end(); ++entry)
+        {
+            if (entry->second.plan == plan)
+            {
+                if (--entry->second.users == 0)
+                {
+                    destroy(plan);
+                    plans.erase(entry);
+                }
+
+                return;
+            }
+        }
+    }
+
+    void ReleasePlan(fftw_plan plan)
+    {
+        Release(sharedPlans, plan, fftw_destroy_plan);
+    }
+
+    void ReleasePlan(fftwf_plan plan)
+    {
+        Release(sharedPlansF, plan, DestroyPlanF);
+    }
+
+    int SharedPlanCount()
+    {
+        std::lock_guard<std::mutex> lock(plannerMutex);
+
+        return static_cast<int>(sharedPlans.size() + sharedPlansF.size());
+    }
+
+    bool HasWisdom(int n, int howMany, int sign, unsigned flags)
+    {
+        // With FFTW_WISDOM_ONLY the planner returns NULL instead of measuring and never reads or writes the arrays,
+        // it only looks at their alignment, so a single aligned element is enough (n can be 50,000,000).
+        fftw_complex* scratch = static_cast<fftw_complex*>(fftw_malloc(sizeof(fftw_complex)));
+
+        fftw_plan plan = howMany == 1
+            ? PlanDft1d(n, scratch, scratch, sign, flags | FFTW_WISDOM_ONLY)
+            : PlanManyDft(n, howMany, scratch, scratch, sign, flags | FFTW_WISDOM_ONLY);
+
+        bool found = plan != NULL;
+
+        DestroyPlan(plan);
+        fftw_free(scratch);
+
+        return found;
+    }
+
+    bool ImportWisdom(const std::string& wisdom)
+    {
+        std::lock_guard<std::mutex> lock(plannerMutex);
+
+        return fftw_import_wisdom_from_string(wisdom.c_str()) != 0;
+    }
+
+    static void AppendChar(char c, void* data)
+    {
+        static_cast<std::string*>(data)->push_back(c);
+    }
+
+    std::string ExportWisdom()
+    {
+        std::lock_guard<std::mutex> lock(plannerMutex);
+
+        // fftw_export_wisdom_to_string hands back memory from FFTW's C runtime, which we can't free from ours,
+        // so we collect the characters ourselves instead.
+        std::string wisdom;
+        fftw_export_wisdom(&AppendChar, &wisdom);
+
+        return wisdom;
+    }
+
+    bool HasWisdomF(int n, int sign, unsigned flags)
+    {
+        fftwf_complex* scratch = static_cast<fftwf_complex*>(fftw_malloc(sizeof(fftwf_complex)));
+
+        fftwf_plan plan = PlanDft1d(n, scratch, scratch, sign, flags | FFTW_WISDOM_ONLY);
+        bool found = plan != NULL;
+
+        DestroyPlan(plan);
+        fftw_free(scratch);
+
+        return found;
+    }
+
+    bool ImportWisdomF(const std::string& wisdom)
+    {
+        if (Single() == NULL)
+        {
+            return false;
+        }
+
+        std::lock_guard<std::mutex> lock(plannerMutex);
+
+        return Single()->importWisdomFromString(wisdom.c_str()) != 0;
+    }
+
+    std::string ExportWisdomF()
+    {
+        std::string wisdom;
+
+        if (Single() != NULL)
+        {
+            std::lock_guard<std::mutex> lock(plannerMutex);
+
+            Single()->exportWisdom(&AppendChar, &wisdom);
+        }
+
+        return wisdom;
+    }
+
+    void ForgetWisdomF()
+    {
+        if (Single() != NULL)
+        {
+            std::lock_guard<std::mutex> lock(plannerMutex);
+
+            Single()->forgetWisdom();
+        }
+    }
+}}
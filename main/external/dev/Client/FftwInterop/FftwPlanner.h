@@ -0,0 +1,73 @@
+// FftwPlanner.h
+//
+// Everything that touches the FFTW planner (double and single precision) goes through here. Only
+// fftw_execute* is thread safe, planning, destroying plans and importing/exporting wisdom all share global
+// state inside FFTW, so these calls are serialized on one process wide lock. FftwPlanner.cpp is compiled as
+// native code because that lock is a std::mutex, which can't be used under /clr.
+//
+// Only the double precision library is linked. The single precision one (libfftw3f-3.dll) is loaded on first use
+// and its fftwf_ functions resolved by name, so FftwInterop builds and runs without it; single precision is then
+// just unavailable (see SinglePrecisionAvailable).
+
+#pragma once
+
+#include <string>
+#include "fftw3.h"
+
+namespace FftwInterop { namespace Planner {
+
+    // Whether libfftw3f-3.dll could be loaded with every fftwf_ function used here. Without it the single
+    // precision planning functions return NULL, false or an empty string.
+    bool SinglePrecisionAvailable();
+
+    // fftwf_execute_dft, thread safe like it. plan must come from this planner.
+    void ExecuteDftF(const fftwf_plan plan, fftwf_complex* in, fftwf_complex* out);
+
+    // Turns on threaded plans (fftw_init_threads / fftwf_init_threads): from now on every problem with at least
+    // minimumSize complex samples (n * howMany) is planned with threadCount threads, smaller ones stay single
+    // threaded because the thread hand off costs more than it saves. Returns false if FFTW could not start its
+    // threads, planning then stays single threaded.
+    bool EnableThreads(int threadCount, int minimumSize);
+
+    fftw_plan PlanDft1d(int n, fftw_complex* in, fftw_complex* out, int sign, unsigned flags);
+
+    fftw_plan PlanManyDft(int n, int howMany, fftw_complex* in, fftw_complex* out, int sign, unsigned flags);
+
+    void DestroyPlan(fftw_plan plan);
+
+    fftwf_plan PlanDft1d(int n, fftwf_complex* in, fftwf_complex* out, int sign, unsigned flags);
+
+    void DestroyPlan(fftwf_plan plan);
+
+    // Returns true if FFTW already has wisdom for this problem, i.e. planning it with these flags is only a lookup
+    bool HasWisdom(int n, int howMany, int sign, unsigned flags);
+
+    bool ImportWisdom(const std::string& wisdom);
+
+    std::string ExportWisdom();
+
+    // Plan registry. Identical problems (n, howMany, sign, flags, precision) share one plan, planned on first
+    // use on a scratch buffer and destroyed when the last user releases it. A shared plan must only be run
+    // with the new-array execute functions (fftw_execute_dft), in place, on fftw_malloc'd memory; those are
+    // thread safe, so the same plan can be executed by several devices on different threads at once.
+    // Returns NULL if FFTW could not plan the problem.
+    fftw_plan AcquirePlan(int n, int howMany, int sign, unsigned flags);
+
+    fftwf_plan AcquirePlanF(int n, int sign, unsigned flags);
+
+    void ReleasePlan(fftw_plan plan);
+
+    void ReleasePlan(fftwf_plan plan);
+
+    // Number of distinct plans currently held by the registry
+    int SharedPlanCount();
+
+    // The fftwf_ library keeps its own wisdom, these are the single precision versions of the above
+    bool HasWisdomF(int n, int sign, unsigned flags);
+
+    bool ImportWisdomF(const std::string& wisdom);
+
+    std::string ExportWisdomF();
+
+    void ForgetWisdomF();
+}}
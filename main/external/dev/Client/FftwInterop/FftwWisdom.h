@@ -0,0 +1,195 @@
+// FftwWisdom.h
+
+#pragma once
+
+#include <msclr\lock.h>
+#include <msclr\marshal_cppstd.h>
+#include "FftwPlanner.h"
+#include "ISampleBuffer.h"
+
+using namespace System;
+using namespace System::Collections::Generic;
+using namespace System::IO;
+using namespace System::Threading::Tasks;
+using namespace msclr::interop;
+
+namespace FftwInterop {
+
+    // Identifies one FFTW problem the scanner plans: howMany contiguous transforms of size samples each
+    // (howMany == 1 for Fftw::BuildPlan1d, NumberOfWindows for WelchPsd), with the given planner flags, in
+    // double (fftw_) or single (fftwf_) precision.
+    public value class FftwPlanKey
+    {
+        public:
+            FftwPlanKey(int size, int howMany, int direction, unsigned int flags)
+            {
+                Size = size;
+                HowMany = howMany;
+                Direction = direction;
+                Flags = flags;
+                Precision = SamplePrecision::Double;
+            }
+
+            FftwPlanKey(int size, int howMany, int direction, unsigned int flags, SamplePrecision precision)
+            {
+                Size = size;
+                HowMany = howMany;
+                Direction = direction;
+                Flags = flags;
+                Precision = precision;
+            }
+
+            int Size;
+            int HowMany;
+            int Direction;
+            unsigned int Flags;
+            SamplePrecision Precision;
+
+            virtual String^ ToString() override
+            {
+                return String::Format("Size: {0}, HowMany: {1}, Direction: {2}, Flags: 0x{3:X}, Precision: {4}", Size, HowMany, Direction, Flags, Precision);
+            }
+    };
+
+    // Persists FFTW wisdom so that FFTW_MEASURE planning is paid once per station instead of on every
+    // UsrpDevice.ConfigureDevice. FFTW itself keys wisdom by problem (size, howMany, direction, alignment)
+    // and planner flags, so a plan whose key is already in the file is a lookup.
+    //
+    // The fftwf_ library has its own wisdom, it is kept next to the double precision file (see SinglePrecisionPath).
+    public ref class FftwWisdom abstract sealed
+    {
+        private:
+            static initonly Object^ fileLock = gcnew Object();
+
+            // Runs the planner for a set of keys on a worker thread, then saves the result
+            ref class PrePlanner
+            {
+                private:
+                    List<FftwPlanKey>^ keys;
+                    String^ path;
+
+                public:
+                    PrePlanner(IEnumerable<FftwPlanKey>^ keys, String^ path)
+                    {
+                        this->keys = gcnew List<FftwPlanKey>(keys);
+                        this->path = path;
+                    }
+
+                    void Run()
+                    {
+                        bool planned = false;
+
+                        for each (FftwPlanKey key in keys)
+                        {
+                            planned |= FftwWisdom::Plan(key);
+                        }
+
+                        if (planned && !String::IsNullOrEmpty(path))
+                        {
+                            FftwWisdom::Save(path);
+                        }
+                    }
+            };
+
+            // Replaces path in one step so that a crash half way through never leaves a truncated file behind
+            static void WriteFile(String^ path, const std::string& wisdom)
+            {
+                String^ tempPath = path + ".tmp";
+                File::WriteAllText(tempPath, marshal_as<String^>(wisdom));
+
+                if (File::Exists(path))
+                {
+                    File::Replace(tempPath, path, nullptr);
+                }
+                else
+                {
+                    File::Move(tempPath, path);
+                }
+            }
+
+        public:
+            // fftwWisdom.dat -> fftwWisdom.fftwf.dat
+            static String^ SinglePrecisionPath(String^ path)
+            {
+                return Path::ChangeExtension(path, ".fftwf" + Path::GetExtension(path));
+            }
+
+            // Returns false if there is no wisdom file yet or FFTW rejected its contents. A missing single
+            // precision file is not an error, it only exists once something was planned with fftwf_.
+            static bool Load(String^ path)
+            {
+                if (!File::Exists(path))
+                {
+                    return false;
+                }
+
+                String^ singlePath = SinglePrecisionPath(path);
+                if (File::Exists(singlePath))
+                {
+                    Planner::ImportWisdomF(marshal_as<std::string>(File::ReadAllText(singlePath)));
+                }
+
+                return Planner::ImportWisdom(marshal_as<std::string>(File::ReadAllText(path)));
+            }
+
+            // Writes all of the wisdom accumulated in this process
+            static void Save(String^ path)
+            {
+                msclr::lock l(fileLock);
+
+                WriteFile(path, Planner::ExportWisdom());
+                WriteFile(SinglePrecisionPath(path), Planner::ExportWisdomF());
+            }
+
+            static bool HasWisdom(FftwPlanKey key)
+            {
+                if (key.Precision == SamplePrecision::Single)
+                {
+                    return Planner::HasWisdomF(key.Size, key.Direction, key.Flags);
+                }
+
+                return Planner::HasWisdom(key.Size, key.HowMany, key.Direction, key.Flags);
+            }
+
+            // Makes sure FFTW has wisdom for key, returns true if it had to run the planner to get it
+            static bool Plan(FftwPlanKey key)
+            {
+                if (HasWisdom(key))
+                {
+                    return false;
+                }
+
+                if (key.Precision == SamplePrecision::Single)
+                {
+                    // Only 1d transforms are planned in single precision
+                    fftwf_complex* scratchF = static_cast<fftwf_complex*>(fftw_malloc(sizeof(fftwf_complex) * key.Size));
+
+                    Planner::DestroyPlan(Planner::PlanDft1d(key.Size, scratchF, scratchF, key.Direction, key.Flags));
+                    fftw_free(scratchF);
+
+                    return true;
+                }
+
+                fftw_complex* scratch = static_cast<fftw_complex*>(fftw_malloc(sizeof(fftw_complex) * key.Size * key.HowMany));
+
+                fftw_plan plan = key.HowMany == 1
+                    ? Planner::PlanDft1d(key.Size, scratch, scratch, key.Direction, key.Flags)
+                    : Planner::PlanManyDft(key.Size, key.HowMany, scratch, scratch, key.Direction, key.Flags);
+
+                Planner::DestroyPlan(plan);
+                fftw_free(scratch);
+
+                return true;
+            }
+
+            // "Pre-plan" mode: warms the wisdom for every key on a background thread and saves it to path when
+            // anything new was learned. Planning is serialized with the scanner's own planning, so a device
+            // configuring the same size at the same time simply waits and then finds the wisdom.
+            static Task^ PrePlanAsync(IEnumerable<FftwPlanKey>^ keys, String^ path)
+            {
+                PrePlanner^ prePlanner = gcnew PrePlanner(keys, path);
+
+                return Task::Factory->StartNew(gcnew Action(prePlanner, &PrePlanner::Run), TaskCreationOptions::LongRunning);
+            }
+    };
+}
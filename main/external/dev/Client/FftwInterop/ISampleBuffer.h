@@ -0,0 +1,51 @@
+// ISampleBuffer.h
+
+#pragma once
+
+using namespace System;
+using namespace System::Numerics;
+
+namespace FftwInterop {
+
+    // fc64 samples are processed with the fftw_ (double) library, fc32 samples with fftwf_ (single)
+    public enum class SamplePrecision
+    {
+        Double,
+        Single
+    };
+
+    // What the receive path needs from a native sample buffer, whatever its precision (SampleBuffer holds
+    // doubles, SampleBufferF floats). The managed side always sees doubles, conversions happen on the copies.
+    public interface class ISampleBuffer : IDisposable
+    {
+        property SamplePrecision Precision { SamplePrecision get(); }
+
+        // Length in complex samples
+        property int Length { int get(); }
+
+        property IntPtr Pointer { IntPtr get(); }
+
+        IntPtr PointerAt(int index);
+
+        void Clear();
+
+        void Scale(double factor);
+
+        // this[i] = source[sourceOffset + i] * window[i], all three with the same precision
+        void Multiply(ISampleBuffer^ source, int sourceOffset, ISampleBuffer^ window);
+
+        void CopyFrom(array<double>^ interleaved, int count);
+
+        // Copies count complex samples of the buffer's own precision from native memory (e.g. a received block)
+        // to this[destinationOffset]
+        void CopyFrom(IntPtr samples, int destinationOffset, int count);
+
+        // Converts count samples of UHD's sc16 CPU format (interleaved int16) from native memory to
+        // this[destinationOffset], times scale
+        void ConvertFromSc16(IntPtr samples, int destinationOffset, int count, double scale);
+
+        void CopyTo(int sourceOffset, array<double>^ destination);
+
+        void CopyTo(array<Complex>^ destination);
+    };
+}
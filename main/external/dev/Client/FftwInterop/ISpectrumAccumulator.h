@@ -0,0 +1,27 @@
+// ISpectrumAccumulator.h
+
+#pragma once
+
+#include "ISampleBuffer.h"
+
+using namespace System;
+
+namespace FftwInterop {
+
+    // A native spectral estimator that turns one block of samples into FftLength shifted, normalized power bins
+    // and adds them straight to the feature vector accumulators (see FeatureVectorProcessor.ProcessSamples).
+    // Implemented by SpectrumPipeline (windowed FFT), PolyphaseFilterBank and SparseSpectrum (a few bins only).
+    public interface class ISpectrumAccumulator : IDisposable
+    {
+        property int FftLength { int get(); }
+
+        // Complex samples one call to Accumulate reads
+        property int SamplesPerBlock { int get(); }
+
+        property SamplePrecision Precision { SamplePrecision get(); }
+
+        // Transforms SamplesPerBlock samples of samples starting at sampleOffset and accumulates bin k of the
+        // shifted power spectrum into count / sum / min / max [binOffset + k].
+        void Accumulate(ISampleBuffer^ samples, int sampleOffset, array<int>^ count, array<double>^ sum, array<double>^ min, array<double>^ max, int binOffset);
+    };
+}
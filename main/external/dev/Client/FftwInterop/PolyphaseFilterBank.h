@@ -0,0 +1,158 @@
+// PolyphaseFilterBank.h
+
+#pragma once
+
+#include "fftw3.h"
+#include "FftwInterop.h"
+#include "FftwPlanHandle.h"
+#include "ISpectrumAccumulator.h"
+#include "SampleBuffer.h"
+#include "SampleBufferF.h"
+#include "SpectrumKernels.h"
+
+using namespace System;
+using namespace System::Diagnostics;
+
+namespace FftwInterop {
+
+    // Polyphase filter bank (PFB) channelizer, an alternative to the windowed FFT of SpectrumPipeline.
+    //
+    // A block of branches * tapsPerBranch samples is weighted by a long low pass prototype filter and folded
+    // into branches samples (Kernels::PolyphaseFold), which are then transformed by a branches point FFT. Each
+    // bin sees a filter that is tapsPerBranch times longer than the FFT, so the stopband is far below a Hann
+    // window's sidelobes and channel edges are sharp without going to a larger FFT. The FFT is the same
+    // problem as Fftw's, so it shares that plan.
+    public ref class PolyphaseFilterBank : ISpectrumAccumulator
+    {
+        private:
+            FftwPlanHandle^ plan;
+            ISampleBuffer^ work;
+            double* filter;
+            float* filterF;
+            int branches;
+            int tapsPerBranch;
+            double scale;
+
+        public:
+            literal int DefaultTapsPerBranch = 4;
+
+            PolyphaseFilterBank(int branches, int tapsPerBranch, SamplePrecision precision)
+            {
+                if (branches < 2)
+                {
+                    throw gcnew ArgumentOutOfRangeException("branches");
+                }
+
+                if (tapsPerBranch < 1)
+                {
+                    throw gcnew ArgumentOutOfRangeException("tapsPerBranch");
+                }
+
+                this->branches = branches;
+                this->tapsPerBranch = tapsPerBranch;
+
+                int length = branches * tapsPerBranch;
+                filter = static_cast<double*>(fftw_malloc(sizeof(double) * length));
+                filterF = static_cast<float*>(fftw_malloc(sizeof(float) * length));
+                if (filter == NULL || filterF == NULL)
+                {
+                    throw gcnew OutOfMemoryException("Unable to allocate the polyphase filter");
+                }
+
+                Kernels::PolyphasePrototype(filter, branches, tapsPerBranch);
+                Kernels::Narrow(filter, filterF, length);
+
+                // The prototype sums to branches, so this matches the scaling of a compensated windowed FFT
+                double n = branches;
+                scale = 1.0 / (n * n);
+
+                work = SampleBufferPool::CreateBuffer(precision, branches);
+                plan = gcnew FftwPlanHandle(Fftw::PlanKey(branches, precision));
+            }
+
+            ~PolyphaseFilterBank()
+            {
+                this->!PolyphaseFilterBank();
+                delete plan;
+                delete work;
+            }
+
+            !PolyphaseFilterBank()
+            {
+                fftw_free(filter);
+                filter = NULL;
+
+                fftw_free(filterF);
+                filterF = NULL;
+            }
+
+            // Same FFT problem as Fftw::PlanKey, listed for pre-planning
+            static FftwPlanKey PlanKey(int branches, SamplePrecision precision)
+            {
+                return Fftw::PlanKey(branches, precision);
+            }
+
+            property int TapsPerBranch
+            {
+                int get() { return tapsPerBranch; }
+            }
+
+            virtual property int FftLength
+            {
+                int get() { return branches; }
+            }
+
+            virtual property int SamplesPerBlock
+            {
+                int get() { return branches * tapsPerBranch; }
+            }
+
+            virtual property SamplePrecision Precision
+            {
+                SamplePrecision get() { return work->Precision; }
+            }
+
+            virtual void Accumulate(ISampleBuffer^ samples, int sampleOffset, array<int>^ count, array<double>^ sum, array<double>^ min, array<double>^ max, int binOffset)
+            {
+                if (sampleOffset < 0 || sampleOffset + SamplesPerBlock > samples->Length)
+                {
+                    throw gcnew ArgumentOutOfRangeException("sampleOffset");
+                }
+
+                if (binOffset < 0 || binOffset + branches > count->Length || binOffset + branches > sum->Length
+                    || binOffset + branches > min->Length || binOffset + branches > max->Length)
+                {
+                    throw gcnew ArgumentOutOfRangeException("binOffset");
+                }
+
+                if (samples->Precision != Precision)
+                {
+                    throw gcnew ArgumentException("The samples do not have the precision of the filter bank", "samples");
+                }
+
+                pin_ptr<int> mpCount = &count[binOffset];
+                pin_ptr<double> mpSum = &sum[binOffset];
+                pin_ptr<double> mpMin = &min[binOffset];
+                pin_ptr<double> mpMax = &max[binOffset];
+
+                if (Precision == SamplePrecision::Single)
+                {
+                    fftwf_complex* wp = safe_cast<SampleBufferF^>(work)->NativePointer;
+                    const float* in = reinterpret_cast<float*>(safe_cast<SampleBufferF^>(samples)->NativePointer + sampleOffset);
+
+                    Kernels::PolyphaseFold(in, branches, tapsPerBranch, filterF, wp);
+                    plan->Execute(wp);
+                    Kernels::AccumulateShiftedPowerStats(wp, branches, scale, mpCount, mpSum, mpMin, mpMax);
+                }
+                else
+                {
+                    fftw_complex* wp = safe_cast<SampleBuffer^>(work)->NativePointer;
+                    const double* in = reinterpret_cast<double*>(safe_cast<SampleBuffer^>(samples)->NativePointer + sampleOffset);
+
+                    Kernels::PolyphaseFold(in, branches, tapsPerBranch, filter, wp);
+                    plan->Execute(wp);
+                    Kernels::AccumulateShiftedPowerStats(wp, branches, scale, mpCount, mpSum, mpMin, mpMax);
+                }
+            }
+    };
+}
@@ -0,0 +1,179 @@
+// SampleBuffer.h
+
+#pragma once
+
+#include <cstring>
+#include "fftw3.h"
+#include "ISampleBuffer.h"
+#include "SpectrumKernels.h"
+
+using namespace System;
+using namespace System::Diagnostics;
+using namespace System::Numerics;
+using namespace System::Runtime::InteropServices;
+
+namespace FftwInterop {
+
+    // A block of complex double samples (I, Q, I, Q, ...) in native memory from fftw_malloc, so it has the
+    // alignment FFTW's SIMD codelets need and never moves. The receive path writes straight into it (see
+    // RxStreamer::Receive(IntPtr, ...)), windowing and the FFT run on it in place, and the managed side only
+    // ever holds the handle. Copies into managed arrays are explicit (CopyTo) and only needed for raw I/Q output.
+    public ref class SampleBuffer : ISampleBuffer
+    {
+        private:
+            fftw_complex* data;
+            int length;
+
+        internal:
+            property fftw_complex* NativePointer
+            {
+                fftw_complex* get() { return data; }
+            }
+
+        public:
+            literal int ComplexWidth = 2;
+
+            SampleBuffer(int length)
+            {
+                if (length < 1)
+                {
+                    throw gcnew ArgumentOutOfRangeException("length");
+                }
+
+                this->length = length;
+                data = static_cast<fftw_complex*>(fftw_malloc(sizeof(fftw_complex) * length));
+
+                if (data == NULL)
+                {
+                    throw gcnew OutOfMemoryException(String::Format("Unable to allocate a sample buffer of {0} samples", length));
+                }
+
+                Clear();
+            }
+
+            ~SampleBuffer() { this->!SampleBuffer(); }
+
+            !SampleBuffer()
+            {
+                fftw_free(data);
+                data = NULL;
+            }
+
+            virtual property SamplePrecision Precision
+            {
+                SamplePrecision get() { return SamplePrecision::Double; }
+            }
+
+            // Length in complex samples
+            virtual property int Length
+            {
+                int get() { return length; }
+            }
+
+            // Start of the buffer, for handing to native code such as RxStreamer::Receive
+            virtual property IntPtr Pointer
+            {
+                IntPtr get() { return IntPtr(data); }
+            }
+
+            // Pointer to the complex sample at index, e.g. to continue a receive where the last one stopped
+            virtual IntPtr PointerAt(int index)
+            {
+                if (index < 0 || index > length)
+                {
+                    throw gcnew ArgumentOutOfRangeException("index");
+                }
+
+                return IntPtr(data + index);
+            }
+
+            virtual void Clear()
+            {
+                memset(data, 0, sizeof(fftw_complex) * length);
+            }
+
+            virtual void Scale(double factor)
+            {
+                Kernels::Scale(reinterpret_cast<double*>(data), ComplexWidth * length, factor);
+            }
+
+            // this[i] = source[sourceOffset + i] * window[i] for every sample of this buffer. The window is stored
+            // interleaved (one factor for I and one for Q), which is the layout MathLibrary.GetWindowFunction uses.
+            virtual void Multiply(ISampleBuffer^ source, int sourceOffset, ISampleBuffer^ window)
+            {
+                SampleBuffer^ src = safe_cast<SampleBuffer^>(source);
+                SampleBuffer^ wnd = safe_cast<SampleBuffer^>(window);
+
+                if (sourceOffset < 0 || sourceOffset + length > src->length)
+                {
+                    throw gcnew ArgumentOutOfRangeException("sourceOffset");
+                }
+
+                if (wnd->length < length)
+                {
+                    throw gcnew ArgumentException("The window is shorter than the buffer", "window");
+                }
+
+                Kernels::Multiply(reinterpret_cast<double*>(src->data + sourceOffset), reinterpret_cast<double*>(wnd->data), reinterpret_cast<double*>(data), ComplexWidth * length);
+            }
+
+            // Copies interleaved doubles into the start of the buffer
+            void CopyFrom(array<double>^ interleaved)
+            {
+                CopyFrom(interleaved, interleaved->Length);
+            }
+
+            virtual void CopyFrom(array<double>^ interleaved, int count)
+            {
+                if (count < 0 || count > interleaved->Length || count > ComplexWidth * length)
+                {
+                    throw gcnew ArgumentOutOfRangeException("count");
+                }
+
+                Marshal::Copy(interleaved, 0, IntPtr(data), count);
+            }
+
+            virtual void CopyFrom(IntPtr samples, int destinationOffset, int count)
+            {
+                if (destinationOffset < 0 || count < 0 || destinationOffset + count > length)
+                {
+                    throw gcnew ArgumentOutOfRangeException("destinationOffset");
+                }
+
+                memcpy(data + destinationOffset, samples.ToPointer(), sizeof(fftw_complex) * count);
+            }
+
+            virtual void ConvertFromSc16(IntPtr samples, int destinationOffset, int count, double scale)
+            {
+                if (destinationOffset < 0 || count < 0 || destinationOffset + count > length)
+                {
+                    throw gcnew ArgumentOutOfRangeException("destinationOffset");
+                }
+
+                Kernels::ConvertSc16(static_cast<const short*>(samples.ToPointer()), count, scale, data + destinationOffset);
+            }
+
+            // Copies destination->Length / 2 samples starting at sourceOffset out as interleaved doubles
+            virtual void CopyTo(int sourceOffset, array<double>^ destination)
+            {
+                if (sourceOffset < 0 || (ComplexWidth * sourceOffset) + destination->Length > ComplexWidth * length)
+                {
+                    throw gcnew ArgumentOutOfRangeException("sourceOffset");
+                }
+
+                Marshal::Copy(IntPtr(data + sourceOffset), destination, 0, destination->Length);
+            }
+
+            virtual void CopyTo(array<Complex>^ destination)
+            {
+                if (destination->Length > length)
+                {
+                    throw gcnew ArgumentException("The destination is longer than the buffer", "destination");
+                }
+
+                // System::Numerics::Complex is two doubles (real, imaginary), the same layout as fftw_complex
+                pin_ptr<Complex> mp = &destination[0];
+                memcpy(reinterpret_cast<fftw_complex*>(mp), data, sizeof(fftw_complex) * destination->Length);
+            }
+    };
+}
@@ -0,0 +1,173 @@
+// SampleBufferF.h
+
+#pragma once
+
+#include <cstring>
+#include "fftw3.h"
+#include "ISampleBuffer.h"
+#include "SpectrumKernels.h"
+
+using namespace System;
+using namespace System::Diagnostics;
+using namespace System::Numerics;
+
+namespace FftwInterop {
+
+    // The single precision (fc32 / fftwf_) counterpart of SampleBuffer: complex float samples in memory from
+    // fftw_malloc, aligned as fftwf_malloc would (see FftwPlanner.h). Half the bytes per sample of the double
+    // buffer, so receive, windowing and the FFT move half the memory and get twice the SIMD lanes. Copies to and
+    // from the managed side convert to / from double.
+    public ref class SampleBufferF : ISampleBuffer
+    {
+        private:
+            fftwf_complex* data;
+            int length;
+
+        internal:
+            property fftwf_complex* NativePointer
+            {
+                fftwf_complex* get() { return data; }
+            }
+
+        public:
+            literal int ComplexWidth = 2;
+
+            SampleBufferF(int length)
+            {
+                if (length < 1)
+                {
+                    throw gcnew ArgumentOutOfRangeException("length");
+                }
+
+                this->length = length;
+                data = static_cast<fftwf_complex*>(fftw_malloc(sizeof(fftwf_complex) * length));
+
+                if (data == NULL)
+                {
+                    throw gcnew OutOfMemoryException(String::Format("Unable to allocate a sample buffer of {0} samples", length));
+                }
+
+                Clear();
+            }
+
+            ~SampleBufferF() { this->!SampleBufferF(); }
+
+            !SampleBufferF()
+            {
+                fftw_free(data);
+                data = NULL;
+            }
+
+            virtual property SamplePrecision Precision
+            {
+                SamplePrecision get() { return SamplePrecision::Single; }
+            }
+
+            virtual property int Length
+            {
+                int get() { return length; }
+            }
+
+            virtual property IntPtr Pointer
+            {
+                IntPtr get() { return IntPtr(data); }
+            }
+
+            virtual IntPtr PointerAt(int index)
+            {
+                if (index < 0 || index > length)
+                {
+                    throw gcnew ArgumentOutOfRangeException("index");
+                }
+
+                return IntPtr(data + index);
+            }
+
+            virtual void Clear()
+            {
+                memset(data, 0, sizeof(fftwf_complex) * length);
+            }
+
+            virtual void Scale(double factor)
+            {
+                Kernels::Scale(reinterpret_cast<float*>(data), ComplexWidth * length, static_cast<float>(factor));
+            }
+
+            // this[i] = source[sourceOffset + i] * window[i], see SampleBuffer::Multiply
+            virtual void Multiply(ISampleBuffer^ source, int sourceOffset, ISampleBuffer^ window)
+            {
+                SampleBufferF^ src = safe_cast<SampleBufferF^>(source);
+                SampleBufferF^ wnd = safe_cast<SampleBufferF^>(window);
+
+                if (sourceOffset < 0 || sourceOffset + length > src->length)
+                {
+                    throw gcnew ArgumentOutOfRangeException("sourceOffset");
+                }
+
+                if (wnd->length < length)
+                {
+                    throw gcnew ArgumentException("The window is shorter than the buffer", "window");
+                }
+
+                Kernels::Multiply(reinterpret_cast<float*>(src->data + sourceOffset), reinterpret_cast<float*>(wnd->data), reinterpret_cast<float*>(data), ComplexWidth * length);
+            }
+
+            void CopyFrom(array<double>^ interleaved)
+            {
+                CopyFrom(interleaved, interleaved->Length);
+            }
+
+            virtual void CopyFrom(array<double>^ interleaved, int count)
+            {
+                if (count < 0 || count > interleaved->Length || count > ComplexWidth * length)
+                {
+                    throw gcnew ArgumentOutOfRangeException("count");
+                }
+
+                pin_ptr<double> mp = &interleaved[0];
+                Kernels::Narrow(mp, reinterpret_cast<float*>(data), count);
+            }
+
+            virtual void CopyFrom(IntPtr samples, int destinationOffset, int count)
+            {
+                if (destinationOffset < 0 || count < 0 || destinationOffset + count > length)
+                {
+                    throw gcnew ArgumentOutOfRangeException("destinationOffset");
+                }
+
+                memcpy(data + destinationOffset, samples.ToPointer(), sizeof(fftwf_complex) * count);
+            }
+
+            virtual void ConvertFromSc16(IntPtr samples, int destinationOffset, int count, double scale)
+            {
+                if (destinationOffset < 0 || count < 0 || destinationOffset + count > length)
+                {
+                    throw gcnew ArgumentOutOfRangeException("destinationOffset");
+                }
+
+                Kernels::ConvertSc16(static_cast<const short*>(samples.ToPointer()), count, static_cast<float>(scale), data + destinationOffset);
+            }
+
+            virtual void CopyTo(int sourceOffset, array<double>^ destination)
+            {
+                if (sourceOffset < 0 || (ComplexWidth * sourceOffset) + destination->Length > ComplexWidth * length)
+                {
+                    throw gcnew ArgumentOutOfRangeException("sourceOffset");
+                }
+
+                pin_ptr<double> mp = &destination[0];
+                Kernels::Widen(reinterpret_cast<float*>(data + sourceOffset), mp, destination->Length);
+            }
+
+            virtual void CopyTo(array<Complex>^ destination)
+            {
+                if (destination->Length > length)
+                {
+                    throw gcnew ArgumentException("The destination is longer than the buffer", "destination");
+                }
+
+                pin_ptr<Complex> mp = &destination[0];
+                Kernels::Widen(reinterpret_cast<float*>(data), reinterpret_cast<double*>(mp), ComplexWidth * destination->Length);
+            }
+    };
+}
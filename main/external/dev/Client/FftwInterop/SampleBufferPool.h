@@ -0,0 +1,95 @@
+// SampleBufferPool.h
+
+#pragma once
+
+#include "SampleBuffer.h"
+#include "SampleBufferF.h"
+
+using namespace System;
+using namespace System::Collections::Concurrent;
+
+namespace FftwInterop {
+
+    // A fixed set of sample buffers (SampleBuffer or SampleBufferF, depending on the precision) that are allocated
+    // once and then passed around, so nothing on the receive / FFT path allocates or pins per block. Take blocks
+    // when every buffer is in use (the same back pressure FeatureVectorProcessor's data pool uses).
+    public ref class SampleBufferPool : IDisposable
+    {
+        private:
+            BlockingCollection<ISampleBuffer^>^ pool;
+            array<ISampleBuffer^>^ buffers;
+
+            void Initialize(int bufferCount, int samplesPerBuffer, SamplePrecision precision)
+            {
+                if (bufferCount < 1)
+                {
+                    throw gcnew ArgumentOutOfRangeException("bufferCount");
+                }
+
+                buffers = gcnew array<ISampleBuffer^>(bufferCount);
+                pool = gcnew BlockingCollection<ISampleBuffer^>(bufferCount);
+
+                for (int i = 0; i < bufferCount; i++)
+                {
+                    buffers[i] = CreateBuffer(precision, samplesPerBuffer);
+                    pool->Add(buffers[i]);
+                }
+            }
+
+        public:
+            SampleBufferPool(int bufferCount, int samplesPerBuffer)
+            {
+                Initialize(bufferCount, samplesPerBuffer, SamplePrecision::Double);
+            }
+
+            SampleBufferPool(int bufferCount, int samplesPerBuffer, SamplePrecision precision)
+            {
+                Initialize(bufferCount, samplesPerBuffer, precision);
+            }
+
+            ~SampleBufferPool()
+            {
+                for each (ISampleBuffer^ buffer in buffers)
+                {
+                    delete buffer;
+                }
+
+                delete pool;
+            }
+
+            static ISampleBuffer^ CreateBuffer(SamplePrecision precision, int length)
+            {
+                if (precision == SamplePrecision::Single)
+                {
+                    return gcnew SampleBufferF(length);
+                }
+
+                return gcnew SampleBuffer(length);
+            }
+
+            property SamplePrecision Precision
+            {
+                SamplePrecision get() { return buffers[0]->Precision; }
+            }
+
+            property int SamplesPerBuffer
+            {
+                int get() { return buffers[0]->Length; }
+            }
+
+            ISampleBuffer^ Take()
+            {
+                return pool->Take();
+            }
+
+            void Return(ISampleBuffer^ buffer)
+            {
+                if (buffer->Length != SamplesPerBuffer || buffer->Precision != Precision)
+                {
+                    throw gcnew InvalidOperationException("This buffer does not belong to this pool - it is the wrong length or precision");
+                }
+
+                pool->Add(buffer);
+            }
+    };
+}
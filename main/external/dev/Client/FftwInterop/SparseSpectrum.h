@@ -0,0 +1,155 @@
+// SparseSpectrum.h
+
+#pragma once
+
+#include <cstring>
+#include "fftw3.h"
+#include "ISpectrumAccumulator.h"
+#include "SampleBuffer.h"
+#include "SampleBufferF.h"
+#include "SpectrumKernels.h"
+
+using namespace System;
+using namespace System::Diagnostics;
+
+namespace FftwInterop {
+
+    // Power at a short list of frequencies (a watch list of channels) instead of the whole spectrum.
+    //
+    // Every block of blockLength samples is windowed like SpectrumPipeline's and each frequency is evaluated
+    // with the Goertzel algorithm (Kernels::GoertzelPowerStats), with the same normalization as a compensated
+    // FFT bin, so a channel reads the same as the FFT bin it falls on would. FftLength is the number of
+    // frequencies, Accumulate writes one bin per frequency in the order they were given.
+    public ref class SparseSpectrum : ISpectrumAccumulator
+    {
+        private:
+            literal double Pi = 3.14159265358979323846;
+
+            double* window;
+            float* windowF;
+            double* omega;
+            int blockLength;
+            int bins;
+            double scale;
+            SamplePrecision precision;
+
+        public:
+            // window holds one factor per complex sample (blockLength of them), amplitudeCompensation is its
+            // amplitude correction (MathLibrary.GetWindowCompensationFactor). normalizedFrequencies are in cycles
+            // per sample relative to the tuned frequency (offset / sample rate), within [-0.5, 0.5).
+            SparseSpectrum(int blockLength, array<double>^ window, double amplitudeCompensation, array<double>^ normalizedFrequencies, SamplePrecision precision)
+            {
+                if (blockLength < 2)
+                {
+                    throw gcnew ArgumentOutOfRangeException("blockLength");
+                }
+
+                if (window == nullptr || window->Length != blockLength)
+                {
+                    throw gcnew ArgumentException("The window needs one factor per complex sample", "window");
+                }
+
+                if (normalizedFrequencies == nullptr || normalizedFrequencies->Length == 0)
+                {
+                    throw gcnew ArgumentException("At least one frequency is needed", "normalizedFrequencies");
+                }
+
+                this->blockLength = blockLength;
+                this->bins = normalizedFrequencies->Length;
+                this->precision = precision;
+
+                this->window = static_cast<double*>(fftw_malloc(sizeof(double) * blockLength));
+                this->windowF = static_cast<float*>(fftw_malloc(sizeof(float) * blockLength));
+                this->omega = static_cast<double*>(fftw_malloc(sizeof(double) * bins));
+                if (this->window == NULL || this->windowF == NULL || this->omega == NULL)
+                {
+                    throw gcnew OutOfMemoryException("Unable to allocate the sparse spectrum");
+                }
+
+                pin_ptr<double> mpWindow = &window[0];
+                memcpy(this->window, mpWindow, sizeof(double) * blockLength);
+                Kernels::Narrow(this->window, this->windowF, blockLength);
+
+                for (int b = 0; b < bins; b++)
+                {
+                    if (normalizedFrequencies[b] < -0.5 || normalizedFrequencies[b] >= 0.5)
+                    {
+                        throw gcnew ArgumentOutOfRangeException("normalizedFrequencies", String::Format("{0} cycles per sample is outside of the captured band", normalizedFrequencies[b]));
+                    }
+
+                    this->omega[b] = 2 * Pi * normalizedFrequencies[b];
+                }
+
+                // Same normalization as SpectrumPipeline
+                double n = blockLength;
+                scale = (amplitudeCompensation * amplitudeCompensation) / (n * n);
+            }
+
+            ~SparseSpectrum() { this->!SparseSpectrum(); }
+
+            !SparseSpectrum()
+            {
+                fftw_free(window);
+                window = NULL;
+
+                fftw_free(windowF);
+                windowF = NULL;
+
+                fftw_free(omega);
+                omega = NULL;
+            }
+
+            // Number of frequencies, i.e. bins per block
+            virtual property int FftLength
+            {
+                int get() { return bins; }
+            }
+
+            virtual property int SamplesPerBlock
+            {
+                int get() { return blockLength; }
+            }
+
+            virtual property SamplePrecision Precision
+            {
+                SamplePrecision get() { return precision; }
+            }
+
+            virtual void Accumulate(ISampleBuffer^ samples, int sampleOffset, array<int>^ count, array<double>^ sum, array<double>^ min, array<double>^ max, int binOffset)
+            {
+                if (sampleOffset < 0 || sampleOffset + SamplesPerBlock > samples->Length)
+                {
+                    throw gcnew ArgumentOutOfRangeException("sampleOffset");
+                }
+
+                if (binOffset < 0 || binOffset + bins > count->Length || binOffset + bins > sum->Length
+                    || binOffset + bins > min->Length || binOffset + bins > max->Length)
+                {
+                    throw gcnew ArgumentOutOfRangeException("binOffset");
+                }
+
+                if (samples->Precision != precision)
+                {
+                    throw gcnew ArgumentException("The samples do not have the precision of the sparse spectrum", "samples");
+                }
+
+                pin_ptr<int> mpCount = &count[binOffset];
+                pin_ptr<double> mpSum = &sum[binOffset];
+                pin_ptr<double> mpMin = &min[binOffset];
+                pin_ptr<double> mpMax = &max[binOffset];
+
+                if (precision == SamplePrecision::Single)
+                {
+                    const float* in = reinterpret_cast<float*>(safe_cast<SampleBufferF^>(samples)->NativePointer + sampleOffset);
+
+                    Kernels::GoertzelPowerStats(in, blockLength, windowF, omega, bins, scale, mpCount, mpSum, mpMin, mpMax);
+                }
+                else
+                {
+                    const double* in = reinterpret_cast<double*>(safe_cast<SampleBuffer^>(samples)->NativePointer + sampleOffset);
+
+                    Kernels::GoertzelPowerStats(in, blockLength, window, omega, bins, scale, mpCount, mpSum, mpMin, mpMax);
+                }
+            }
+    };
+}
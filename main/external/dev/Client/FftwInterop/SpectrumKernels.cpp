@@ -0,0 +1,337 @@
+// SpectrumKernels.cpp
+
+#include <cmath>
+#include <emmintrin.h>
+#include "SpectrumKernels.h"
+
+namespace FftwInterop { namespace Kernels {
+
+    static const double Pi = 3.14159265358979323846;
+
+    // The double (fftw_) and single (fftwf_) precision kernels share these implementations. T is the sample
+    // type and C the matching FFTW complex type (T[2]).
+
+    template <typename T, typename C>
+    static void WindowSegmentsT(const T* interleavedIq, int segmentLength, int hop, int segmentCount, const T* window, C* out)
+    {
+        for (int segment = 0; segment < segmentCount; segment++)
+        {
+            const T* in = interleavedIq + (2 * segment * hop);
+            C* dst = out + (segment * segmentLength);
+
+            for (int i = 0; i < segmentLength; i++)
+            {
+                dst[i][0] = in[2 * i] * window[i];
+                dst[i][1] = in[(2 * i) + 1] * window[i];
+            }
+        }
+    }
+
+    template <typename T>
+    static void MultiplyT(const T* a, const T* b, T* out, size_t count)
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            out[i] = a[i] * b[i];
+        }
+    }
+
+    template <typename T>
+    static void ScaleT(T* data, size_t count, T factor)
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            data[i] *= factor;
+        }
+    }
+
+    template <typename T>
+    static inline void AccumulateStats(const T* c, double scale, int* count, double* sum, double* min, double* max)
+    {
+        double re = c[0];
+        double im = c[1];
+        double p = scale * ((re * re) + (im * im));
+
+        (*count)++;
+        *sum += p;
+
+        if (p < *min)
+        {
+            *min = p;
+        }
+
+        if (p > *max)
+        {
+            *max = p;
+        }
+    }
+
+    template <typename C>
+    static void AccumulateShiftedPowerStatsT(const C* x, int length, double scale, int* count, double* sum, double* min, double* max)
+    {
+        int half = length / 2;
+
+        for (int i = 0; i < half; i++)
+        {
+            AccumulateStats(x[i + half], scale, count + i, sum + i, min + i, max + i);
+        }
+
+        for (int i = half; i < length; i++)
+        {
+            AccumulateStats(x[i - half], scale, count + i, sum + i, min + i, max + i);
+        }
+    }
+
+    template <typename T>
+    static void GoertzelPowerStatsT(const T* interleavedIq, int length, const T* window, const double* omega, int bins, double scale, int* count, double* sum, double* min, double* max)
+    {
+        for (int b = 0; b < bins; b++)
+        {
+            double coefficient = 2 * cos(omega[b]);
+
+            // The recurrence is real, so I and Q run through it side by side. Always double precision, the
+            // state of a high Q resonator loses too much in float.
+            double s1r = 0, s1i = 0;
+            double s2r = 0, s2i = 0;
+
+            for (int n = 0; n < length; n++)
+            {
+                double w = window[n];
+                double s0r = (w * interleavedIq[2 * n]) + (coefficient * s1r) - s2r;
+                double s0i = (w * interleavedIq[(2 * n) + 1]) + (coefficient * s1i) - s2i;
+
+                s2r = s1r;
+                s2i = s1i;
+                s1r = s0r;
+                s1i = s0i;
+            }
+
+            // X = e^(-j * omega * (length - 1)) * (s1 - e^(-j * omega) * s2), the leading phase does not change |X|
+            double c = cos(omega[b]);
+            double s = sin(omega[b]);
+            double x[2] = { s1r - ((c * s2r) + (s * s2i)), s1i - ((c * s2i) - (s * s2r)) };
+
+            AccumulateStats(x, scale, count + b, sum + b, min + b, max + b);
+        }
+    }
+
+    void ConvertSc16(const short* interleavedIq, size_t count, float scale, fftwf_complex* out)
+    {
+        float* dst = reinterpret_cast<float*>(out);
+        const __m128 factor = _mm_set1_ps(scale);
+        size_t i = 0;
+
+        // 4 complex samples per pass. Duplicating every int16 into both halves of an int32 and shifting right
+        // arithmetically sign extends it.
+        for (; i + 4 <= count; i += 4)
+        {
+            __m128i iq = _mm_loadu_si128(reinterpret_cast<const __m128i*>(interleavedIq + (2 * i)));
+            __m128 low = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(iq, iq), 16));
+            __m128 high = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(iq, iq), 16));
+
+            _mm_storeu_ps(dst + (2 * i), _mm_mul_ps(low, factor));
+            _mm_storeu_ps(dst + (2 * i) + 4, _mm_mul_ps(high, factor));
+        }
+
+        for (i *= 2; i < 2 * count; i++)
+        {
+            dst[i] = scale * interleavedIq[i];
+        }
+    }
+
+    template <typename T, typename C>
+    static void PolyphaseFoldT(const T* interleavedIq, int branches, int taps, const T* filter, C* out)
+    {
+        for (int m = 0; m < branches; m++)
+        {
+            out[m][0] = 0;
+            out[m][1] = 0;
+        }
+
+        // Tap by tap, so every pass streams through branches contiguous samples and filter coefficients
+        for (int t = 0; t < taps; t++)
+        {
+            const T* in = interleavedIq + (2 * t * branches);
+            const T* h = filter + (t * branches);
+
+            for (int m = 0; m < branches; m++)
+            {
+                out[m][0] += in[2 * m] * h[m];
+                out[m][1] += in[(2 * m) + 1] * h[m];
+            }
+        }
+    }
+
+    void PolyphasePrototype(double* filter, int branches, int taps)
+    {
+        const double a0 = 0.35875;
+        const double a1 = 0.48829;
+        const double a2 = 0.14128;
+        const double a3 = 0.01168;
+
+        int length = branches * taps;
+        double center = (length - 1) / 2.0;
+        double sum = 0;
+
+        for (int i = 0; i < length; i++)
+        {
+            double x = (i - center) / branches;
+            double sinc = x == 0 ? 1.0 : sin(Pi * x) / (Pi * x);
+
+            double phase = length == 1 ? 0 : (2 * Pi * i) / (length - 1);
+            double window = a0 - (a1 * cos(phase)) + (a2 * cos(2 * phase)) - (a3 * cos(3 * phase));
+
+            filter[i] = sinc * window;
+            sum += filter[i];
+        }
+
+        for (int i = 0; i < length; i++)
+        {
+            filter[i] *= branches / sum;
+        }
+    }
+
+    void PolyphaseFold(const double* interleavedIq, int branches, int taps, const double* filter, fftw_complex* out)
+    {
+        PolyphaseFoldT(interleavedIq, branches, taps, filter, out);
+    }
+
+    void PolyphaseFold(const float* interleavedIq, int branches, int taps, const float* filter, fftwf_complex* out)
+    {
+        PolyphaseFoldT(interleavedIq, branches, taps, filter, out);
+    }
+
+    void ZoomDecimate(const double* interleavedIq, int decimation, const fftw_complex* filter, int taps, double omega, const double* window, fftw_complex* out, int outputLength)
+    {
+        for (int m = 0; m < outputLength; m++)
+        {
+            const double* in = interleavedIq + (2 * m * decimation);
+            double re = 0;
+            double im = 0;
+
+            for (int k = 0; k < taps; k++)
+            {
+                double xr = in[2 * k];
+                double xi = in[(2 * k) + 1];
+
+                re += (filter[k][0] * xr) - (filter[k][1] * xi);
+                im += (filter[k][0] * xi) + (filter[k][1] * xr);
+            }
+
+            double phase = -omega * m * decimation;
+            double c = cos(phase) * window[m];
+            double s = sin(phase) * window[m];
+
+            out[m][0] = (re * c) - (im * s);
+            out[m][1] = (re * s) + (im * c);
+        }
+    }
+
+    void HannWindow(double* window, int length)
+    {
+        if (length == 1)
+        {
+            window[0] = 1.0;
+            return;
+        }
+
+        for (int i = 0; i < length; i++)
+        {
+            window[i] = 0.5 - (0.5 * cos(2 * Pi * i / (length - 1)));
+        }
+    }
+
+    void WindowSegments(const double* interleavedIq, int segmentLength, int hop, int segmentCount, const double* window, fftw_complex* out)
+    {
+        WindowSegmentsT(interleavedIq, segmentLength, hop, segmentCount, window, out);
+    }
+
+    void WindowSegments(const float* interleavedIq, int segmentLength, int hop, int segmentCount, const float* window, fftwf_complex* out)
+    {
+        WindowSegmentsT(interleavedIq, segmentLength, hop, segmentCount, window, out);
+    }
+
+    void Multiply(const double* a, const double* b, double* out, size_t count)
+    {
+        MultiplyT(a, b, out, count);
+    }
+
+    void Multiply(const float* a, const float* b, float* out, size_t count)
+    {
+        MultiplyT(a, b, out, count);
+    }
+
+    void Scale(double* data, size_t count, double factor)
+    {
+        ScaleT(data, count, factor);
+    }
+
+    void Scale(float* data, size_t count, float factor)
+    {
+        ScaleT(data, count, factor);
+    }
+
+    void Widen(const float* in, double* out, size_t count)
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            out[i] = in[i];
+        }
+    }
+
+    void Narrow(const double* in, float* out, size_t count)
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            out[i] = static_cast<float>(in[i]);
+        }
+    }
+
+    void ConvertSc16(const short* interleavedIq, size_t count, double scale, fftw_complex* out)
+    {
+        double* dst = reinterpret_cast<double*>(out);
+
+        for (size_t i = 0; i < 2 * count; i++)
+        {
+            dst[i] = scale * interleavedIq[i];
+        }
+    }
+
+    void AccumulateShiftedPower(const fftw_complex* x, int length, double scale, double* psd)
+    {
+        int half = length / 2;
+
+        // Same index mapping as FeatureVectorProcessor.ProcessData, the upper half of the FFT goes first
+        for (int i = 0; i < half; i++)
+        {
+            const double* c = x[i + half];
+            psd[i] += scale * ((c[0] * c[0]) + (c[1] * c[1]));
+        }
+
+        for (int i = half; i < length; i++)
+        {
+            const double* c = x[i - half];
+            psd[i] += scale * ((c[0] * c[0]) + (c[1] * c[1]));
+        }
+    }
+
+    void AccumulateShiftedPowerStats(const fftw_complex* x, int length, double scale, int* count, double* sum, double* min, double* max)
+    {
+        AccumulateShiftedPowerStatsT(x, length, scale, count, sum, min, max);
+    }
+
+    void AccumulateShiftedPowerStats(const fftwf_complex* x, int length, double scale, int* count, double* sum, double* min, double* max)
+    {
+        AccumulateShiftedPowerStatsT(x, length, scale, count, sum, min, max);
+    }
+
+    void GoertzelPowerStats(const double* interleavedIq, int length, const double* window, const double* omega, int bins, double scale, int* count, double* sum, double* min, double* max)
+    {
+        GoertzelPowerStatsT(interleavedIq, length, window, omega, bins, scale, count, sum, min, max);
+    }
+
+    void GoertzelPowerStats(const float* interleavedIq, int length, const float* window, const double* omega, int bins, double scale, int* count, double* sum, double* min, double* max)
+    {
+        GoertzelPowerStatsT(interleavedIq, length, window, omega, bins, scale, count, sum, min, max);
+    }
+}}
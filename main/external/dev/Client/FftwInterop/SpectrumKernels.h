@@ -0,0 +1,83 @@
+// SpectrumKernels.h
+//
+// Native (unmanaged) building blocks for the spectral estimators exposed by FftwInterop.
+// SpectrumKernels.cpp is compiled without /clr so the per-sample loops run as optimized native code
+// rather than MSIL.
+
+#pragma once
+
+#include <cstddef>
+#include "fftw3.h"
+
+namespace FftwInterop { namespace Kernels {
+
+    // Fills window[0..length) with the same symmetric Hann window MathLibrary.GetWindowFunction produces
+    // (0.5 - 0.5 * cos(2 * pi * n / (length - 1))), but one value per complex sample instead of per double.
+    void HannWindow(double* window, int length);
+
+    // Prototype low pass filter for a polyphase filter bank with branches branches and taps taps per branch:
+    // a Blackman-Harris windowed sinc with its cutoff at one bin (1 / branches), branches * taps coefficients,
+    // normalized to sum to branches so a tone comes out of the filter bank with the same amplitude as out of a
+    // window compensated FFT.
+    void PolyphasePrototype(double* filter, int branches, int taps);
+
+    // The polyphase front end of the filter bank: out[m] = sum over t of in[m + t * branches] * filter[m + t * branches]
+    // for m in [0, branches), reading branches * taps interleaved I/Q samples.
+    void PolyphaseFold(const double* interleavedIq, int branches, int taps, const double* filter, fftw_complex* out);
+
+    void PolyphaseFold(const float* interleavedIq, int branches, int taps, const float* filter, fftwf_complex* out);
+
+    // Zoom FFT front end: out[m] = window[m] * e^(-j * omega * m * decimation) * sum over k of filter[k] * in[m * decimation + k]
+    // for m in [0, outputLength). filter is the low pass prototype already shifted to omega (radians per input
+    // sample), so this mixes the band at omega down to DC, low pass filters and decimates in one pass, and only
+    // computes the outputs that are kept.
+    void ZoomDecimate(const double* interleavedIq, int decimation, const fftw_complex* filter, int taps, double omega, const double* window, fftw_complex* out, int outputLength);
+
+    // Copies segmentCount overlapping segments of segmentLength complex samples out of the interleaved
+    // I/Q input into out, advancing hop samples between segments, and applies the window to each of them.
+    void WindowSegments(const double* interleavedIq, int segmentLength, int hop, int segmentCount, const double* window, fftw_complex* out);
+
+    void WindowSegments(const float* interleavedIq, int segmentLength, int hop, int segmentCount, const float* window, fftwf_complex* out);
+
+    // out[i] = a[i] * b[i] for count doubles. out may alias a.
+    void Multiply(const double* a, const double* b, double* out, size_t count);
+
+    void Multiply(const float* a, const float* b, float* out, size_t count);
+
+    // data[i] *= factor for count doubles
+    void Scale(double* data, size_t count, double factor);
+
+    void Scale(float* data, size_t count, float factor);
+
+    // Precision conversions between the fc32 receive / FFT path and the double precision managed side
+    void Widen(const float* in, double* out, size_t count);
+
+    void Narrow(const double* in, float* out, size_t count);
+
+    // UHD's sc16 CPU format (interleaved 16 bit I/Q) to complex samples, scaled in the same pass: out = scale * in
+    // for the 2 * count values. The float version converts 4 samples per SSE2 instruction.
+    void ConvertSc16(const short* interleavedIq, size_t count, float scale, fftwf_complex* out);
+
+    void ConvertSc16(const short* interleavedIq, size_t count, double scale, fftw_complex* out);
+
+    // Adds scale * |x[k]|^2 to psd with the two halves of the FFT swapped, so psd runs from the most negative
+    // frequency up to the most positive one (the same ordering FeatureVectorProcessor.ProcessData uses).
+    void AccumulateShiftedPower(const fftw_complex* x, int length, double scale, double* psd);
+
+    // The feature vector version of AccumulateShiftedPower: for every shifted bin k, with p = scale * |x|^2,
+    // count[k]++, sum[k] += p, and min[k] / max[k] track the extremes. Same bookkeeping as
+    // FeatureVectorProcessor.ProcessData(double, int).
+    void AccumulateShiftedPowerStats(const fftw_complex* x, int length, double scale, int* count, double* sum, double* min, double* max);
+
+    // Single precision spectrum, the power is formed and accumulated in double precision
+    void AccumulateShiftedPowerStats(const fftwf_complex* x, int length, double scale, int* count, double* sum, double* min, double* max);
+
+    // Goertzel evaluation of a few frequencies instead of a whole FFT: for each of the bins frequencies omega[b]
+    // (radians per sample, any value, not only multiples of 2 pi / length), X = sum over n of window[n] * in[n] * e^(-j * omega[b] * n)
+    // over length interleaved I/Q samples, then p = scale * |X|^2 is accumulated into count / sum / min / max [b]
+    // like AccumulateShiftedPowerStats. Costs length * bins multiply-adds, so it beats an FFT while bins is below
+    // about log2(length).
+    void GoertzelPowerStats(const double* interleavedIq, int length, const double* window, const double* omega, int bins, double scale, int* count, double* sum, double* min, double* max);
+
+    void GoertzelPowerStats(const float* interleavedIq, int length, const float* window, const double* omega, int bins, double scale, int* count, double* sum, double* min, double* max);
+}}
@@ -0,0 +1,176 @@
+// SpectrumPipeline.h
+
+#pragma once
+
+#include "fftw3.h"
+#include "FftwPlanHandle.h"
+#include "FftwWisdom.h"
+#include "ISpectrumAccumulator.h"
+#include "SampleBuffer.h"
+#include "SampleBufferF.h"
+#include "SpectrumKernels.h"
+
+using namespace System;
+using namespace System::Diagnostics;
+
+namespace FftwInterop {
+
+    // The per-block periodogram path of the scanner in one native call: window, FFT, amplitude compensation,
+    // |X|^2 / N^2, fftshift and the min / max / average bookkeeping of the feature vectors.
+    //
+    // The input is read once (while windowing into the aligned work buffer), the FFT runs in place on that
+    // buffer, and the power of each bin goes straight into the caller's accumulators. Nothing is allocated
+    // per block, the accumulator arrays are only pinned for the duration of the call.
+    //
+    // In single precision (fc32 samples in SampleBufferF) the window and the FFT run with fftwf_, only the power
+    // and the accumulators are double.
+    public ref class SpectrumPipeline : ISpectrumAccumulator
+    {
+        private:
+            FftwPlanHandle^ plan;
+            ISampleBuffer^ work;
+            double* window;
+            float* windowF;
+            double scale;
+
+            void Initialize(int fftLength, array<double>^ window, double amplitudeCompensation, SamplePrecision precision)
+            {
+                if (fftLength < 2)
+                {
+                    throw gcnew ArgumentOutOfRangeException("fftLength");
+                }
+
+                if (window == nullptr || window->Length != fftLength)
+                {
+                    throw gcnew ArgumentException("The window needs one factor per complex sample", "window");
+                }
+
+                this->window = static_cast<double*>(fftw_malloc(sizeof(double) * fftLength));
+                this->windowF = static_cast<float*>(fftw_malloc(sizeof(float) * fftLength));
+                if (this->window == NULL || this->windowF == NULL)
+                {
+                    throw gcnew OutOfMemoryException("Unable to allocate the window");
+                }
+
+                pin_ptr<double> mpWindow = &window[0];
+                memcpy(this->window, mpWindow, sizeof(double) * fftLength);
+                Kernels::Narrow(this->window, this->windowF, fftLength);
+
+                // Same normalization as FeatureVectorProcessor.ProcessData applied to a compensated FFT
+                double n = fftLength;
+                scale = (amplitudeCompensation * amplitudeCompensation) / (n * n);
+
+                if (precision == SamplePrecision::Single)
+                {
+                    work = gcnew SampleBufferF(fftLength);
+                }
+                else
+                {
+                    work = gcnew SampleBuffer(fftLength);
+                }
+
+                plan = gcnew FftwPlanHandle(PlanKey(fftLength, precision));
+            }
+
+        public:
+            literal unsigned int PlanFlags = FFTW_MEASURE;
+
+            // window holds one factor per complex sample (fftLength of them). amplitudeCompensation is the
+            // window's amplitude correction (MathLibrary.GetWindowCompensationFactor).
+            SpectrumPipeline(int fftLength, array<double>^ window, double amplitudeCompensation)
+            {
+                Initialize(fftLength, window, amplitudeCompensation, SamplePrecision::Double);
+            }
+
+            SpectrumPipeline(int fftLength, array<double>^ window, double amplitudeCompensation, SamplePrecision precision)
+            {
+                Initialize(fftLength, window, amplitudeCompensation, precision);
+            }
+
+            ~SpectrumPipeline()
+            {
+                this->!SpectrumPipeline();
+                delete plan;
+                delete work;
+            }
+
+            !SpectrumPipeline()
+            {
+                fftw_free(window);
+                window = NULL;
+
+                fftw_free(windowF);
+                windowF = NULL;
+            }
+
+            static FftwPlanKey PlanKey(int fftLength, SamplePrecision precision)
+            {
+                return FftwPlanKey(fftLength, 1, FFTW_FORWARD, PlanFlags, precision);
+            }
+
+            virtual property int FftLength
+            {
+                int get() { return work->Length; }
+            }
+
+            virtual property int SamplesPerBlock
+            {
+                int get() { return work->Length; }
+            }
+
+            virtual property SamplePrecision Precision
+            {
+                SamplePrecision get() { return work->Precision; }
+            }
+
+            // Transforms FftLength samples of samples starting at sampleOffset and accumulates bin k of the
+            // shifted power spectrum into count / sum / min / max [binOffset + k]. samples must have the
+            // pipeline's precision.
+            virtual void Accumulate(ISampleBuffer^ samples, int sampleOffset, array<int>^ count, array<double>^ sum, array<double>^ min, array<double>^ max, int binOffset)
+            {
+                if (sampleOffset < 0 || sampleOffset + FftLength > samples->Length)
+                {
+                    throw gcnew ArgumentOutOfRangeException("sampleOffset");
+                }
+
+                int length = FftLength;
+
+                if (binOffset < 0 || binOffset + length > count->Length || binOffset + length > sum->Length
+                    || binOffset + length > min->Length || binOffset + length > max->Length)
+                {
+                    throw gcnew ArgumentOutOfRangeException("binOffset");
+                }
+
+                if (samples->Precision != Precision)
+                {
+                    throw gcnew ArgumentException("The samples do not have the precision of the pipeline", "samples");
+                }
+
+                pin_ptr<int> mpCount = &count[binOffset];
+                pin_ptr<double> mpSum = &sum[binOffset];
+                pin_ptr<double> mpMin = &min[binOffset];
+                pin_ptr<double> mpMax = &max[binOffset];
+
+                Debug::Assert(plan != nullptr);
+
+                if (Precision == SamplePrecision::Single)
+                {
+                    fftwf_complex* wp = safe_cast<SampleBufferF^>(work)->NativePointer;
+                    const float* in = reinterpret_cast<float*>(safe_cast<SampleBufferF^>(samples)->NativePointer + sampleOffset);
+
+                    Kernels::WindowSegments(in, length, length, 1, windowF, wp);
+                    plan->Execute(wp);
+                    Kernels::AccumulateShiftedPowerStats(wp, length, scale, mpCount, mpSum, mpMin, mpMax);
+                }
+                else
+                {
+                    fftw_complex* wp = safe_cast<SampleBuffer^>(work)->NativePointer;
+                    const double* in = reinterpret_cast<double*>(safe_cast<SampleBuffer^>(samples)->NativePointer + sampleOffset);
+
+                    Kernels::WindowSegments(in, length, length, 1, window, wp);
+                    plan->Execute(wp);
+                    Kernels::AccumulateShiftedPowerStats(wp, length, scale, mpCount, mpSum, mpMin, mpMax);
+                }
+            }
+    };
+}
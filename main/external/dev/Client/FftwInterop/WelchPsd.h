@@ -0,0 +1,152 @@
+// WelchPsd.h
+
+#pragma once
+
+#include "fftw3.h"
+#include "FftwPlanHandle.h"
+#include "FftwWisdom.h"
+#include "SpectrumKernels.h"
+
+using namespace System;
+using namespace System::Diagnostics;
+
+namespace FftwInterop {
+
+    // Welch power spectral density estimator.
+    //
+    // A capture is cut into numberOfWindows overlapping segments of samplesPerWindow samples, each segment is
+    // Hann windowed, all of them are transformed by a single fftw_plan_many_dft plan, and the periodograms are
+    // averaged. The result uses the same scaling (window compensation, 1/N^2) and the same bin order as
+    // FeatureVectorProcessor.ProcessData, so it can go straight into the feature vectors.
+    public ref class WelchPsd : IDisposable
+    {
+        private:
+            // Amplitude compensation for the Hann window, see MathLibrary.GetWindowCompensationFactor
+            literal double HannCompensation = 2.0;
+
+            FftwPlanHandle^ planMany;
+            fftw_complex* segments;
+            double* window;
+            int samplesPerWindow;
+            int numberOfWindows;
+            int hop;
+
+            static int HopLength(int samplesPerWindow, double overlap)
+            {
+                int hop = samplesPerWindow - static_cast<int>(samplesPerWindow * overlap);
+
+                return hop < 1 ? 1 : hop;
+            }
+
+        public:
+            literal unsigned int PlanFlags = FFTW_MEASURE;
+
+            WelchPsd(int samplesPerWindow, int numberOfWindows, double overlap)
+            {
+                if (samplesPerWindow < 2)
+                {
+                    throw gcnew ArgumentOutOfRangeException("samplesPerWindow");
+                }
+
+                if (numberOfWindows < 1)
+                {
+                    throw gcnew ArgumentOutOfRangeException("numberOfWindows");
+                }
+
+                if (overlap < 0 || overlap >= 1)
+                {
+                    throw gcnew ArgumentOutOfRangeException("overlap", "The overlap is a fraction of a window and must be in [0, 1)");
+                }
+
+                this->samplesPerWindow = samplesPerWindow;
+                this->numberOfWindows = numberOfWindows;
+                this->hop = HopLength(samplesPerWindow, overlap);
+
+                segments = static_cast<fftw_complex*>(fftw_malloc(sizeof(fftw_complex) * samplesPerWindow * numberOfWindows));
+                window = static_cast<double*>(fftw_malloc(sizeof(double) * samplesPerWindow));
+                Kernels::HannWindow(window, samplesPerWindow);
+
+                // One plan for all of the windows: window i lives at segments[i * samplesPerWindow], transformed in place.
+                // The buffer is ours and came from fftw_malloc, so there is no need for FFTW_UNALIGNED here.
+                planMany = gcnew FftwPlanHandle(PlanKey(samplesPerWindow, numberOfWindows));
+            }
+
+            ~WelchPsd()
+            {
+                this->!WelchPsd();
+                delete planMany;
+            }
+
+            !WelchPsd()
+            {
+                fftw_free(segments);
+                segments = NULL;
+
+                fftw_free(window);
+                window = NULL;
+            }
+
+            static FftwPlanKey PlanKey(int samplesPerWindow, int numberOfWindows)
+            {
+                return FftwPlanKey(samplesPerWindow, numberOfWindows, FFTW_FORWARD, PlanFlags);
+            }
+
+            // Number of complex samples a capture needs to fill every window
+            static int RequiredSamples(int samplesPerWindow, int numberOfWindows, double overlap)
+            {
+                return (HopLength(samplesPerWindow, overlap) * (numberOfWindows - 1)) + samplesPerWindow;
+            }
+
+            property int SamplesPerWindow
+            {
+                int get() { return samplesPerWindow; }
+            }
+
+            property int NumberOfWindows
+            {
+                int get() { return numberOfWindows; }
+            }
+
+            property int SamplesPerCapture
+            {
+                int get() { return (hop * (numberOfWindows - 1)) + samplesPerWindow; }
+            }
+
+            // interleavedIq holds SamplesPerCapture complex samples as I, Q, I, Q, ...
+            // psd receives SamplesPerWindow averaged, fft-shifted power values
+            void Compute(array<double>^ interleavedIq, array<double>^ psd)
+            {
+                Debug::Assert(planMany != nullptr);
+
+                if (interleavedIq->Length < 2 * SamplesPerCapture)
+                {
+                    throw gcnew ArgumentException(String::Format("Expected at least {0} interleaved samples", 2 * SamplesPerCapture), "interleavedIq");
+                }
+
+                if (psd->Length != samplesPerWindow)
+                {
+                    throw gcnew ArgumentException(String::Format("Expected {0} power values", samplesPerWindow), "psd");
+                }
+
+                pin_ptr<double> mpIq = &interleavedIq[0];
+                pin_ptr<double> mpPsd = &psd[0];
+                double* npPsd = mpPsd;
+
+                Kernels::WindowSegments(mpIq, samplesPerWindow, hop, numberOfWindows, window, segments);
+                planMany->Execute(segments);
+
+                for (int i = 0; i < samplesPerWindow; i++)
+                {
+                    npPsd[i] = 0;
+                }
+
+                double n = samplesPerWindow;
+                double scale = (HannCompensation * HannCompensation) / (n * n * numberOfWindows);
+
+                for (int i = 0; i < numberOfWindows; i++)
+                {
+                    Kernels::AccumulateShiftedPower(segments + (i * samplesPerWindow), samplesPerWindow, scale, npPsd);
+                }
+            }
+    };
+}
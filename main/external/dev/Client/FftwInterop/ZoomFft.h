@@ -0,0 +1,172 @@
+// ZoomFft.h
+
+#pragma once
+
+#include <cmath>
+#include "fftw3.h"
+#include "FftSizes.h"
+#include "FftwInterop.h"
+#include "FftwPlanHandle.h"
+#include "SampleBuffer.h"
+#include "SpectrumKernels.h"
+
+using namespace System;
+using namespace System::Diagnostics;
+using namespace System::Numerics;
+
+namespace FftwInterop {
+
+    // Zoom FFT (digital down conversion followed by a small FFT) for looking at a narrow band of a capture.
+    //
+    // The band around a given frequency is mixed down to DC, low pass filtered to 1 / decimation of the sample
+    // rate and decimated (Kernels::ZoomDecimate), then Hann windowed and transformed with an FFT that is
+    // decimation times smaller than the capture. The result has the same bin spacing a full size FFT would
+    // have over the narrow band, for a fraction of the work. An instance is specific to one decimation factor,
+    // callers keep one per factor (see UsrpDevice.PerformFFTForCenterFrequency).
+    public ref class ZoomFft : IDisposable
+    {
+        private:
+            literal double Pi = 3.14159265358979323846;
+
+            FftwPlanHandle^ plan;
+            SampleBuffer^ work;
+            double* prototype;
+            fftw_complex* bandFilter;
+            double* window;
+            int inputLength;
+            int decimation;
+            int taps;
+
+        public:
+            // Length of the anti-aliasing filter in output samples
+            literal int TapsPerDecimation = 8;
+
+            // Amplitude compensation of the Hann window, see MathLibrary.GetWindowCompensationFactor
+            literal double WindowCompensation = 2.0;
+
+            ZoomFft(int inputLength, int decimation)
+            {
+                if (decimation < 1)
+                {
+                    throw gcnew ArgumentOutOfRangeException("decimation");
+                }
+
+                this->inputLength = inputLength;
+                this->decimation = decimation;
+                this->taps = TapsPerDecimation * decimation;
+
+                int outputLength = OutputLengthFor(inputLength, decimation);
+                if (outputLength < 2)
+                {
+                    throw gcnew ArgumentOutOfRangeException("decimation", String::Format("{0} samples are too few to decimate by {1}", inputLength, decimation));
+                }
+
+                prototype = static_cast<double*>(fftw_malloc(sizeof(double) * taps));
+                bandFilter = static_cast<fftw_complex*>(fftw_malloc(sizeof(fftw_complex) * taps));
+                window = static_cast<double*>(fftw_malloc(sizeof(double) * outputLength));
+                if (prototype == NULL || bandFilter == NULL || window == NULL)
+                {
+                    throw gcnew OutOfMemoryException("Unable to allocate the zoom FFT filters");
+                }
+
+                // The polyphase prototype with decimation branches has its cutoff at the decimated Nyquist
+                // frequency. It sums to decimation, scale it to unity gain at DC.
+                Kernels::PolyphasePrototype(prototype, decimation, TapsPerDecimation);
+                Kernels::Scale(prototype, taps, 1.0 / decimation);
+
+                Kernels::HannWindow(window, outputLength);
+
+                work = gcnew SampleBuffer(outputLength);
+                plan = gcnew FftwPlanHandle(PlanKey(outputLength));
+            }
+
+            ~ZoomFft()
+            {
+                this->!ZoomFft();
+                delete plan;
+                delete work;
+            }
+
+            !ZoomFft()
+            {
+                fftw_free(prototype);
+                prototype = NULL;
+
+                fftw_free(bandFilter);
+                bandFilter = NULL;
+
+                fftw_free(window);
+                window = NULL;
+            }
+
+            // Number of bins produced from inputLength samples: the largest fast FFT size (see FftSizes.h) not above
+            // the number of decimated samples that have a full filter history inside the capture. The filter
+            // history makes the raw count awkward (505 for 4096 / 8), so the few decimated samples past the FFT size
+            // are dropped rather than transformed at a slow size.
+            static int OutputLengthFor(int inputLength, int decimation)
+            {
+                int decimated = ((inputLength - (TapsPerDecimation * decimation)) / decimation) + 1;
+
+                while (decimated > 1 && !Sizes::IsFastSize(decimated))
+                {
+                    decimated--;
+                }
+
+                return decimated;
+            }
+
+            static FftwPlanKey PlanKey(int outputLength)
+            {
+                return Fftw::PlanKey(outputLength);
+            }
+
+            property int InputLength
+            {
+                int get() { return inputLength; }
+            }
+
+            property int Decimation
+            {
+                int get() { return decimation; }
+            }
+
+            property int OutputLength
+            {
+                int get() { return work->Length; }
+            }
+
+            // interleavedIq holds at least InputLength complex samples. normalizedFrequency is the center of the band
+            // of interest in cycles per sample (offset from the tuned frequency / sample rate, 0 = the tuned
+            // frequency). spectrum receives OutputLength window compensated bins in FFTW order (not shifted),
+            // like UsrpDevice.PerformFFT.
+            void Transform(array<double>^ interleavedIq, double normalizedFrequency, array<Complex>^ spectrum)
+            {
+                if (interleavedIq->Length < SampleBuffer::ComplexWidth * inputLength)
+                {
+                    throw gcnew ArgumentException(String::Format("Expected at least {0} interleaved samples", SampleBuffer::ComplexWidth * inputLength), "interleavedIq");
+                }
+
+                if (spectrum->Length != OutputLength)
+                {
+                    throw gcnew ArgumentException(String::Format("Expected {0} bins", OutputLength), "spectrum");
+                }
+
+                double omega = 2 * Pi * normalizedFrequency;
+                for (int k = 0; k < taps; k++)
+                {
+                    bandFilter[k][0] = prototype[k] * cos(-omega * k);
+                    bandFilter[k][1] = prototype[k] * sin(-omega * k);
+                }
+
+                fftw_complex* wp = work->NativePointer;
+
+                pin_ptr<double> mpIq = &interleavedIq[0];
+                Kernels::ZoomDecimate(mpIq, decimation, bandFilter, taps, omega, window, wp, OutputLength);
+
+                plan->Execute(wp);
+
+                work->Scale(WindowCompensation);
+                work->CopyTo(spectrum);
+            }
+    };
+}
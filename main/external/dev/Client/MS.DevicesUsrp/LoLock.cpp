@@ -0,0 +1,53 @@
+// LoLock.cpp
+
+#include <thread>
+#include <uhd/types/sensors.hpp>
+#include <uhd/types/time_spec.hpp>
+#include "LoLock.h"
+
+using namespace uhd;
+
+namespace Microsoft { namespace Spectrum { namespace Devices { namespace Usrp { namespace Native {
+
+    // The pause between polls starts short, a synthesizer usually locks within a few hundred microseconds, and
+    // doubles up to the longest pause
+    static const double FirstPollDelay = 20e-6;
+    static const double LongestPollDelay = 500e-6;
+
+    // Yields until the system time passes until. A sleep would last at least a scheduler tick on Windows (up to
+    // 15.6 ms), far longer than the lock takes, so the pauses are spent yielding instead.
+    static void PauseUntil(const time_spec_t& until)
+    {
+        while (time_spec_t::get_system_time() < until)
+        {
+            std::this_thread::yield();
+        }
+    }
+
+    double WaitForLoLock(usrp::multi_usrp& usrp, size_t chan, double timeout)
+    {
+        // get_system_time uses the high resolution performance counter
+        const time_spec_t start = time_spec_t::get_system_time();
+        const time_spec_t deadline = start + time_spec_t(timeout);
+        double delay = FirstPollDelay;
+
+        while (true)
+        {
+            if (usrp.get_rx_sensor("lo_locked", chan).to_bool())
+            {
+                return (time_spec_t::get_system_time() - start).get_real_secs();
+            }
+
+            time_spec_t now = time_spec_t::get_system_time();
+            if (now >= deadline)
+            {
+                return -1;
+            }
+
+            time_spec_t next = now + time_spec_t(delay);
+            PauseUntil(next < deadline ? next : deadline);
+
+            delay = delay * 2 < LongestPollDelay ? delay * 2 : LongestPollDelay;
+        }
+    }
+}}}}}
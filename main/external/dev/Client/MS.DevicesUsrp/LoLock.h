@@ -0,0 +1,13 @@
+#pragma once
+
+// Native LO lock polling. LoLock.cpp is compiled as native code because <thread> can't be used under /clr.
+
+#include <uhd/usrp/multi_usrp.hpp>
+
+namespace Microsoft { namespace Spectrum { namespace Devices { namespace Usrp { namespace Native {
+
+    // Polls the "lo_locked" sensor of chan until it reads true or timeout seconds passed, reading it with
+    // sensor_value_t::to_bool so no string crosses into managed code. Returns the seconds it took to lock, or a
+    // negative value if it didn't lock in time. The sensor is read at least once, even with a timeout of 0.
+    double WaitForLoLock(uhd::usrp::multi_usrp& usrp, size_t chan, double timeout);
+}}}}}
\ No newline at end of file
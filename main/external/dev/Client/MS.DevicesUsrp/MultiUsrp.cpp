@@ -2,10 +2,14 @@
 
 #include "stdafx.h"
 #include <msclr\marshal_cppstd.h>
+#include <uhd\exception.hpp>
 #include <uhd\utils\msg.hpp>
 #include <string>
 #include <iostream>
 #include "MultiUsrp.h"
+#include "LoLock.h"
+#include "ReplayUsrp.h"
+#include "Snapshot.h"
 
 using namespace Microsoft::Spectrum::Devices::Usrp;
 using namespace msclr::interop;
@@ -29,7 +33,16 @@ MultiUsrp::MultiUsrp(DeviceAddr^ args)
     }
 
     pUsrp = new boost::shared_ptr<multi_usrp>();
-    multi_usrp::make(devices).swap(*pUsrp);
+    pCalibration = new Native::RxCalibration();
+
+    if (Native::ReplayUsrp::IsReplay(devices))
+    {
+        pUsrp->reset(new Native::ReplayUsrp(devices));
+    }
+    else
+    {
+        multi_usrp::make(devices).swap(*pUsrp);
+    }
 
 	uhd::msg::register_handler(&msg_handler);
 }
@@ -42,6 +55,44 @@ MultiUsrp::~MultiUsrp()
 MultiUsrp::!MultiUsrp()
 {
     delete pUsrp;
+    pUsrp = NULL;
+
+    delete pCalibration;
+    pCalibration = NULL;
+}
+
+bool MultiUsrp::is_replay::get()
+{
+    return boost::dynamic_pointer_cast<Native::ReplayUsrp>(*pUsrp) != NULL;
+}
+
+void MultiUsrp::add_replay_capture(double centerFreq, cli::array<double>^ interleavedIq)
+{
+    boost::shared_ptr<Native::ReplayUsrp> replay = boost::dynamic_pointer_cast<Native::ReplayUsrp>(*pUsrp);
+    if (replay == NULL)
+    {
+        throw gcnew InvalidOperationException("Captures can only be added to a replay device (type=replay)");
+    }
+
+    if (interleavedIq == nullptr)
+    {
+        throw gcnew ArgumentNullException("interleavedIq");
+    }
+
+    std::vector<std::complex<float> > samples(interleavedIq->Length / 2);
+    for (size_t i = 0; i < samples.size(); i++)
+    {
+        samples[i] = std::complex<float>(static_cast<float>(interleavedIq[static_cast<int>(2 * i)]), static_cast<float>(interleavedIq[static_cast<int>((2 * i) + 1)]));
+    }
+
+    try
+    {
+        replay->AddCapture(centerFreq, samples);
+    }
+    catch (const uhd::value_error& e)
+    {
+        throw gcnew ArgumentException(marshal_as<String^>(std::string(e.what())), "interleavedIq");
+    }
 }
 
 RxStreamer^ MultiUsrp::get_rx_stream(StreamArgs^ mArgs)
@@ -51,12 +102,24 @@ RxStreamer^ MultiUsrp::get_rx_stream(StreamArgs^ mArgs)
 
     stream_args_t nArgs(marshal_as<string>(cpuFormat), marshal_as<string>(otwFormat));
 
-    for each (String^ key in mArgs->Args->Keys)
+    if (mArgs->Args != nullptr)
+    {
+        for each (String^ key in mArgs->Args->Keys)
+        {
+            nArgs.args.set(marshal_as<string>(key), marshal_as<string>(mArgs->Args[key]));
+        }
+    }
+
+    // Without a channel list UHD streams channel 0 only
+    if (mArgs->Channels != nullptr)
     {
-        nArgs.args.set(marshal_as<string>(key), marshal_as<string>(mArgs->Args[key]));
+        for each (size_t channel in mArgs->Channels)
+        {
+            nArgs.channels.push_back(channel);
+        }
     }
-    
-    return gcnew RxStreamer((*pUsrp)->get_rx_stream(nArgs));
+
+    return gcnew RxStreamer((*pUsrp)->get_rx_stream(nArgs), nArgs.cpu_format);
 }
 
 Dictionary<String^, String^>^ MultiUsrp::get_usrp_rx_info(size_t chan)
@@ -78,6 +141,113 @@ String^ MultiUsrp::get_pp_string()
     return marshal_as<String^>((*pUsrp)->get_pp_string());
 }
 
+UsrpSnapshot^ MultiUsrp::snapshot()
+{
+    Native::DeviceSnapshot nSnapshot;
+    Native::TakeSnapshot(**pUsrp, nSnapshot);
+
+    UsrpSnapshot^ ret = gcnew UsrpSnapshot();
+    ret->PpString = marshal_as<String^>(nSnapshot.ppString);
+    ret->TimeSynchronized = nSnapshot.timeSynchronized;
+    ret->Mboards = gcnew List<MboardSnapshot^>(static_cast<int>(nSnapshot.mboards.size()));
+    ret->RxChannels = gcnew List<RxChannelSnapshot^>(static_cast<int>(nSnapshot.channels.size()));
+
+    for (size_t m = 0; m < nSnapshot.mboards.size(); m++)
+    {
+        const Native::MboardSnapshot& nMboard = nSnapshot.mboards[m];
+        MboardSnapshot^ mboard = gcnew MboardSnapshot();
+        mboard->Name = marshal_as<String^>(nMboard.name);
+        mboard->TimeSources = ToStrings(nMboard.timeSources);
+        mboard->TimeSource = marshal_as<String^>(nMboard.timeSource);
+        mboard->ClockSources = ToStrings(nMboard.clockSources);
+        mboard->ClockSource = marshal_as<String^>(nMboard.clockSource);
+        mboard->Sensors = ToSensorValues(nMboard.sensors);
+        mboard->RxSubdevSpec = gcnew List<SubDevSpecPair^>();
+
+        for each (subdev_spec_pair_t pair in nMboard.rxSubdevSpec)
+        {
+            mboard->RxSubdevSpec->Add(gcnew SubDevSpecPair(marshal_as<String^>(pair.db_name), marshal_as<String^>(pair.sd_name)));
+        }
+
+        ret->Mboards->Add(mboard);
+    }
+
+    for (size_t c = 0; c < nSnapshot.channels.size(); c++)
+    {
+        const Native::RxChannelSnapshot& nChannel = nSnapshot.channels[c];
+        RxChannelSnapshot^ channel = gcnew RxChannelSnapshot();
+        channel->SubdevName = marshal_as<String^>(nChannel.subdevName);
+        channel->Rate = nChannel.rate;
+        channel->FeFreqRange = ToRanges(nChannel.feFreqRange);
+        channel->FreqRange = ToRanges(nChannel.freqRange);
+        channel->Freq = nChannel.freq;
+        channel->Gains = gcnew List<RxGainSnapshot^>(static_cast<int>(nChannel.gains.size()));
+        channel->GainRange = ToRanges(nChannel.gainRange);
+        channel->Gain = nChannel.gain;
+        channel->Antennas = ToStrings(nChannel.antennas);
+        channel->Antenna = marshal_as<String^>(nChannel.antenna);
+        channel->BandwidthRange = ToRanges(nChannel.bandwidthRange);
+        channel->Bandwidth = nChannel.bandwidth;
+        channel->Sensors = ToSensorValues(nChannel.sensors);
+
+        for (size_t g = 0; g < nChannel.gains.size(); g++)
+        {
+            const Native::RxGainSnapshot& nGain = nChannel.gains[g];
+            RxGainSnapshot^ gain = gcnew RxGainSnapshot();
+            gain->Name = marshal_as<String^>(nGain.name);
+            gain->GainRange = ToRanges(nGain.range);
+            gain->Gain = nGain.gain;
+
+            channel->Gains->Add(gain);
+        }
+
+        ret->RxChannels->Add(channel);
+    }
+
+    return ret;
+}
+
+List<Range^>^ MultiUsrp::ToRanges(const meta_range_t& ranges)
+{
+    List<Range^>^ ret = gcnew List<Range^>(static_cast<int>(ranges.size()));
+
+    for each (range_t range in ranges)
+    {
+        ret->Add(gcnew Range(range.start(), range.stop(), range.step()));
+    }
+
+    return ret;
+}
+
+List<String^>^ MultiUsrp::ToStrings(const vector<string>& strings)
+{
+    List<String^>^ ret = gcnew List<String^>(static_cast<int>(strings.size()));
+
+    for each (string s in strings)
+    {
+        ret->Add(marshal_as<String^>(s));
+    }
+
+    return ret;
+}
+
+List<SensorValue^>^ MultiUsrp::ToSensorValues(const vector<sensor_value_t>& values)
+{
+    List<SensorValue^>^ ret = gcnew List<SensorValue^>(static_cast<int>(values.size()));
+
+    for each (sensor_value_t value in values)
+    {
+        SensorValue^ sensor = gcnew SensorValue();
+        sensor->Name = marshal_as<String^>(value.name);
+        sensor->Unit = marshal_as<String^>(value.unit);
+        sensor->Value = marshal_as<String^>(value.value);
+
+        ret->Add(sensor);
+    }
+
+    return ret;
+}
+
 size_t MultiUsrp::get_num_mboards(void)
 {
     return (*pUsrp)->get_num_mboards();
@@ -99,6 +269,31 @@ void MultiUsrp::set_time_now(const time_spec_t& time_spec, size_t mboard)
     (*pUsrp)->set_time_now(time_spec, mboard);
 }
 
+TimeSpec^ MultiUsrp::get_time_now(size_t mboard)
+{
+    return ToTimeSpec((*pUsrp)->get_time_now(mboard));
+}
+
+TimeSpec^ MultiUsrp::get_time_last_pps(size_t mboard)
+{
+    return ToTimeSpec((*pUsrp)->get_time_last_pps(mboard));
+}
+
+TimeSpec^ MultiUsrp::ToTimeSpec(const time_spec_t& time)
+{
+    return gcnew TimeSpec(time.get_full_secs(), time.get_frac_secs());
+}
+
+void MultiUsrp::set_command_time(TimeSpec^ timeSpec, size_t mboard)
+{
+    (*pUsrp)->set_command_time(time_spec_t(timeSpec->FullSeconds, timeSpec->FractionalSeconds), mboard);
+}
+
+void MultiUsrp::clear_command_time(size_t mboard)
+{
+    (*pUsrp)->clear_command_time(mboard);
+}
+
 bool MultiUsrp::get_time_synchronized()
 {
     return (*pUsrp)->get_time_synchronized();
@@ -279,7 +474,45 @@ TuneResult^ MultiUsrp::set_rx_freq(TuneRequest^ mReq, size_t chan)
 TuneResult^ MultiUsrp::set_rx_freq(tune_request_t tr, size_t chan)
 {
     tune_result_t nResult = (*pUsrp)->set_rx_freq(tr, chan);
-    
+
+    return ToTuneResult(nResult);
+}
+
+ScheduledTune^ MultiUsrp::schedule_rx_tune(double targetFreq, size_t chan, double leadSeconds, double settleSeconds, size_t numSamps)
+{
+    time_spec_t tuneTime = (*pUsrp)->get_time_now() + time_spec_t(leadSeconds);
+    tune_result_t nResult;
+
+    (*pUsrp)->set_command_time(tuneTime);
+    try
+    {
+        nResult = (*pUsrp)->set_rx_freq(tune_request_t(targetFreq), chan);
+    }
+    catch (...)
+    {
+        (*pUsrp)->clear_command_time();
+        throw;
+    }
+
+    (*pUsrp)->clear_command_time();
+
+    stream_cmd_t nCmd(stream_cmd_t::STREAM_MODE_NUM_SAMPS_AND_DONE);
+    nCmd.num_samps = numSamps;
+    nCmd.stream_now = false;
+    nCmd.time_spec = tuneTime + time_spec_t(settleSeconds);
+
+    (*pUsrp)->issue_stream_cmd(nCmd, chan);
+
+    ScheduledTune^ tune = gcnew ScheduledTune();
+    tune->Result = ToTuneResult(nResult);
+    tune->TuneTime = ToTimeSpec(tuneTime);
+    tune->StreamTime = ToTimeSpec(nCmd.time_spec);
+
+    return tune;
+}
+
+TuneResult^ MultiUsrp::ToTuneResult(const tune_result_t& nResult)
+{
     TuneResult^ mResult = gcnew TuneResult();
     mResult->ActualDspFreqHz = nResult.actual_dsp_freq;
     mResult->ActualRfFreqHz = nResult.actual_rf_freq;
@@ -436,6 +669,17 @@ SensorValue^ MultiUsrp::get_rx_sensor(String^ name, size_t chan)
     return ret;
 }
 
+double MultiUsrp::wait_for_lo_lock(size_t chan, double timeout)
+{
+    double elapsed = Native::WaitForLoLock(**pUsrp, chan, timeout);
+    if (elapsed < 0)
+    {
+        throw gcnew TimeoutException(String::Format("The LO of channel {0} did not lock within {1} seconds", chan, timeout));
+    }
+
+    return elapsed;
+}
+
 List<String^>^ MultiUsrp::get_rx_sensor_names(size_t chan)
 {
     vector<string> names = (*pUsrp)->get_rx_sensor_names(chan);
@@ -447,5 +691,82 @@ List<String^>^ MultiUsrp::get_rx_sensor_names(size_t chan)
         ret->Add(marshal_as<String^>(name));
     }
 
+    return ret;
+}
+
+void MultiUsrp::set_rx_dc_offset(bool enb, size_t chan)
+{
+    (*pUsrp)->set_rx_dc_offset(enb, chan);
+}
+
+void MultiUsrp::set_rx_dc_offset(Complex offset, size_t chan)
+{
+    (*pUsrp)->set_rx_dc_offset(std::complex<double>(offset.Real, offset.Imaginary), chan);
+}
+
+void MultiUsrp::set_rx_iq_balance(Complex correction, size_t chan)
+{
+    (*pUsrp)->set_rx_iq_balance(std::complex<double>(correction.Real, correction.Imaginary), chan);
+}
+
+RxCorrection^ MultiUsrp::calibrate_rx_correction(RxStreamer^ streamer, size_t chan, size_t numSamps, double timeout)
+{
+    return RunCalibration(streamer, chan, numSamps, timeout, false);
+}
+
+RxCorrection^ MultiUsrp::apply_rx_correction(RxStreamer^ streamer, size_t chan, size_t numSamps, double timeout)
+{
+    return RunCalibration(streamer, chan, numSamps, timeout, true);
+}
+
+void MultiUsrp::clear_rx_correction_cache()
+{
+    pCalibration->Clear();
+}
+
+RxCorrection^ MultiUsrp::RunCalibration(RxStreamer^ streamer, size_t chan, size_t numSamps, double timeout, bool useCache)
+{
+    if (streamer == nullptr)
+    {
+        throw gcnew ArgumentNullException("streamer");
+    }
+
+    if (streamer->get_num_channels() != 1)
+    {
+        throw gcnew ArgumentException("The calibration needs a streamer of the calibrated channel alone", "streamer");
+    }
+
+    string cpuFormat = marshal_as<string>(streamer->CpuFormat);
+    Native::RxCorrection nCorrection;
+
+    try
+    {
+        if (useCache)
+        {
+            nCorrection = pCalibration->Apply(**pUsrp, **streamer->pStreamer, **streamer->pCounters, cpuFormat, chan, numSamps, timeout);
+        }
+        else
+        {
+            nCorrection = pCalibration->Calibrate(**pUsrp, **streamer->pStreamer, **streamer->pCounters, cpuFormat, chan, numSamps, timeout);
+        }
+    }
+    catch (const uhd::value_error& e)
+    {
+        throw gcnew ArgumentException(marshal_as<String^>(std::string(e.what())));
+    }
+    catch (const uhd::exception& e)
+    {
+        throw gcnew InvalidOperationException(marshal_as<String^>(std::string(e.what())));
+    }
+
+    RxCorrection^ ret = gcnew RxCorrection();
+    ret->DcOffset = Complex(nCorrection.dcOffset.real(), nCorrection.dcOffset.imag());
+    ret->IqBalance = Complex(nCorrection.iqBalance.real(), nCorrection.iqBalance.imag());
+    ret->ResidualDc = nCorrection.residualDc;
+    ret->ResidualImage = nCorrection.residualImage;
+    ret->RemovedDc = nCorrection.removedDc;
+    ret->Cached = nCorrection.cached;
+    ret->Rejected = nCorrection.rejected;
+
     return ret;
 }
\ No newline at end of file
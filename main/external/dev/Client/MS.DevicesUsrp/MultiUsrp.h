@@ -8,11 +8,17 @@
 #include "TuneResult.h"
 #include "DeviceAddr.h"
 #include "StreamArgs.h"
+#include "RxCalibration.h"
+#include "RxCorrection.h"
 #include "RxStreamer.h"
+#include "RxReceiveThread.h"
 #include "StreamCmd.h"
+#include "ScheduledTune.h"
+#include "UsrpSnapshot.h"
 
 using namespace System;
 using namespace System::Collections::Generic;
+using namespace System::Numerics;
 using namespace System::Runtime::InteropServices;
 using namespace uhd;
 using namespace uhd::usrp;
@@ -27,12 +33,26 @@ namespace Microsoft { namespace Spectrum { namespace Devices { namespace Usrp {
             // Therefore, we create a ptr to a shared_ptr in order to make everyone happy
             boost::shared_ptr<multi_usrp>* pUsrp;
 
+            // The DC offset and IQ balance corrections measured so far, by frequency and gain
+            Native::RxCalibration* pCalibration;
+
             ~MultiUsrp();
             !MultiUsrp();
 
         public:
+            // args with type=replay make a simulated device (see Native::ReplayUsrp for its keys) instead of
+            // finding hardware
             MultiUsrp(DeviceAddr^ args);
 
+            property bool is_replay
+            {
+                bool get();
+            }
+
+            // Adds a recording (interleaved I/Q, full scale 1) to a replay device, served while it's tuned within half
+            // the rate of centerFreq. NaN serves it at every frequency. Throws InvalidOperationException on hardware.
+            void add_replay_capture(double centerFreq, cli::array<double>^ interleavedIq);
+
             RxStreamer^ get_rx_stream(StreamArgs^ args);
             Dictionary<String^, String^>^ get_usrp_rx_info(size_t channel);
 
@@ -40,15 +60,22 @@ namespace Microsoft { namespace Spectrum { namespace Devices { namespace Usrp {
             //double get_master_clock_rate(size_t mboard);
             String^ get_pp_string();
             String^ get_mboard_name(size_t mboard);
-            //time_spec_t get_time_now(size_t mboard);
-            //time_spec_t get_time_last_pps(size_t mboard);
+
+            // Everything about the motherboards and RX channels (names, sources, sensors, subdevs, ranges, gains,
+            // antennas and current settings) read natively in one call, instead of one interop call per value
+            UsrpSnapshot^ snapshot();
+            TimeSpec^ get_time_now(size_t mboard);
+            TimeSpec^ get_time_last_pps(size_t mboard);
             void set_time_now(size_t mboard);
             void set_time_now(const time_spec_t& time_spec, size_t mboard);
             //void set_time_next_pps(const time_spec_t &time_spec, size_t mboard);
             //void set_time_unknown_pps(const time_spec_t &time_spec);
             bool get_time_synchronized(void);
-            //void set_command_time(const uhd::time_spec_t &time_spec, size_t mboard);
-            //void clear_command_time(size_t mboard);
+
+            // Commands issued after set_command_time (e.g. set_rx_freq) take effect at that device time, until
+            // clear_command_time
+            void set_command_time(TimeSpec^ timeSpec, size_t mboard);
+            void clear_command_time(size_t mboard);
             void issue_stream_cmd(StreamCmd^ stream_cmd, size_t chan);
             //void set_clock_config(const clock_config_t &clock_config, size_t mboard);
             void set_time_source(String^ source, const size_t mboard);
@@ -72,6 +99,11 @@ namespace Microsoft { namespace Spectrum { namespace Devices { namespace Usrp {
             List<Range^>^ get_rx_rates(size_t chan);
             TuneResult^ set_rx_freq(double targetFreq, size_t chan);
             TuneResult^ set_rx_freq(TuneRequest^ request, size_t chan);
+
+            // Tunes chan to targetFreq leadSeconds from now on the device clock and has it capture numSamps samples
+            // (NumSampsAndDone) settleSeconds after that, all in native code so nothing managed delays the commands.
+            // Returns right away, the caller can process while the device tunes and captures.
+            ScheduledTune^ schedule_rx_tune(double targetFreq, size_t chan, double leadSeconds, double settleSeconds, size_t numSamps);
             double get_rx_freq(size_t chan);
             List<Range^>^ get_rx_freq_range(size_t chan);
             List<Range^>^ get_fe_rx_freq_range(size_t chan);
@@ -90,15 +122,39 @@ namespace Microsoft { namespace Spectrum { namespace Devices { namespace Usrp {
             List<Range^>^ get_rx_bandwidth_range(size_t chan);
             //dboard_iface::sptr get_rx_dboard_iface(size_t chan);
             SensorValue^ get_rx_sensor(String^ name, size_t chan);
+
+            // Waits up to timeout seconds for the LO of chan to lock, polling the "lo_locked" sensor natively with a
+            // backoff of well under a millisecond. Returns the seconds the lock took, throws TimeoutException if
+            // it didn't lock in time.
+            double wait_for_lo_lock(size_t chan, double timeout);
             List<String^>^ get_rx_sensor_names(size_t chan);
-            //void set_rx_dc_offset(const bool enb, size_t chan);
-            //void set_rx_dc_offset(const std::complex<double> &offset, size_t chan);
-            //void set_rx_iq_balance(const std::complex<double> &correction, size_t chan);
+
+            // true has the front end track and remove the DC offset itself, false applies the manual offset
+            void set_rx_dc_offset(bool enb, size_t chan);
+            void set_rx_dc_offset(Complex offset, size_t chan);
+            void set_rx_iq_balance(Complex correction, size_t chan);
+
+            // Measures the DC offset and IQ balance corrections of chan at its current frequency and gain (see
+            // Native::RxCalibration), applies them and caches them. Every capture is numSamps samples received
+            // from streamer, which must be made for chan alone and must not be streaming or receiving elsewhere.
+            // Throws InvalidOperationException if a capture fails or the front end doesn't respond to the corrections.
+            RxCorrection^ calibrate_rx_correction(RxStreamer^ streamer, size_t chan, size_t numSamps, double timeout);
+
+            // Applies the cached correction of the current frequency and gain of chan, calibrates if there is none or
+            // it's older than Native::RxCalibration::MaxAgeSeconds
+            RxCorrection^ apply_rx_correction(RxStreamer^ streamer, size_t chan, size_t numSamps, double timeout);
+            void clear_rx_correction_cache();
 
             // TX
             // We aren't doing any transmissions, so we haven't wrapped those calls
 
         private:
             TuneResult^ set_rx_freq(tune_request_t tr, size_t chan);
+            static TuneResult^ ToTuneResult(const tune_result_t& nResult);
+            static TimeSpec^ ToTimeSpec(const time_spec_t& time);
+            static List<Range^>^ ToRanges(const meta_range_t& ranges);
+            static List<String^>^ ToStrings(const std::vector<std::string>& strings);
+            static List<SensorValue^>^ ToSensorValues(const std::vector<sensor_value_t>& values);
+            RxCorrection^ RunCalibration(RxStreamer^ streamer, size_t chan, size_t numSamps, double timeout, bool useCache);
 	};
 }}}}
\ No newline at end of file
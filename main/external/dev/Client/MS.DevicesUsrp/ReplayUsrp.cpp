@@ -0,0 +1,1269 @@
+// ReplayUsrp.cpp
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <limits>
+#include <mutex>
+#include <sstream>
+#include <uhd/exception.hpp>
+#include <uhd/types/time_spec.hpp>
+#include "ReplayUsrp.h"
+#include "SignalGenerator.h"
+
+using namespace uhd;
+using namespace uhd::usrp;
+
+namespace Microsoft { namespace Spectrum { namespace Devices { namespace Usrp { namespace Native {
+
+    static const double Pi = 3.14159265358979323846;
+
+    // The ranges of a generic wideband front end
+    static const double MinRate = 1e3;
+    static const double MaxRate = 61.44e6;
+    static const double MinFreq = 50e6;
+    static const double MaxFreq = 6e9;
+    static const double MaxGain = 76;
+    static const double MinBandwidth = 200e3;
+    static const double MaxBandwidth = 56e6;
+    static const char* const GainName = "PGA0";
+
+    static const double DefaultNoise = -80;
+
+    struct Capture
+    {
+        double centerFreq;
+        std::vector<std::complex<float> > samples;
+    };
+
+    // count samples received at freq
+    struct Segment
+    {
+        size_t count;
+        double freq;
+    };
+
+    // The LO is at freq for the samples from time on
+    struct Tune
+    {
+        double time;
+        double freq;
+    };
+
+    static double Clip(double value, double low, double high)
+    {
+        return std::min(std::max(value, low), high);
+    }
+
+    static double Option(const device_addr_t& args, const std::string& key, double fallback)
+    {
+        if (!args.has_key(key))
+        {
+            return fallback;
+        }
+
+        try
+        {
+            return std::stod(args[key]);
+        }
+        catch (const std::exception&)
+        {
+            throw value_error("The replay device option " + key + " is not a number: " + args[key]);
+        }
+    }
+
+    static std::vector<std::complex<float> > ReadSamples(const std::string& path, const std::string& format)
+    {
+        std::ifstream file(path.c_str(), std::ios::binary);
+        if (!file)
+        {
+            throw io_error("The replay device can't open " + path);
+        }
+
+        std::vector<char> bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        std::vector<std::complex<float> > samples;
+
+        if (format == "fc32")
+        {
+            samples.resize(bytes.size() / sizeof(std::complex<float>));
+            std::copy(bytes.begin(), bytes.begin() + (samples.size() * sizeof(std::complex<float>)), reinterpret_cast<char*>(samples.data()));
+        }
+        else if (format == "fc64")
+        {
+            const std::complex<double>* in = reinterpret_cast<const std::complex<double>*>(bytes.data());
+            samples.resize(bytes.size() / sizeof(std::complex<double>));
+            for (size_t i = 0; i < samples.size(); i++)
+            {
+                samples[i] = std::complex<float>(in[i]);
+            }
+        }
+        else if (format == "sc16")
+        {
+            const short* in = reinterpret_cast<const short*>(bytes.data());
+            samples.resize(bytes.size() / (2 * sizeof(short)));
+            for (size_t i = 0; i < samples.size(); i++)
+            {
+                samples[i] = std::complex<float>(in[2 * i] / 32767.0f, in[(2 * i) + 1] / 32767.0f);
+            }
+        }
+        else
+        {
+            throw value_error("The replay device reads fc64, fc32 or sc16 files, not " + format);
+        }
+
+        if (samples.empty())
+        {
+            throw value_error("The replay device found no samples in " + path);
+        }
+
+        return samples;
+    }
+
+    // Converts to the CPU format of a streamer, sc16 and sc8 with the usual full scale of 1
+    static void Convert(const std::complex<float>* in, size_t count, const std::string& format, void* out)
+    {
+        if (format == "fc32")
+        {
+            std::copy(in, in + count, static_cast<std::complex<float>*>(out));
+        }
+        else if (format == "fc64")
+        {
+            std::complex<double>* o = static_cast<std::complex<double>*>(out);
+            for (size_t i = 0; i < count; i++)
+            {
+                o[i] = std::complex<double>(in[i]);
+            }
+        }
+        else
+        {
+            bool sc16 = format == "sc16";
+            float scale = sc16 ? 32767.0f : 127.0f;
+
+            for (size_t i = 0; i < count; i++)
+            {
+                float re = Clip(in[i].real() * scale, -scale, scale);
+                float im = Clip(in[i].imag() * scale, -scale, scale);
+
+                if (sc16)
+                {
+                    static_cast<short*>(out)[2 * i] = static_cast<short>(std::floor(re + 0.5f));
+                    static_cast<short*>(out)[(2 * i) + 1] = static_cast<short>(std::floor(im + 0.5f));
+                }
+                else
+                {
+                    static_cast<signed char*>(out)[2 * i] = static_cast<signed char>(std::floor(re + 0.5f));
+                    static_cast<signed char*>(out)[(2 * i) + 1] = static_cast<signed char>(std::floor(im + 0.5f));
+                }
+            }
+        }
+    }
+
+    // Adds samples, read from position on and wrapping at length, rotated by offset Hz from time on
+    static void AddRotated(std::complex<float>* out, size_t count, double rate, const std::complex<float>* samples, size_t length, size_t position, double offset, double time)
+    {
+        double cycles = offset * time;
+        std::complex<double> phasor = std::polar(1.0, 2 * Pi * (cycles - std::floor(cycles)));
+        std::complex<double> step = std::polar(1.0, 2 * Pi * offset / rate);
+
+        for (size_t i = 0; i < count; i++)
+        {
+            out[i] += std::complex<float>(phasor * std::complex<double>(samples[position]));
+
+            phasor *= step;
+            if (++position == length)
+            {
+                position = 0;
+            }
+
+            // Keeps rounding from growing the amplitude
+            if ((i & 1023) == 1023)
+            {
+                phasor /= std::abs(phasor);
+            }
+        }
+    }
+
+    // Adds the nearest capture within the band around freq, shifted by where it was recorded
+    static void AddCapture(std::complex<float>* out, size_t count, double rate, double time, double freq, const std::vector<boost::shared_ptr<const Capture> >& captures)
+    {
+        const Capture* capture = NULL;
+        double captureOffset = 0;
+
+        for (size_t k = 0; k < captures.size(); k++)
+        {
+            // A capture without a frequency is served everywhere
+            double offset = captures[k]->centerFreq != captures[k]->centerFreq ? 0 : captures[k]->centerFreq - freq;
+
+            if (std::abs(offset) < rate / 2 && (capture == NULL || std::abs(offset) < std::abs(captureOffset)))
+            {
+                capture = captures[k].get();
+                captureOffset = offset;
+            }
+        }
+
+        if (capture != NULL)
+        {
+            size_t length = capture->samples.size();
+            size_t position = static_cast<size_t>(static_cast<unsigned long long>(std::floor(time * rate)) % length);
+
+            AddRotated(out, count, rate, capture->samples.data(), length, position, captureOffset, time);
+        }
+    }
+
+    struct ReplayUsrp::State
+    {
+        std::mutex mutex;
+
+        // Signaled on every stream command
+        std::condition_variable changed;
+
+        size_t channels;
+        SignalConfig signal;
+
+        // Shared with the streamers generating from them
+        std::vector<boost::shared_ptr<const Capture> > captures;
+
+        double tuneLatency;
+        double overflowRate;
+        size_t spp;
+        bool pace;
+
+        // Overflow random state
+        unsigned long long random;
+
+        // The device clock is timeOffset plus the system time since start
+        time_spec_t start;
+        double timeOffset;
+
+        double rate;
+        double gain;
+        double bandwidth;
+        double masterClockRate;
+        std::string antenna;
+        std::string clockSource;
+        std::string timeSource;
+        bool dcOffsetAuto;
+        std::complex<double> dcOffset;
+        std::complex<double> iqBalance;
+
+        // The Q branch's gain (linear) and phase (radians) against the I branch
+        double imbalanceGain;
+        double imbalancePhase;
+
+        bool hasCommandTime;
+        double commandTime;
+
+        // Ordered by time, the first one holds since the device was made
+        std::vector<Tune> tunes;
+
+        // Stream commands not started yet, and the burst being streamed: its first sample's time, the samples
+        // streamed and left, and whether it goes on (continuous) or chains into the next command
+        std::deque<stream_cmd_t> commands;
+        bool streaming;
+        bool continuous;
+        bool chained;
+        bool startOfBurst;
+        size_t remaining;
+        double burstTime;
+        unsigned long long burstSamples;
+        bool overflowPending;
+
+        double Now() const
+        {
+            return timeOffset + (time_spec_t::get_system_time() - start).get_real_secs();
+        }
+
+        double NextTime() const
+        {
+            return burstTime + (burstSamples / rate);
+        }
+
+        // Moves every device time by delta, when the device clock is set
+        void ShiftTimes(double delta)
+        {
+            for (size_t i = 1; i < tunes.size(); i++)
+            {
+                tunes[i].time += delta;
+            }
+
+            burstTime += delta;
+            commandTime += delta;
+        }
+
+        double FreqAt(double time) const
+        {
+            double freq = tunes[0].freq;
+            for (size_t i = 1; i < tunes.size() && tunes[i].time <= time; i++)
+            {
+                freq = tunes[i].freq;
+            }
+
+            return freq;
+        }
+
+        // xorshift64*, in [0, 1)
+        double Uniform()
+        {
+            random ^= random >> 12;
+            random ^= random << 25;
+            random ^= random >> 27;
+
+            return ((random * 2685821657736338717ULL) >> 11) * (1.0 / 9007199254740992.0);
+        }
+
+        // Splits count samples from time on at the tunes in between
+        void Segments(double time, size_t count, std::vector<Segment>& segments) const
+        {
+            segments.clear();
+
+            for (size_t done = 0; done < count;)
+            {
+                double t = time + (done / rate);
+                size_t n = count - done;
+
+                for (size_t i = 1; i < tunes.size(); i++)
+                {
+                    if (tunes[i].time > t)
+                    {
+                        n = std::min(n, std::max(static_cast<size_t>(std::ceil((tunes[i].time - t) * rate)), static_cast<size_t>(1)));
+                        break;
+                    }
+                }
+
+                Segment segment;
+                segment.count = n;
+                segment.freq = FreqAt(t);
+                segments.push_back(segment);
+
+                done += n;
+            }
+        }
+
+        void Issue(const stream_cmd_t& cmd)
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+
+                if (cmd.stream_mode == stream_cmd_t::STREAM_MODE_STOP_CONTINUOUS)
+                {
+                    commands.clear();
+                    streaming = false;
+                }
+                else
+                {
+                    commands.push_back(cmd);
+                }
+            }
+
+            changed.notify_all();
+        }
+
+        // Waits until the device time reaches until, or a stream command arrives
+        void WaitUntil(std::unique_lock<std::mutex>& lock, double until)
+        {
+            double seconds = until - Now();
+            if (seconds > 0)
+            {
+                changed.wait_for(lock, std::chrono::microseconds(static_cast<long long>(seconds * 1e6) + 1));
+            }
+        }
+    };
+
+    class ReplayStreamer : public rx_streamer
+    {
+        public:
+            ReplayStreamer(boost::shared_ptr<ReplayUsrp::State> state, const std::string& cpuFormat, size_t channels)
+                : state(state), cpuFormat(cpuFormat), channels(channels), generator(state->signal), scratchCount(0), scratchTime(0), scratchRate(1), imbalanceGain(1), imbalancePhase(0)
+            {
+            }
+
+            size_t get_num_channels(void) const
+            {
+                return channels;
+            }
+
+            size_t get_max_num_samps(void) const
+            {
+                return state->spp;
+            }
+
+            size_t recv(const buffs_type& buffs, const size_t nsamps_per_buff, rx_metadata_t& metadata, const double timeout, const bool one_packet)
+            {
+                ReplayUsrp::State& s = *state;
+                std::unique_lock<std::mutex> lock(s.mutex);
+
+                metadata.reset();
+                double deadline = s.Now() + timeout;
+
+                while (true)
+                {
+                    if (!s.streaming)
+                    {
+                        if (s.commands.empty())
+                        {
+                            if (s.Now() >= deadline)
+                            {
+                                metadata.error_code = rx_metadata_t::ERROR_CODE_TIMEOUT;
+                                return 0;
+                            }
+
+                            s.WaitUntil(lock, deadline);
+                            continue;
+                        }
+
+                        stream_cmd_t cmd = s.commands.front();
+                        s.commands.pop_front();
+
+                        double now = s.Now();
+                        if (!cmd.stream_now && cmd.time_spec.get_real_secs() < now)
+                        {
+                            metadata.error_code = rx_metadata_t::ERROR_CODE_LATE_COMMAND;
+                            return 0;
+                        }
+
+                        s.continuous = cmd.stream_mode == stream_cmd_t::STREAM_MODE_START_CONTINUOUS;
+                        s.chained = cmd.stream_mode == stream_cmd_t::STREAM_MODE_NUM_SAMPS_AND_MORE;
+                        s.remaining = cmd.num_samps;
+                        s.burstTime = cmd.stream_now ? now : cmd.time_spec.get_real_secs();
+                        s.burstSamples = 0;
+                        s.startOfBurst = true;
+                        s.streaming = s.continuous || s.remaining > 0;
+                        continue;
+                    }
+
+                    if (s.overflowPending)
+                    {
+                        s.overflowPending = false;
+                        metadata.error_code = rx_metadata_t::ERROR_CODE_OVERFLOW;
+                        Lose(std::min(s.spp, s.continuous ? s.spp : s.remaining));
+                        return 0;
+                    }
+
+                    size_t count = one_packet ? std::min(nsamps_per_buff, s.spp) : nsamps_per_buff;
+                    if (!s.continuous)
+                    {
+                        count = std::min(count, s.remaining);
+                    }
+
+                    // A device hands out samples once their time has come, at least a packet at a time
+                    if (s.pace)
+                    {
+                        double now = s.Now();
+                        double ahead = now - s.NextTime();
+                        size_t available = ahead > 0 ? static_cast<size_t>(ahead * s.rate) : 0;
+                        size_t needed = std::min(count, s.spp);
+
+                        if (available < needed)
+                        {
+                            if (now >= deadline)
+                            {
+                                metadata.error_code = rx_metadata_t::ERROR_CODE_TIMEOUT;
+                                return 0;
+                            }
+
+                            s.WaitUntil(lock, std::min(deadline, s.NextTime() + (needed / s.rate)));
+                            continue;
+                        }
+
+                        count = std::min(count, available);
+                    }
+
+                    // Every packet overflows with the same chance, the samples before it are still received
+                    double overflowChance = s.overflowRate * s.spp / s.rate;
+                    for (size_t packet = 0; overflowChance > 0 && packet * s.spp < count; packet++)
+                    {
+                        if (s.Uniform() < overflowChance)
+                        {
+                            s.overflowPending = true;
+                            count = packet * s.spp;
+                            break;
+                        }
+                    }
+
+                    if (count == 0)
+                    {
+                        continue;
+                    }
+
+                    metadata.has_time_spec = true;
+                    metadata.time_spec = time_spec_t(s.NextTime());
+                    metadata.start_of_burst = s.startOfBurst;
+                    s.startOfBurst = false;
+
+                    // What to generate, which happens outside the lock
+                    scratchTime = s.NextTime();
+                    scratchRate = s.rate;
+                    dcOffset = s.dcOffsetAuto ? std::complex<float>(0) : std::complex<float>(s.dcOffset);
+                    iqBalance = std::complex<float>(s.iqBalance);
+                    imbalanceGain = static_cast<float>(s.imbalanceGain);
+                    imbalancePhase = static_cast<float>(s.imbalancePhase);
+                    s.Segments(scratchTime, count, segments);
+                    captures = s.captures;
+
+                    Lose(count);
+                    metadata.end_of_burst = !s.streaming && !s.chained;
+
+                    break;
+                }
+
+                // Generates and converts outside the lock, scratch belongs to this streamer
+                lock.unlock();
+
+                return Deliver(buffs, metadata);
+            }
+
+            void issue_stream_cmd(const stream_cmd_t& stream_cmd)
+            {
+                state->Issue(stream_cmd);
+            }
+
+        private:
+            boost::shared_ptr<ReplayUsrp::State> state;
+            std::string cpuFormat;
+            size_t channels;
+
+            SignalGenerator generator;
+
+            // The samples of the last recv, before conversion to the CPU format, and what they're made of
+            std::vector<std::complex<float> > scratch;
+            size_t scratchCount;
+            double scratchTime;
+            double scratchRate;
+            std::vector<Segment> segments;
+            std::vector<boost::shared_ptr<const Capture> > captures;
+            std::complex<float> dcOffset;
+            std::complex<float> iqBalance;
+            float imbalanceGain;
+            float imbalancePhase;
+
+            // The front end: the IQ imbalance, then the IQ balance and the DC offset corrections. The correction
+            // adds (1 + iqBalance.real) * Q + iqBalance.imag * I to Q, and dcOffset to the sample.
+            void FrontEnd(std::complex<float>* samples, size_t count)
+            {
+                if (imbalanceGain == 1 && imbalancePhase == 0 && iqBalance == std::complex<float>(0) && dcOffset == std::complex<float>(0))
+                {
+                    return;
+                }
+
+                float qq = imbalanceGain * std::cos(imbalancePhase);
+                float qi = imbalanceGain * std::sin(imbalancePhase);
+
+                for (size_t i = 0; i < count; i++)
+                {
+                    float re = samples[i].real();
+                    float im = (qq * samples[i].imag()) + (qi * re);
+
+                    im = ((1 + iqBalance.real()) * im) + (iqBalance.imag() * re);
+                    samples[i] = std::complex<float>(re, im) + dcOffset;
+                }
+            }
+
+            // Moves the burst on by count samples, received or lost
+            void Lose(size_t count)
+            {
+                ReplayUsrp::State& s = *state;
+
+                s.burstSamples += count;
+                scratchCount = count;
+
+                if (!s.continuous)
+                {
+                    s.remaining -= std::min(count, s.remaining);
+                    s.streaming = s.remaining > 0;
+                }
+            }
+
+            size_t Deliver(const buffs_type& buffs, const rx_metadata_t& metadata)
+            {
+                if (metadata.error_code != rx_metadata_t::ERROR_CODE_NONE)
+                {
+                    return 0;
+                }
+
+                scratch.resize(std::max(scratch.size(), scratchCount));
+
+                size_t done = 0;
+                for (size_t i = 0; i < segments.size(); i++)
+                {
+                    double time = scratchTime + (done / scratchRate);
+
+                    generator.Generate(scratch.data() + done, segments[i].count, scratchRate, time, segments[i].freq);
+                    AddCapture(scratch.data() + done, segments[i].count, scratchRate, time, segments[i].freq, captures);
+
+                    done += segments[i].count;
+                }
+
+                FrontEnd(scratch.data(), scratchCount);
+
+                for (size_t channel = 0; channel < channels; channel++)
+                {
+                    Convert(scratch.data(), scratchCount, cpuFormat, buffs[channel]);
+                }
+
+                return scratchCount;
+            }
+    };
+
+    bool ReplayUsrp::IsReplay(const device_addr_t& args)
+    {
+        return args.has_key("type") && args["type"] == "replay";
+    }
+
+    ReplayUsrp::ReplayUsrp(const device_addr_t& args) : state(new State())
+    {
+        State& s = *state;
+
+        s.channels = static_cast<size_t>(Option(args, "channels", 1));
+        s.tuneLatency = Option(args, "tune_latency", 0.0005);
+        s.overflowRate = Option(args, "overflow_rate", 0);
+        s.spp = static_cast<size_t>(Option(args, "spp", 2000));
+        s.pace = Option(args, "pace", 1) != 0;
+        s.random = static_cast<unsigned long long>(Option(args, "seed", 1)) | 1;
+
+        if (s.channels < 1 || s.spp < 1)
+        {
+            throw value_error("The replay device needs at least one channel and one sample per packet");
+        }
+
+        s.signal.noise = DefaultNoise;
+        s.signal.Parse(args);
+
+        if (args.has_key("file"))
+        {
+            AddCapture(Option(args, "file_freq", std::numeric_limits<double>::quiet_NaN()),
+                ReadSamples(args["file"], args.has_key("file_format") ? args["file_format"] : "fc32"));
+        }
+
+        s.start = time_spec_t::get_system_time();
+        s.timeOffset = 0;
+
+        s.rate = Clip(Option(args, "rate", 1e6), MinRate, MaxRate);
+        s.gain = Clip(Option(args, "gain", 0), 0, MaxGain);
+        s.bandwidth = MaxBandwidth;
+        s.masterClockRate = MaxRate;
+        s.antenna = "RX2";
+        s.clockSource = "internal";
+        s.timeSource = "none";
+        s.dcOffsetAuto = true;
+        s.dcOffset = 0;
+        s.iqBalance = 0;
+        s.imbalanceGain = 1;
+        s.imbalancePhase = 0;
+
+        if (args.has_key("iq_imbalance"))
+        {
+            std::istringstream imbalance(args["iq_imbalance"]);
+            double db;
+            double degrees;
+            char colon;
+
+            if (!(imbalance >> db >> colon >> degrees) || colon != ':')
+            {
+                throw value_error("The replay device expects iq_imbalance as dB:degrees, not " + args["iq_imbalance"]);
+            }
+
+            s.imbalanceGain = std::pow(10, db / 20);
+            s.imbalancePhase = degrees * Pi / 180;
+        }
+
+        s.hasCommandTime = false;
+        s.commandTime = 0;
+
+        Tune initial;
+        initial.time = -std::numeric_limits<double>::max();
+        initial.freq = Clip(Option(args, "freq", 100e6), MinFreq, MaxFreq);
+        s.tunes.push_back(initial);
+
+        s.streaming = false;
+        s.continuous = false;
+        s.chained = false;
+        s.startOfBurst = false;
+        s.remaining = 0;
+        s.burstTime = 0;
+        s.burstSamples = 0;
+        s.overflowPending = false;
+    }
+
+    ReplayUsrp::~ReplayUsrp()
+    {
+    }
+
+    void ReplayUsrp::AddCapture(double centerFreq, const std::vector<std::complex<float> >& samples)
+    {
+        if (samples.empty())
+        {
+            throw value_error("A replay capture needs samples");
+        }
+
+        boost::shared_ptr<Capture> capture(new Capture());
+        capture->centerFreq = centerFreq;
+        capture->samples = samples;
+
+        std::lock_guard<std::mutex> lock(state->mutex);
+        state->captures.push_back(capture);
+    }
+
+    device::sptr ReplayUsrp::get_device(void)
+    {
+        return device::sptr();
+    }
+
+    rx_streamer::sptr ReplayUsrp::get_rx_stream(const stream_args_t& args)
+    {
+        if (args.cpu_format != "fc64" && args.cpu_format != "fc32" && args.cpu_format != "sc16" && args.cpu_format != "sc8")
+        {
+            throw value_error("The replay device streams fc64, fc32, sc16 or sc8, not " + args.cpu_format);
+        }
+
+        for (size_t i = 0; i < args.channels.size(); i++)
+        {
+            if (args.channels[i] >= state->channels)
+            {
+                throw index_error("The replay device has no RX channel " + std::to_string(args.channels[i]));
+            }
+        }
+
+        return rx_streamer::sptr(new ReplayStreamer(state, args.cpu_format, std::max(args.channels.size(), static_cast<size_t>(1))));
+    }
+
+    tx_streamer::sptr ReplayUsrp::get_tx_stream(const stream_args_t&)
+    {
+        throw not_implemented_error("The replay device does not transmit");
+    }
+
+    dict<std::string, std::string> ReplayUsrp::get_usrp_rx_info(size_t)
+    {
+        dict<std::string, std::string> info;
+        info["mboard_id"] = "Replay";
+        info["mboard_serial"] = "replay";
+        info["rx_id"] = "Replay";
+        info["rx_subdev_name"] = "Replay";
+        info["rx_subdev_spec"] = "A:0";
+        info["rx_antenna"] = get_rx_antenna(0);
+
+        return info;
+    }
+
+    dict<std::string, std::string> ReplayUsrp::get_usrp_tx_info(size_t)
+    {
+        throw not_implemented_error("The replay device does not transmit");
+    }
+
+    void ReplayUsrp::set_master_clock_rate(double rate, size_t)
+    {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        state->masterClockRate = rate;
+    }
+
+    double ReplayUsrp::get_master_clock_rate(size_t)
+    {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        return state->masterClockRate;
+    }
+
+    std::string ReplayUsrp::get_pp_string(void)
+    {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        std::ostringstream pp;
+
+        pp << "Replay USRP:" << std::endl;
+        pp << "  RX channels: " << state->channels << std::endl;
+        pp << "  Rate: " << state->rate << " S/s, freq: " << state->tunes.back().freq << " Hz" << std::endl;
+        pp << "  Noise: " << state->signal.noise << " dBFS, emitters: " << state->signal.emitters.size() << ", DC spike: " << state->signal.dc << " dBFS, captures: " << state->captures.size() << std::endl;
+        pp << "  Tune latency: " << state->tuneLatency << " s, overflow rate: " << state->overflowRate << " /s, paced: " << state->pace << std::endl;
+
+        return pp.str();
+    }
+
+    std::string ReplayUsrp::get_mboard_name(size_t)
+    {
+        return "Replay";
+    }
+
+    time_spec_t ReplayUsrp::get_time_now(size_t)
+    {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        return time_spec_t(state->Now());
+    }
+
+    time_spec_t ReplayUsrp::get_time_last_pps(size_t)
+    {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        return time_spec_t(std::floor(state->Now()));
+    }
+
+    void ReplayUsrp::set_time_now(const time_spec_t& time_spec, size_t)
+    {
+        std::lock_guard<std::mutex> lock(state->mutex);
+
+        double delta = time_spec.get_real_secs() - state->Now();
+        state->timeOffset += delta;
+        state->ShiftTimes(delta);
+    }
+
+    void ReplayUsrp::set_time_next_pps(const time_spec_t& time_spec, size_t mboard)
+    {
+        // The PPS edges are at whole seconds of the device clock
+        double now = get_time_now(mboard).get_real_secs();
+        set_time_now(time_spec_t(time_spec.get_real_secs() - (std::ceil(now) - now)), mboard);
+    }
+
+    void ReplayUsrp::set_time_unknown_pps(const time_spec_t& time_spec)
+    {
+        set_time_now(time_spec, ALL_MBOARDS);
+    }
+
+    bool ReplayUsrp::get_time_synchronized(void)
+    {
+        return true;
+    }
+
+    void ReplayUsrp::set_command_time(const time_spec_t& time_spec, size_t)
+    {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        state->hasCommandTime = true;
+        state->commandTime = time_spec.get_real_secs();
+    }
+
+    void ReplayUsrp::clear_command_time(size_t)
+    {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        state->hasCommandTime = false;
+    }
+
+    void ReplayUsrp::issue_stream_cmd(const stream_cmd_t& stream_cmd, size_t)
+    {
+        state->Issue(stream_cmd);
+    }
+
+    void ReplayUsrp::set_clock_config(const clock_config_t&, size_t)
+    {
+    }
+
+    void ReplayUsrp::set_time_source(const std::string& source, const size_t)
+    {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        state->timeSource = source;
+    }
+
+    std::string ReplayUsrp::get_time_source(const size_t)
+    {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        return state->timeSource;
+    }
+
+    std::vector<std::string> ReplayUsrp::get_time_sources(const size_t)
+    {
+        std::vector<std::string> sources;
+        sources.push_back("none");
+        sources.push_back("external");
+
+        return sources;
+    }
+
+    void ReplayUsrp::set_clock_source(const std::string& source, const size_t)
+    {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        state->clockSource = source;
+    }
+
+    std::string ReplayUsrp::get_clock_source(const size_t)
+    {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        return state->clockSource;
+    }
+
+    std::vector<std::string> ReplayUsrp::get_clock_sources(const size_t)
+    {
+        std::vector<std::string> sources;
+        sources.push_back("internal");
+        sources.push_back("external");
+
+        return sources;
+    }
+
+    void ReplayUsrp::set_clock_source_out(const bool, const size_t)
+    {
+    }
+
+    void ReplayUsrp::set_time_source_out(const bool, const size_t)
+    {
+    }
+
+    size_t ReplayUsrp::get_num_mboards(void)
+    {
+        return 1;
+    }
+
+    sensor_value_t ReplayUsrp::get_mboard_sensor(const std::string& name, size_t)
+    {
+        if (name != "ref_locked")
+        {
+            throw key_error("The replay device has no motherboard sensor " + name);
+        }
+
+        return sensor_value_t("Ref", true, "locked", "unlocked");
+    }
+
+    std::vector<std::string> ReplayUsrp::get_mboard_sensor_names(size_t)
+    {
+        return std::vector<std::string>(1, "ref_locked");
+    }
+
+    void ReplayUsrp::set_user_register(const boost::uint8_t, const boost::uint32_t, size_t)
+    {
+    }
+
+    void ReplayUsrp::set_rx_subdev_spec(const subdev_spec_t&, size_t)
+    {
+    }
+
+    subdev_spec_t ReplayUsrp::get_rx_subdev_spec(size_t)
+    {
+        return subdev_spec_t("A:0");
+    }
+
+    size_t ReplayUsrp::get_rx_num_channels(void)
+    {
+        return state->channels;
+    }
+
+    std::string ReplayUsrp::get_rx_subdev_name(size_t)
+    {
+        return "Replay";
+    }
+
+    void ReplayUsrp::set_rx_rate(double rate, size_t)
+    {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        State& s = *state;
+
+        // The burst goes on at the new rate from the next sample
+        s.burstTime = s.NextTime();
+        s.burstSamples = 0;
+        s.rate = Clip(rate, MinRate, MaxRate);
+    }
+
+    double ReplayUsrp::get_rx_rate(size_t)
+    {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        return state->rate;
+    }
+
+    meta_range_t ReplayUsrp::get_rx_rates(size_t)
+    {
+        return meta_range_t(MinRate, MaxRate);
+    }
+
+    tune_result_t ReplayUsrp::set_rx_freq(const tune_request_t& tune_request, size_t)
+    {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        State& s = *state;
+
+        Tune tune;
+        tune.freq = Clip(tune_request.target_freq, MinFreq, MaxFreq);
+        tune.time = (s.hasCommandTime ? s.commandTime : s.Now()) + s.tuneLatency;
+
+        // A tune replaces the ones that would have taken effect after it, and the ones before the current one are
+        // history
+        while (s.tunes.size() > 1 && s.tunes.back().time >= tune.time)
+        {
+            s.tunes.pop_back();
+        }
+
+        double now = s.Now();
+        while (s.tunes.size() > 1 && s.tunes[1].time <= now)
+        {
+            s.tunes.erase(s.tunes.begin());
+        }
+
+        s.tunes.push_back(tune);
+
+        tune_result_t result;
+        result.clipped_rf_freq = tune.freq;
+        result.target_rf_freq = tune.freq;
+        result.actual_rf_freq = tune.freq;
+        result.target_dsp_freq = 0;
+        result.actual_dsp_freq = 0;
+
+        return result;
+    }
+
+    double ReplayUsrp::get_rx_freq(size_t)
+    {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        return state->tunes.back().freq;
+    }
+
+    freq_range_t ReplayUsrp::get_rx_freq_range(size_t)
+    {
+        return freq_range_t(MinFreq, MaxFreq);
+    }
+
+    freq_range_t ReplayUsrp::get_fe_rx_freq_range(size_t)
+    {
+        return freq_range_t(MinFreq, MaxFreq);
+    }
+
+    void ReplayUsrp::set_rx_gain(double gain, const std::string& name, size_t chan)
+    {
+        get_rx_gain_range(name, chan);
+
+        std::lock_guard<std::mutex> lock(state->mutex);
+        state->gain = Clip(gain, 0, MaxGain);
+    }
+
+    double ReplayUsrp::get_rx_gain(const std::string& name, size_t chan)
+    {
+        get_rx_gain_range(name, chan);
+
+        std::lock_guard<std::mutex> lock(state->mutex);
+        return state->gain;
+    }
+
+    gain_range_t ReplayUsrp::get_rx_gain_range(const std::string& name, size_t)
+    {
+        if (name != ALL_GAINS && name != GainName)
+        {
+            throw key_error("The replay device has no gain element " + name);
+        }
+
+        return gain_range_t(0, MaxGain, 1);
+    }
+
+    std::vector<std::string> ReplayUsrp::get_rx_gain_names(size_t)
+    {
+        return std::vector<std::string>(1, GainName);
+    }
+
+    void ReplayUsrp::set_rx_antenna(const std::string& ant, size_t chan)
+    {
+        std::vector<std::string> antennas = get_rx_antennas(chan);
+        if (std::find(antennas.begin(), antennas.end(), ant) == antennas.end())
+        {
+            throw value_error("The replay device has no antenna " + ant);
+        }
+
+        std::lock_guard<std::mutex> lock(state->mutex);
+        state->antenna = ant;
+    }
+
+    std::string ReplayUsrp::get_rx_antenna(size_t)
+    {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        return state->antenna;
+    }
+
+    std::vector<std::string> ReplayUsrp::get_rx_antennas(size_t)
+    {
+        std::vector<std::string> antennas;
+        antennas.push_back("TX/RX");
+        antennas.push_back("RX2");
+
+        return antennas;
+    }
+
+    void ReplayUsrp::set_rx_bandwidth(double bandwidth, size_t)
+    {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        state->bandwidth = Clip(bandwidth, MinBandwidth, MaxBandwidth);
+    }
+
+    double ReplayUsrp::get_rx_bandwidth(size_t)
+    {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        return state->bandwidth;
+    }
+
+    meta_range_t ReplayUsrp::get_rx_bandwidth_range(size_t)
+    {
+        return meta_range_t(MinBandwidth, MaxBandwidth);
+    }
+
+    dboard_iface::sptr ReplayUsrp::get_rx_dboard_iface(size_t)
+    {
+        return dboard_iface::sptr();
+    }
+
+    sensor_value_t ReplayUsrp::get_rx_sensor(const std::string& name, size_t)
+    {
+        if (name != "lo_locked")
+        {
+            throw key_error("The replay device has no RX sensor " + name);
+        }
+
+        std::lock_guard<std::mutex> lock(state->mutex);
+        return sensor_value_t("LO", state->Now() >= state->tunes.back().time, "locked", "unlocked");
+    }
+
+    std::vector<std::string> ReplayUsrp::get_rx_sensor_names(size_t)
+    {
+        return std::vector<std::string>(1, "lo_locked");
+    }
+
+    void ReplayUsrp::set_rx_dc_offset(const bool enb, size_t)
+    {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        state->dcOffsetAuto = enb;
+    }
+
+    void ReplayUsrp::set_rx_dc_offset(const std::complex<double>& offset, size_t)
+    {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        state->dcOffset = offset;
+    }
+
+    void ReplayUsrp::set_rx_iq_balance(const std::complex<double>& correction, size_t)
+    {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        state->iqBalance = correction;
+    }
+
+    void ReplayUsrp::set_tx_subdev_spec(const subdev_spec_t&, size_t)
+    {
+        throw not_implemented_error("The replay device does not transmit");
+    }
+
+    subdev_spec_t ReplayUsrp::get_tx_subdev_spec(size_t)
+    {
+        return subdev_spec_t();
+    }
+
+    size_t ReplayUsrp::get_tx_num_channels(void)
+    {
+        return 0;
+    }
+
+    std::string ReplayUsrp::get_tx_subdev_name(size_t)
+    {
+        throw not_implemented_error("The replay device does not transmit");
+    }
+
+    void ReplayUsrp::set_tx_rate(double, size_t)
+    {
+        throw not_implemented_error("The replay device does not transmit");
+    }
+
+    double ReplayUsrp::get_tx_rate(size_t)
+    {
+        throw not_implemented_error("The replay device does not transmit");
+    }
+
+    meta_range_t ReplayUsrp::get_tx_rates(size_t)
+    {
+        throw not_implemented_error("The replay device does not transmit");
+    }
+
+    tune_result_t ReplayUsrp::set_tx_freq(const tune_request_t&, size_t)
+    {
+        throw not_implemented_error("The replay device does not transmit");
+    }
+
+    double ReplayUsrp::get_tx_freq(size_t)
+    {
+        throw not_implemented_error("The replay device does not transmit");
+    }
+
+    freq_range_t ReplayUsrp::get_tx_freq_range(size_t)
+    {
+        throw not_implemented_error("The replay device does not transmit");
+    }
+
+    freq_range_t ReplayUsrp::get_fe_tx_freq_range(size_t)
+    {
+        throw not_implemented_error("The replay device does not transmit");
+    }
+
+    void ReplayUsrp::set_tx_gain(double, const std::string&, size_t)
+    {
+        throw not_implemented_error("The replay device does not transmit");
+    }
+
+    double ReplayUsrp::get_tx_gain(const std::string&, size_t)
+    {
+        throw not_implemented_error("The replay device does not transmit");
+    }
+
+    gain_range_t ReplayUsrp::get_tx_gain_range(const std::string&, size_t)
+    {
+        throw not_implemented_error("The replay device does not transmit");
+    }
+
+    std::vector<std::string> ReplayUsrp::get_tx_gain_names(size_t)
+    {
+        return std::vector<std::string>();
+    }
+
+    void ReplayUsrp::set_tx_antenna(const std::string&, size_t)
+    {
+        throw not_implemented_error("The replay device does not transmit");
+    }
+
+    std::string ReplayUsrp::get_tx_antenna(size_t)
+    {
+        throw not_implemented_error("The replay device does not transmit");
+    }
+
+    std::vector<std::string> ReplayUsrp::get_tx_antennas(size_t)
+    {
+        return std::vector<std::string>();
+    }
+
+    void ReplayUsrp::set_tx_bandwidth(double, size_t)
+    {
+        throw not_implemented_error("The replay device does not transmit");
+    }
+
+    double ReplayUsrp::get_tx_bandwidth(size_t)
+    {
+        throw not_implemented_error("The replay device does not transmit");
+    }
+
+    meta_range_t ReplayUsrp::get_tx_bandwidth_range(size_t)
+    {
+        throw not_implemented_error("The replay device does not transmit");
+    }
+
+    dboard_iface::sptr ReplayUsrp::get_tx_dboard_iface(size_t)
+    {
+        return dboard_iface::sptr();
+    }
+
+    sensor_value_t ReplayUsrp::get_tx_sensor(const std::string& name, size_t)
+    {
+        throw key_error("The replay device has no TX sensor " + name);
+    }
+
+    std::vector<std::string> ReplayUsrp::get_tx_sensor_names(size_t)
+    {
+        return std::vector<std::string>();
+    }
+
+    void ReplayUsrp::set_tx_dc_offset(const std::complex<double>&, size_t)
+    {
+        throw not_implemented_error("The replay device does not transmit");
+    }
+
+    void ReplayUsrp::set_tx_iq_balance(const std::complex<double>&, size_t)
+    {
+        throw not_implemented_error("The replay device does not transmit");
+    }
+
+    std::vector<std::string> ReplayUsrp::get_gpio_banks(const size_t)
+    {
+        return std::vector<std::string>();
+    }
+
+    void ReplayUsrp::set_gpio_attr(const std::string& bank, const std::string&, const boost::uint32_t, const boost::uint32_t, const size_t)
+    {
+        throw key_error("The replay device has no GPIO bank " + bank);
+    }
+
+    boost::uint32_t ReplayUsrp::get_gpio_attr(const std::string& bank, const std::string&, const size_t)
+    {
+        throw key_error("The replay device has no GPIO bank " + bank);
+    }
+}}}}}
@@ -0,0 +1,164 @@
+#pragma once
+
+// A simulated multi_usrp, for running the scan pipeline without hardware (benchmarks, regression runs on build
+// machines). ReplayUsrp.cpp is compiled as native code because <mutex> and <condition_variable> can't be used
+// under /clr, which is also why the device state stays hidden behind State.
+
+#include <complex>
+#include <string>
+#include <vector>
+#include <boost/shared_ptr.hpp>
+#include <uhd/usrp/multi_usrp.hpp>
+
+namespace Microsoft { namespace Spectrum { namespace Devices { namespace Usrp { namespace Native {
+
+    // Selected with the device address type=replay. Its streamers serve synthetic samples (see SignalGenerator: a
+    // noise floor, tones, pulsed and bursty emitters, hoppers and a DC spike) plus recorded captures, and it keeps
+    // the behavior the scanner relies on: set_rx_freq and set_rx_rate take effect on the samples, the LO reports
+    // lo_locked only tune_latency seconds after a tune, timed commands (set_command_time, timed stream commands)
+    // happen at their device time and overflows happen at overflow_rate. Like a front end it applies the manual DC
+    // offset (with the automatic one disabled) and IQ balance corrections; the automatic DC offset correction leaves
+    // the DC spike alone, as it does right after a retune.
+    //
+    // Device address keys, all optional:
+    //   rate, freq, gain      initial settings (1e6 S/s, 100e6 Hz, 0 dB), the gain doesn't scale the samples
+    //   channels              RX channels, every channel gets the same samples (1)
+    //   noise                 noise floor in dBFS, i.e. power relative to a full scale of 1 (-80)
+    //   tones, pulses, bursts, hoppers, dc
+    //                         the synthetic signal, see SignalConfig::Parse, e.g. tones=915e6:-30;2.44e9:-50
+    //   iq_imbalance          gain (dB) and phase (degrees) of the Q branch against the I branch, as dB:degrees (0:0)
+    //   file                  raw interleaved I/Q to replay, as written by UHD's rx_samples_to_file
+    //   file_format           its sample format: fc64, fc32 or sc16 (fc32)
+    //   file_freq             the frequency it was recorded at, without it it's served at every frequency
+    //   tune_latency          seconds from a tune until the LO locks and the samples are at the new frequency (0.0005)
+    //   overflow_rate         overflows per second of samples streamed (0)
+    //   spp                   samples per packet (2000)
+    //   pace                  1 serves samples no faster than the rate, as a device would; 0 as fast as they're
+    //                         received, for throughput benchmarks, with the timestamps still advancing by the rate (1)
+    //   seed                  random seed of the noise, bursts, hops, DC spike and overflows (1)
+    class ReplayUsrp : public uhd::usrp::multi_usrp
+    {
+        public:
+            static bool IsReplay(const uhd::device_addr_t& args);
+
+            explicit ReplayUsrp(const uhd::device_addr_t& args);
+            ~ReplayUsrp();
+
+            // Adds a recorded capture, served while the tuned frequency is within half the rate of centerFreq
+            // (shifted by the difference). A NaN centerFreq serves it at every frequency.
+            void AddCapture(double centerFreq, const std::vector<std::complex<float> >& samples);
+
+            uhd::device::sptr get_device(void);
+            uhd::rx_streamer::sptr get_rx_stream(const uhd::stream_args_t& args);
+            uhd::tx_streamer::sptr get_tx_stream(const uhd::stream_args_t& args);
+            uhd::dict<std::string, std::string> get_usrp_rx_info(size_t chan);
+            uhd::dict<std::string, std::string> get_usrp_tx_info(size_t chan);
+
+            // Motherboard
+            void set_master_clock_rate(double rate, size_t mboard);
+            double get_master_clock_rate(size_t mboard);
+            std::string get_pp_string(void);
+            std::string get_mboard_name(size_t mboard);
+            uhd::time_spec_t get_time_now(size_t mboard);
+            uhd::time_spec_t get_time_last_pps(size_t mboard);
+            void set_time_now(const uhd::time_spec_t& time_spec, size_t mboard);
+            void set_time_next_pps(const uhd::time_spec_t& time_spec, size_t mboard);
+            void set_time_unknown_pps(const uhd::time_spec_t& time_spec);
+            bool get_time_synchronized(void);
+            void set_command_time(const uhd::time_spec_t& time_spec, size_t mboard);
+            void clear_command_time(size_t mboard);
+            void issue_stream_cmd(const uhd::stream_cmd_t& stream_cmd, size_t chan);
+            void set_clock_config(const uhd::clock_config_t& clock_config, size_t mboard);
+            void set_time_source(const std::string& source, const size_t mboard);
+            std::string get_time_source(const size_t mboard);
+            std::vector<std::string> get_time_sources(const size_t mboard);
+            void set_clock_source(const std::string& source, const size_t mboard);
+            std::string get_clock_source(const size_t mboard);
+            std::vector<std::string> get_clock_sources(const size_t mboard);
+            void set_clock_source_out(const bool enb, const size_t mboard);
+            void set_time_source_out(const bool enb, const size_t mboard);
+            size_t get_num_mboards(void);
+            uhd::sensor_value_t get_mboard_sensor(const std::string& name, size_t mboard);
+            std::vector<std::string> get_mboard_sensor_names(size_t mboard);
+            void set_user_register(const boost::uint8_t addr, const boost::uint32_t data, size_t mboard);
+
+            // RX
+            void set_rx_subdev_spec(const uhd::usrp::subdev_spec_t& spec, size_t mboard);
+            uhd::usrp::subdev_spec_t get_rx_subdev_spec(size_t mboard);
+            size_t get_rx_num_channels(void);
+            std::string get_rx_subdev_name(size_t chan);
+            void set_rx_rate(double rate, size_t chan);
+            double get_rx_rate(size_t chan);
+            uhd::meta_range_t get_rx_rates(size_t chan);
+            uhd::tune_result_t set_rx_freq(const uhd::tune_request_t& tune_request, size_t chan);
+            double get_rx_freq(size_t chan);
+            uhd::freq_range_t get_rx_freq_range(size_t chan);
+            uhd::freq_range_t get_fe_rx_freq_range(size_t chan);
+            void set_rx_gain(double gain, const std::string& name, size_t chan);
+            double get_rx_gain(const std::string& name, size_t chan);
+            uhd::gain_range_t get_rx_gain_range(const std::string& name, size_t chan);
+            std::vector<std::string> get_rx_gain_names(size_t chan);
+            void set_rx_antenna(const std::string& ant, size_t chan);
+            std::string get_rx_antenna(size_t chan);
+            std::vector<std::string> get_rx_antennas(size_t chan);
+            void set_rx_bandwidth(double bandwidth, size_t chan);
+            double get_rx_bandwidth(size_t chan);
+            uhd::meta_range_t get_rx_bandwidth_range(size_t chan);
+            uhd::usrp::dboard_iface::sptr get_rx_dboard_iface(size_t chan);
+            uhd::sensor_value_t get_rx_sensor(const std::string& name, size_t chan);
+            std::vector<std::string> get_rx_sensor_names(size_t chan);
+            void set_rx_dc_offset(const bool enb, size_t chan);
+            void set_rx_dc_offset(const std::complex<double>& offset, size_t chan);
+            void set_rx_iq_balance(const std::complex<double>& correction, size_t chan);
+
+            // TX, not simulated
+            void set_tx_subdev_spec(const uhd::usrp::subdev_spec_t& spec, size_t mboard);
+            uhd::usrp::subdev_spec_t get_tx_subdev_spec(size_t mboard);
+            size_t get_tx_num_channels(void);
+            std::string get_tx_subdev_name(size_t chan);
+            void set_tx_rate(double rate, size_t chan);
+            double get_tx_rate(size_t chan);
+            uhd::meta_range_t get_tx_rates(size_t chan);
+            uhd::tune_result_t set_tx_freq(const uhd::tune_request_t& tune_request, size_t chan);
+            double get_tx_freq(size_t chan);
+            uhd::freq_range_t get_tx_freq_range(size_t chan);
+            uhd::freq_range_t get_fe_tx_freq_range(size_t chan);
+            void set_tx_gain(double gain, const std::string& name, size_t chan);
+            double get_tx_gain(const std::string& name, size_t chan);
+            uhd::gain_range_t get_tx_gain_range(const std::string& name, size_t chan);
+            std::vector<std::string> get_tx_gain_names(size_t chan);
+            void set_tx_antenna(const std::string& ant, size_t chan);
+            std::string get_tx_antenna(size_t chan);
+            std::vector<std::string> get_tx_antennas(size_t chan);
+            void set_tx_bandwidth(double bandwidth, size_t chan);
+            double get_tx_bandwidth(size_t chan);
+            uhd::meta_range_t get_tx_bandwidth_range(size_t chan);
+            uhd::usrp::dboard_iface::sptr get_tx_dboard_iface(size_t chan);
+            uhd::sensor_value_t get_tx_sensor(const std::string& name, size_t chan);
+            std::vector<std::string> get_tx_sensor_names(size_t chan);
+            void set_tx_dc_offset(const std::complex<double>& offset, size_t chan);
+            void set_tx_iq_balance(const std::complex<double>& correction, size_t chan);
+
+            // GPIO, not simulated
+            std::vector<std::string> get_gpio_banks(const size_t mboard);
+            void set_gpio_attr(const std::string& bank, const std::string& attr, const boost::uint32_t value, const boost::uint32_t mask, const size_t mboard);
+            boost::uint32_t get_gpio_attr(const std::string& bank, const std::string& attr, const size_t mboard);
+
+            // The non-virtual ALL_GAINS overloads of multi_usrp
+            using uhd::usrp::multi_usrp::set_rx_gain;
+            using uhd::usrp::multi_usrp::get_rx_gain;
+            using uhd::usrp::multi_usrp::get_rx_gain_range;
+            using uhd::usrp::multi_usrp::set_tx_gain;
+            using uhd::usrp::multi_usrp::get_tx_gain;
+            using uhd::usrp::multi_usrp::get_tx_gain_range;
+
+            struct State;
+
+        private:
+            // Shared with the streamers, which may outlive the device
+            boost::shared_ptr<State> state;
+
+            ReplayUsrp(const ReplayUsrp&);
+            ReplayUsrp& operator=(const ReplayUsrp&);
+    };
+}}}}}
\ No newline at end of file
@@ -0,0 +1,216 @@
+#pragma once
+
+#include <malloc.h>
+#include <uhd/types/metadata.hpp>
+#include "RxMetadata.h"
+
+using namespace System;
+using namespace System::Runtime::InteropServices;
+
+using namespace uhd;
+
+namespace Microsoft { namespace Spectrum { namespace Devices { namespace Usrp {
+
+    // The fields of RxMetadata for one block, as a value type so that the ring never allocates per block.
+    // The time spec is the one of the block's first sample. RxStreamer::Receive also returns it, to receive
+    // without allocating.
+    public value struct RxBlockMetadata
+    {
+        public:
+            RxErrorCode ErrorCode;
+            bool HasTimeSpec;
+            Int64 FullSeconds;
+            double FractionalSeconds;
+            bool StartOfBurst;
+            bool EndOfBurst;
+            bool MoreFragments;
+            size_t FragmentOffset;
+
+            virtual String^ ToString() override
+            {
+                return String::Format("HasTimeSpec: {0}, FullSeconds: {1}, FractionalSeconds: {2}, MoreFragments: {3}, " +
+                    "FragmentOffset: {4}, StartOfBurst: {5}, EndOfBurst: {6}, ErrorCode: {7}",
+                    gcnew cli::array<Object^> {HasTimeSpec, FullSeconds, FractionalSeconds, MoreFragments,
+                    FragmentOffset, StartOfBurst, EndOfBurst, ErrorCode});
+            }
+
+        internal:
+            void Set(const rx_metadata_t& nmd)
+            {
+                ErrorCode = static_cast<RxErrorCode>(nmd.error_code);
+                HasTimeSpec = nmd.has_time_spec;
+                FullSeconds = nmd.time_spec.get_full_secs();
+                FractionalSeconds = nmd.time_spec.get_frac_secs();
+                StartOfBurst = nmd.start_of_burst;
+                EndOfBurst = nmd.end_of_burst;
+                MoreFragments = nmd.more_fragments;
+                FragmentOffset = nmd.fragment_offset;
+            }
+    };
+
+    // A read-only view of one received block in an RxBlockRing. Samples stays valid, and is not written to,
+    // until the block is handed back with RxBlockRing::Release.
+    public value struct RxBlock
+    {
+        public:
+            // Counts the blocks received into the ring, the oldest block held has the lowest sequence number
+            Int64 Sequence;
+            IntPtr Samples;
+            size_t SampleCount;
+            RxBlockMetadata Metadata;
+    };
+
+    // A preallocated native ring of fixed size sample blocks that RxStreamer::ReceiveBlock has UHD write into.
+    //
+    // The producer (ReceiveBlock) fills the oldest free block and the consumer reads filled blocks in order
+    // (TryGetBlock) and hands each back when it's done (Release). The samples are never pinned, copied or
+    // marshaled and the metadata lives in a preallocated array, so receiving allocates nothing per block.
+    // Producer and consumer are the same thread; RxBlockRing does no locking.
+    public ref class RxBlockRing : IDisposable
+    {
+        private:
+            // Blocks start on cache line boundaries, which also suits the SIMD loops of FftwInterop
+            literal size_t Alignment = 64;
+
+            unsigned char* memory;
+            size_t blockBytes;
+            size_t blockCount;
+            size_t samplesPerBlock;
+            size_t bytesPerSample;
+            cli::array<RxBlock>^ blocks;
+
+            // Sequence numbers of the next block to fill and of the oldest block not yet released
+            Int64 written;
+            Int64 released;
+
+        internal:
+            // Start of the next block to receive into, NULL if the consumer still holds every block
+            unsigned char* BeginWrite()
+            {
+                if (IsFull)
+                {
+                    return NULL;
+                }
+
+                return memory + (static_cast<size_t>(written % blockCount) * blockBytes);
+            }
+
+            // Publishes the block BeginWrite returned
+            void EndWrite(size_t sampleCount, const rx_metadata_t& nmd)
+            {
+                RxBlock% block = blocks[static_cast<int>(written % blockCount)];
+                block.Sequence = written;
+                block.SampleCount = sampleCount;
+                block.Metadata.Set(nmd);
+
+                written++;
+            }
+
+        public:
+            // cpuFormat is the CpuFormat of the streamer that receives into the ring
+            RxBlockRing(size_t blockCount, size_t samplesPerBlock, String^ cpuFormat)
+            {
+                if (blockCount < 1)
+                {
+                    throw gcnew ArgumentOutOfRangeException("blockCount");
+                }
+
+                if (samplesPerBlock < 1)
+                {
+                    throw gcnew ArgumentOutOfRangeException("samplesPerBlock");
+                }
+
+                this->bytesPerSample = BytesPerSampleOf(cpuFormat);
+                this->blockCount = blockCount;
+                this->samplesPerBlock = samplesPerBlock;
+                this->blockBytes = (((samplesPerBlock * bytesPerSample) + Alignment - 1) / Alignment) * Alignment;
+
+                memory = static_cast<unsigned char*>(_aligned_malloc(blockBytes * blockCount, Alignment));
+                if (memory == NULL)
+                {
+                    throw gcnew OutOfMemoryException("Unable to allocate the receive ring");
+                }
+
+                blocks = gcnew cli::array<RxBlock>(static_cast<int>(blockCount));
+                for (size_t i = 0; i < blockCount; i++)
+                {
+                    blocks[static_cast<int>(i)].Samples = IntPtr(memory + (i * blockBytes));
+                }
+            }
+
+            ~RxBlockRing() { this->!RxBlockRing(); }
+
+            !RxBlockRing()
+            {
+                _aligned_free(memory);
+                memory = NULL;
+            }
+
+            // Size of one complex sample of a UHD CPU format
+            static size_t BytesPerSampleOf(String^ cpuFormat)
+            {
+                if (cpuFormat == "fc64") return 16;
+                if (cpuFormat == "fc32") return 8;
+                if (cpuFormat == "sc16") return 4;
+                if (cpuFormat == "sc8") return 2;
+
+                throw gcnew ArgumentException(String::Format("Unknown CPU format {0}", cpuFormat), "cpuFormat");
+            }
+
+            property size_t BlockCount
+            {
+                size_t get() { return blockCount; }
+            }
+
+            property size_t SamplesPerBlock
+            {
+                size_t get() { return samplesPerBlock; }
+            }
+
+            property size_t BytesPerSample
+            {
+                size_t get() { return bytesPerSample; }
+            }
+
+            // Blocks received and not yet released
+            property int Count
+            {
+                int get() { return static_cast<int>(written - released); }
+            }
+
+            property bool IsFull
+            {
+                bool get() { return written - released >= static_cast<Int64>(blockCount); }
+            }
+
+            // The oldest block that has not been released, false if there is none
+            bool TryGetBlock([Out] RxBlock% block)
+            {
+                if (written == released)
+                {
+                    block = RxBlock();
+                    return false;
+                }
+
+                block = blocks[static_cast<int>(released % blockCount)];
+                return true;
+            }
+
+            // Hands the oldest block back to the producer. Blocks are released in the order they were received.
+            void Release(RxBlock block)
+            {
+                if (written == released || block.Sequence != released)
+                {
+                    throw gcnew InvalidOperationException(String::Format("Block {0} is not the oldest block held", block.Sequence));
+                }
+
+                released++;
+            }
+
+            // Drops every block that was not released yet, e.g. after the stream was restarted
+            void Clear()
+            {
+                released = written;
+            }
+    };
+}}}}
\ No newline at end of file
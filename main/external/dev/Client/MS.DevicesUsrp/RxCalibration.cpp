@@ -0,0 +1,319 @@
+// RxCalibration.cpp
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <vector>
+#include <uhd/convert.hpp>
+#include <uhd/exception.hpp>
+#include "RxCalibration.h"
+
+using namespace uhd;
+using namespace uhd::usrp;
+
+namespace Microsoft { namespace Spectrum { namespace Devices { namespace Usrp { namespace Native {
+
+    const double RxCalibration::FreqResolution = 1e3;
+    const double RxCalibration::GainResolution = 0.5;
+
+    // dBFS. LO leakage stays well below this, a mean above it is taken for a signal.
+    const double RxCalibration::MaxRemovedDc = -25;
+
+    const double RxCalibration::MaxAgeSeconds = 600;
+
+    // Probe steps of the corrections while the response is measured, large against the noise of a mean or image
+    // estimate but small enough for the response to be linear
+    static const double DcProbe = 0.01;
+    static const double ImageProbe = 0.05;
+
+    // Newton steps per calibration once the response is known. The DC offset and IQ balance corrections interact
+    // (the IQ balance correction moves the mean), so the steps converge by turns.
+    static const int NewtonSteps = 3;
+
+    struct Measurement
+    {
+        std::complex<double> mean;
+        std::complex<double> image;
+    };
+
+    static double PowerDb(double power)
+    {
+        return 10 * std::log10(std::max(power, 1e-30));
+    }
+
+    // The sums of x, x^2 and |x|^2 over count interleaved I/Q values, times scale
+    template <typename T>
+    static void Accumulate(const T* iq, size_t count, double scale, std::complex<double>& sum, std::complex<double>& sumSquares, double& power)
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            double re = scale * iq[2 * i];
+            double im = scale * iq[(2 * i) + 1];
+
+            sum += std::complex<double>(re, im);
+            sumSquares += std::complex<double>((re * re) - (im * im), 2 * re * im);
+            power += (re * re) + (im * im);
+        }
+    }
+
+    // Captures numSamps samples after the discarded ones and measures their mean and image
+    static Measurement Measure(rx_streamer& streamer, RxCounters& counters, const std::string& cpuFormat, size_t numSamps, double timeout)
+    {
+        size_t bytesPerSample = convert::get_bytes_per_item(cpuFormat);
+        size_t total = RxCalibration::DiscardSamples + numSamps;
+        std::vector<char> buffer(total * bytesPerSample);
+
+        stream_cmd_t cmd(stream_cmd_t::STREAM_MODE_NUM_SAMPS_AND_DONE);
+        cmd.num_samps = total;
+        cmd.stream_now = true;
+        streamer.issue_stream_cmd(cmd);
+
+        for (size_t received = 0; received < total;)
+        {
+            rx_metadata_t metadata;
+            received += counters.Recv(streamer, rx_streamer::buffs_type(buffer.data() + (received * bytesPerSample)), total - received, metadata, timeout, false);
+
+            if (metadata.error_code != rx_metadata_t::ERROR_CODE_NONE)
+            {
+                throw uhd::runtime_error("The calibration capture failed: " + metadata.strerror());
+            }
+        }
+
+        const char* samples = buffer.data() + (RxCalibration::DiscardSamples * bytesPerSample);
+        std::complex<double> sum = 0;
+        std::complex<double> sumSquares = 0;
+        double power = 0;
+
+        if (cpuFormat == "fc64")
+        {
+            Accumulate(reinterpret_cast<const double*>(samples), numSamps, 1.0, sum, sumSquares, power);
+        }
+        else if (cpuFormat == "fc32")
+        {
+            Accumulate(reinterpret_cast<const float*>(samples), numSamps, 1.0, sum, sumSquares, power);
+        }
+        else if (cpuFormat == "sc16")
+        {
+            Accumulate(reinterpret_cast<const short*>(samples), numSamps, 1 / 32767.0, sum, sumSquares, power);
+        }
+        else if (cpuFormat == "sc8")
+        {
+            Accumulate(reinterpret_cast<const signed char*>(samples), numSamps, 1 / 127.0, sum, sumSquares, power);
+        }
+        else
+        {
+            throw uhd::value_error("The calibration can't read the CPU format " + cpuFormat);
+        }
+
+        // Without the mean: sum (x - m)^2 = sum x^2 - n * m^2, sum |x - m|^2 = sum |x|^2 - n * |m|^2
+        Measurement measurement;
+        measurement.mean = sum / static_cast<double>(numSamps);
+
+        double n = static_cast<double>(numSamps);
+        double acPower = power - (n * std::norm(measurement.mean));
+        measurement.image = acPower > 0 ? (sumSquares - (n * measurement.mean * measurement.mean)) / acPower : std::complex<double>(0);
+
+        return measurement;
+    }
+
+    static void SetCorrection(multi_usrp& usrp, size_t chan, std::complex<double> dcOffset, std::complex<double> iqBalance)
+    {
+        usrp.set_rx_dc_offset(dcOffset, chan);
+        usrp.set_rx_iq_balance(iqBalance, chan);
+    }
+
+    // One column of a response, from a probe along the real or the imaginary axis of the correction
+    static void ResponseColumn(std::complex<double> before, std::complex<double> after, double probe, double& re, double& im)
+    {
+        std::complex<double> column = (after - before) / probe;
+        re = column.real();
+        im = column.imag();
+    }
+
+    // What the correction changes the measurement by under r
+    static std::complex<double> Response(const CorrectionResponse& r, std::complex<double> correction)
+    {
+        return std::complex<double>((r.a * correction.real()) + (r.b * correction.imag()), (r.c * correction.real()) + (r.d * correction.imag()));
+    }
+
+    // The correction step that takes measured to 0 under r
+    static std::complex<double> NewtonStep(const CorrectionResponse& r, std::complex<double> measured)
+    {
+        double det = (r.a * r.d) - (r.b * r.c);
+
+        return std::complex<double>(((r.b * measured.imag()) - (r.d * measured.real())) / det, ((r.c * measured.real()) - (r.a * measured.imag())) / det);
+    }
+
+    static bool Invertible(const CorrectionResponse& r)
+    {
+        // Against 1 for a front end that applies the corrections one to one
+        return std::abs((r.a * r.d) - (r.b * r.c)) > 1e-3;
+    }
+
+    RxCalibration::RxCalibration() : hasResponse(false), hasLast(false)
+    {
+        dcResponse.a = dcResponse.b = dcResponse.c = dcResponse.d = 0;
+        imageResponse = dcResponse;
+    }
+
+    double RxCalibration::Now()
+    {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    RxCalibration::Key RxCalibration::KeyOf(double freq, double gain)
+    {
+        return Key(static_cast<long long>(std::floor((freq / FreqResolution) + 0.5)), static_cast<long long>(std::floor((gain / GainResolution) + 0.5)));
+    }
+
+    bool RxCalibration::Find(double freq, double gain, RxCorrection& correction) const
+    {
+        std::map<Key, RxCorrection>::const_iterator it = cache.find(KeyOf(freq, gain));
+        if (it == cache.end() || Now() - it->second.measuredAt > MaxAgeSeconds)
+        {
+            return false;
+        }
+
+        correction = it->second;
+        correction.cached = true;
+
+        return true;
+    }
+
+    RxCorrection RxCalibration::Calibrate(multi_usrp& usrp, rx_streamer& streamer, RxCounters& counters, const std::string& cpuFormat, size_t chan, size_t numSamps, double timeout)
+    {
+        if (numSamps < 1)
+        {
+            throw uhd::value_error("A calibration capture needs samples");
+        }
+
+        Key key = KeyOf(usrp.get_rx_freq(chan), usrp.get_rx_gain(chan));
+
+        // From the last correction here (even a stale one), else from the last one anywhere (the IQ imbalance and
+        // the DC offset of a front end change slowly with the frequency), else from none
+        std::complex<double> dcOffset = 0;
+        std::complex<double> iqBalance = 0;
+
+        std::map<Key, RxCorrection>::const_iterator it = cache.find(key);
+        if (it != cache.end())
+        {
+            dcOffset = it->second.dcOffset;
+            iqBalance = it->second.iqBalance;
+        }
+        else if (hasLast)
+        {
+            dcOffset = last.dcOffset;
+            iqBalance = last.iqBalance;
+        }
+
+        // The automatic DC offset tracking would fight the manual correction
+        usrp.set_rx_dc_offset(false, chan);
+        SetCorrection(usrp, chan, dcOffset, iqBalance);
+        Measurement m = Measure(streamer, counters, cpuFormat, numSamps, timeout);
+
+        if (!hasResponse)
+        {
+            // One correction at a time: the IQ balance correction moves the mean too (it scales Q, DC included),
+            // which the Newton steps below leave to the next measurement rather than to the response
+            SetCorrection(usrp, chan, dcOffset + DcProbe, iqBalance);
+            ResponseColumn(m.mean, Measure(streamer, counters, cpuFormat, numSamps, timeout).mean, DcProbe, dcResponse.a, dcResponse.c);
+
+            SetCorrection(usrp, chan, dcOffset + std::complex<double>(0, DcProbe), iqBalance);
+            ResponseColumn(m.mean, Measure(streamer, counters, cpuFormat, numSamps, timeout).mean, DcProbe, dcResponse.b, dcResponse.d);
+
+            SetCorrection(usrp, chan, dcOffset, iqBalance + ImageProbe);
+            ResponseColumn(m.image, Measure(streamer, counters, cpuFormat, numSamps, timeout).image, ImageProbe, imageResponse.a, imageResponse.c);
+
+            SetCorrection(usrp, chan, dcOffset, iqBalance + std::complex<double>(0, ImageProbe));
+            ResponseColumn(m.image, Measure(streamer, counters, cpuFormat, numSamps, timeout).image, ImageProbe, imageResponse.b, imageResponse.d);
+
+            if (!Invertible(dcResponse) || !Invertible(imageResponse))
+            {
+                SetCorrection(usrp, chan, dcOffset, iqBalance);
+                throw uhd::runtime_error("The samples do not respond to the DC offset or IQ balance correction of this front end");
+            }
+
+            hasResponse = true;
+        }
+
+        // The mean and the image are nulled side by side, each keeps its best correction
+        RxCorrection best;
+        best.dcOffset = dcOffset;
+        best.iqBalance = iqBalance;
+        best.residualDc = PowerDb(std::norm(m.mean));
+        best.residualImage = PowerDb(std::norm(m.image));
+        best.cached = false;
+        best.rejected = false;
+
+        RxCorrection start = best;
+
+        for (int step = 0; step < NewtonSteps; step++)
+        {
+            dcOffset += NewtonStep(dcResponse, m.mean);
+            iqBalance += NewtonStep(imageResponse, m.image);
+
+            SetCorrection(usrp, chan, dcOffset, iqBalance);
+            m = Measure(streamer, counters, cpuFormat, numSamps, timeout);
+
+            if (PowerDb(std::norm(m.mean)) < best.residualDc)
+            {
+                best.dcOffset = dcOffset;
+                best.residualDc = PowerDb(std::norm(m.mean));
+            }
+
+            if (PowerDb(std::norm(m.image)) < best.residualImage)
+            {
+                best.iqBalance = iqBalance;
+                best.residualImage = PowerDb(std::norm(m.image));
+            }
+        }
+
+        best.removedDc = PowerDb(std::norm(Response(dcResponse, best.dcOffset)));
+        best.measuredAt = Now();
+
+        if (best.removedDc > MaxRemovedDc)
+        {
+            // The image is measured against the same signal, so neither correction is trusted
+            start.removedDc = best.removedDc;
+            start.measuredAt = best.measuredAt;
+            best = start;
+            best.rejected = true;
+        }
+
+        SetCorrection(usrp, chan, best.dcOffset, best.iqBalance);
+
+        if (!best.rejected)
+        {
+            cache[key] = best;
+            last = best;
+            hasLast = true;
+        }
+
+        return best;
+    }
+
+    RxCorrection RxCalibration::Apply(multi_usrp& usrp, rx_streamer& streamer, RxCounters& counters, const std::string& cpuFormat, size_t chan, size_t numSamps, double timeout)
+    {
+        RxCorrection correction;
+        if (!Find(usrp.get_rx_freq(chan), usrp.get_rx_gain(chan), correction))
+        {
+            return Calibrate(usrp, streamer, counters, cpuFormat, chan, numSamps, timeout);
+        }
+
+        usrp.set_rx_dc_offset(false, chan);
+        SetCorrection(usrp, chan, correction.dcOffset, correction.iqBalance);
+
+        return correction;
+    }
+
+    void RxCalibration::Clear()
+    {
+        cache.clear();
+        hasLast = false;
+    }
+
+    size_t RxCalibration::Count() const
+    {
+        return cache.size();
+    }
+}}}}}
\ No newline at end of file
@@ -0,0 +1,106 @@
+#pragma once
+
+// Native DC offset and IQ balance calibration of an RX channel.
+
+#include <complex>
+#include <map>
+#include <string>
+#include <utility>
+#include <uhd/usrp/multi_usrp.hpp>
+#include "RxCounters.h"
+
+namespace Microsoft { namespace Spectrum { namespace Devices { namespace Usrp { namespace Native {
+
+    struct RxCorrection
+    {
+        // As passed to multi_usrp::set_rx_dc_offset and set_rx_iq_balance
+        std::complex<double> dcOffset;
+        std::complex<double> iqBalance;
+
+        // Left over with the correction applied: the power of the mean in dBFS, and the image metric
+        // |E[x^2]| / E[|x|^2] (0 for a balanced receiver) in dB
+        double residualDc;
+        double residualImage;
+
+        // The power in dBFS of the mean the DC offset correction removes
+        double removedDc;
+
+        // Found in the cache instead of measured
+        bool cached;
+
+        // The mean was above RxCalibration::MaxRemovedDc, more likely an emitter at the tuned frequency than LO
+        // leakage: the corrections were left as they were and nothing was cached
+        bool rejected;
+
+        // When it was measured, in seconds of a steady clock
+        double measuredAt;
+    };
+
+    // How a measurement responds to a correction, d(measured real, imaginary) / d(correction real, imaginary):
+    // [a b; c d]
+    struct CorrectionResponse
+    {
+        double a;
+        double b;
+        double c;
+        double d;
+    };
+
+    // Finds the DC offset and IQ balance corrections that null the mean and the image of a channel's samples, and
+    // caches them by frequency (to FreqResolution) and gain (to GainResolution), so a scan that comes back to a
+    // frequency only has to apply them.
+    //
+    // The mean is measured on live antenna samples, so an emitter within a few bins of the tuned frequency looks
+    // like a DC offset. A correction that removes more than MaxRemovedDc is rejected rather than cached, and cache
+    // entries are measured again after MaxAgeSeconds, so a correction taken while a weaker emitter sat on the
+    // center doesn't stay subtracted after it's gone.
+    //
+    // Front ends differ in the sign and scale of their corrections, so the calibration doesn't assume any: the
+    // first calibration measures how the mean responds to the DC offset correction and how the image responds to
+    // the IQ balance correction (a 2 x 2 real Jacobian each, 5 captures), and every calibration then takes Newton
+    // steps with that response. Each capture is numSamps samples after DiscardSamples that may still carry the
+    // transient of the stream start.
+    //
+    // Calibrating receives from the streamer with NUM_SAMPS_AND_DONE commands, nothing else may receive from it
+    // meanwhile. Not thread safe.
+    class RxCalibration
+    {
+        public:
+            static const double FreqResolution;
+            static const double GainResolution;
+            static const double MaxRemovedDc;
+            static const double MaxAgeSeconds;
+            static const size_t DiscardSamples = 256;
+
+            RxCalibration();
+
+            // The correction cached for freq and gain, if any that is younger than MaxAgeSeconds
+            bool Find(double freq, double gain, RxCorrection& correction) const;
+
+            // Measures the correction at the current frequency and gain of chan, applies it and caches it. The
+            // streamer must be made for chan alone, in cpuFormat. Throws uhd::runtime_error if a capture fails.
+            RxCorrection Calibrate(uhd::usrp::multi_usrp& usrp, uhd::rx_streamer& streamer, RxCounters& counters, const std::string& cpuFormat, size_t chan, size_t numSamps, double timeout);
+
+            // Applies the cached correction of the current frequency and gain of chan, calibrates if there is none
+            RxCorrection Apply(uhd::usrp::multi_usrp& usrp, uhd::rx_streamer& streamer, RxCounters& counters, const std::string& cpuFormat, size_t chan, size_t numSamps, double timeout);
+
+            void Clear();
+            size_t Count() const;
+
+        private:
+            typedef std::pair<long long, long long> Key;
+
+            std::map<Key, RxCorrection> cache;
+
+            bool hasResponse;
+            CorrectionResponse dcResponse;
+            CorrectionResponse imageResponse;
+
+            // Where the next calibration of a new frequency or gain starts from
+            bool hasLast;
+            RxCorrection last;
+
+            static Key KeyOf(double freq, double gain);
+            static double Now();
+    };
+}}}}}
\ No newline at end of file
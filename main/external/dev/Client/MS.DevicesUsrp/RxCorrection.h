@@ -0,0 +1,38 @@
+#pragma once
+
+using namespace System;
+using namespace System::Numerics;
+
+namespace Microsoft { namespace Spectrum { namespace Devices { namespace Usrp {
+
+    // The DC offset and IQ balance correction of an RX channel at one frequency and gain, as
+    // MultiUsrp::calibrate_rx_correction measured it or apply_rx_correction found it in the cache
+    public ref class RxCorrection
+    {
+        public:
+            // As passed to set_rx_dc_offset and set_rx_iq_balance
+            Complex DcOffset;
+            Complex IqBalance;
+
+            // Left over with the correction applied: the power of the mean in dBFS and the image metric
+            // |E[x^2]| / E[|x|^2] in dB
+            double ResidualDc;
+            double ResidualImage;
+
+            // The power in dBFS of the mean the DC offset correction removes
+            double RemovedDc;
+
+            // Found in the cache instead of measured
+            bool Cached;
+
+            // The mean looked like an emitter at the tuned frequency rather than LO leakage, so the corrections were
+            // left as they were and not cached
+            bool Rejected;
+
+            virtual String^ ToString() override
+            {
+                return String::Format("DcOffset: {0}, IqBalance: {1}, ResidualDc: {2:F1} dBFS, ResidualImage: {3:F1} dB, RemovedDc: {4:F1} dBFS, Cached: {5}, Rejected: {6}",
+                    DcOffset, IqBalance, ResidualDc, ResidualImage, RemovedDc, Cached, Rejected);
+            }
+    };
+}}}}
\ No newline at end of file
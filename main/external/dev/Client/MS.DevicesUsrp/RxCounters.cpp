@@ -0,0 +1,131 @@
+// RxCounters.cpp
+
+#include <atomic>
+#include <uhd/convert.hpp>
+#include <uhd/types/time_spec.hpp>
+#include "RxCounters.h"
+
+using namespace uhd;
+
+namespace Microsoft { namespace Spectrum { namespace Devices { namespace Usrp { namespace Native {
+
+    struct RxCounters::State
+    {
+        size_t bytesPerCall;
+
+        std::atomic<unsigned long long> recvCalls;
+        std::atomic<unsigned long long> samples;
+        std::atomic<unsigned long long> fragments;
+        std::atomic<unsigned long long> overflows;
+        std::atomic<unsigned long long> timeouts;
+        std::atomic<unsigned long long> lateCommands;
+        std::atomic<unsigned long long> otherErrors;
+        std::atomic<unsigned long long> latency[LatencyBuckets];
+
+        // Only the thread that receives writes, so plain loads and stores are enough and cost no locked instruction
+        static void Add(std::atomic<unsigned long long>& counter, unsigned long long value)
+        {
+            counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+        }
+
+        static size_t LatencyBucket(double seconds)
+        {
+            unsigned long long micros = static_cast<unsigned long long>(seconds * 1e6);
+            size_t bucket = 0;
+
+            while (micros > 0 && bucket < LatencyBuckets - 1)
+            {
+                micros >>= 1;
+                bucket++;
+            }
+
+            return bucket;
+        }
+    };
+
+    RxCounters::RxCounters(const std::string& cpuFormat, size_t channels)
+    {
+        state = new State();
+        state->bytesPerCall = convert::get_bytes_per_item(cpuFormat) * channels;
+        Reset();
+    }
+
+    RxCounters::~RxCounters()
+    {
+        delete state;
+    }
+
+    size_t RxCounters::Recv(rx_streamer& streamer, const rx_streamer::buffs_type& buffs, size_t samples, rx_metadata_t& metadata, double timeout, bool onePacket)
+    {
+        // get_system_time uses the high resolution performance counter
+        time_spec_t start = time_spec_t::get_system_time();
+        size_t received = streamer.recv(buffs, samples, metadata, timeout, onePacket);
+        double seconds = (time_spec_t::get_system_time() - start).get_real_secs();
+
+        State::Add(state->recvCalls, 1);
+        State::Add(state->samples, received);
+        State::Add(state->latency[State::LatencyBucket(seconds)], 1);
+
+        if (metadata.more_fragments)
+        {
+            State::Add(state->fragments, 1);
+        }
+
+        switch (metadata.error_code)
+        {
+            case rx_metadata_t::ERROR_CODE_NONE:
+                break;
+
+            case rx_metadata_t::ERROR_CODE_OVERFLOW:
+                State::Add(state->overflows, 1);
+                break;
+
+            case rx_metadata_t::ERROR_CODE_TIMEOUT:
+                State::Add(state->timeouts, 1);
+                break;
+
+            case rx_metadata_t::ERROR_CODE_LATE_COMMAND:
+                State::Add(state->lateCommands, 1);
+                break;
+
+            default:
+                State::Add(state->otherErrors, 1);
+                break;
+        }
+
+        return received;
+    }
+
+    void RxCounters::Read(RxCounterValues& values) const
+    {
+        values.recvCalls = state->recvCalls.load(std::memory_order_relaxed);
+        values.samples = state->samples.load(std::memory_order_relaxed);
+        values.bytes = values.samples * state->bytesPerCall;
+        values.fragments = state->fragments.load(std::memory_order_relaxed);
+        values.overflows = state->overflows.load(std::memory_order_relaxed);
+        values.timeouts = state->timeouts.load(std::memory_order_relaxed);
+        values.lateCommands = state->lateCommands.load(std::memory_order_relaxed);
+        values.otherErrors = state->otherErrors.load(std::memory_order_relaxed);
+
+        for (size_t i = 0; i < LatencyBuckets; i++)
+        {
+            values.latency[i] = state->latency[i].load(std::memory_order_relaxed);
+        }
+    }
+
+    void RxCounters::Reset()
+    {
+        state->recvCalls = 0;
+        state->samples = 0;
+        state->fragments = 0;
+        state->overflows = 0;
+        state->timeouts = 0;
+        state->lateCommands = 0;
+        state->otherErrors = 0;
+
+        for (size_t i = 0; i < LatencyBuckets; i++)
+        {
+            state->latency[i] = 0;
+        }
+    }
+}}}}}
@@ -0,0 +1,57 @@
+#pragma once
+
+// Native receive counters of one rx_streamer. RxCounters.cpp is compiled as native code because <atomic> can't
+// be used under /clr, which is also why the counters stay hidden behind State.
+
+#include <string>
+#include <uhd/stream.hpp>
+#include <uhd/types/metadata.hpp>
+
+namespace Microsoft { namespace Spectrum { namespace Devices { namespace Usrp { namespace Native {
+
+    // Bucket 0 counts recv calls that took less than 1 us, bucket i (0 < i < LatencyBuckets - 1) the ones that took
+    // [2^(i-1), 2^i) us and the last bucket everything longer
+    static const size_t LatencyBuckets = 24;
+
+    struct RxCounterValues
+    {
+        unsigned long long recvCalls;
+        unsigned long long samples;
+        unsigned long long bytes;
+
+        // Calls that returned part of a packet, the rest comes with the next call
+        unsigned long long fragments;
+
+        unsigned long long overflows;
+        unsigned long long timeouts;
+        unsigned long long lateCommands;
+
+        // Broken chain, alignment and bad packet errors
+        unsigned long long otherErrors;
+
+        unsigned long long latency[LatencyBuckets];
+    };
+
+    // Counts every recv made through Recv. Only one thread may receive at a time (as with UHD's recv itself),
+    // any thread may Read. A Reset while a recv is in flight may keep that call's counts.
+    class RxCounters
+    {
+        public:
+            // bytes counts samples * channels * the size of one sample of cpuFormat
+            RxCounters(const std::string& cpuFormat, size_t channels);
+            ~RxCounters();
+
+            // streamer.recv, timed and counted
+            size_t Recv(uhd::rx_streamer& streamer, const uhd::rx_streamer::buffs_type& buffs, size_t samples, uhd::rx_metadata_t& metadata, double timeout, bool onePacket);
+
+            void Read(RxCounterValues& values) const;
+            void Reset();
+
+        private:
+            struct State;
+            State* state;
+
+            RxCounters(const RxCounters&);
+            RxCounters& operator=(const RxCounters&);
+    };
+}}}}}
\ No newline at end of file
@@ -0,0 +1,325 @@
+// RxQueue.cpp
+
+#include <malloc.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include "RxQueue.h"
+
+using namespace uhd;
+
+namespace Microsoft { namespace Spectrum { namespace Devices { namespace Usrp { namespace Native {
+
+    // Blocks start on cache line boundaries, like RxBlockRing's
+    static const size_t Alignment = 64;
+
+    size_t FillBlocks(rx_streamer& streamer, RxCounters& counters, const std::vector<void*>& blocks, size_t bytesPerSample, size_t samplesPerBlock, rx_metadata_t& first, double timeout)
+    {
+        std::vector<void*> nBuffs(blocks.size());
+        size_t received = 0;
+        rx_metadata_t nmd;
+
+        while (received < samplesPerBlock)
+        {
+            for (size_t i = 0; i < blocks.size(); i++)
+            {
+                nBuffs[i] = static_cast<unsigned char*>(blocks[i]) + (received * bytesPerSample);
+            }
+
+            size_t sampleCount = counters.Recv(streamer, nBuffs, samplesPerBlock - received, nmd, timeout, false);
+
+            if (received == 0)
+            {
+                first = nmd;
+            }
+            else if (first.error_code == rx_metadata_t::ERROR_CODE_NONE)
+            {
+                first.error_code = nmd.error_code;
+            }
+
+            received += sampleCount;
+
+            if (nmd.error_code != rx_metadata_t::ERROR_CODE_NONE || sampleCount == 0 || nmd.end_of_burst)
+            {
+                break;
+            }
+        }
+
+        first.more_fragments = nmd.more_fragments;
+        first.end_of_burst = nmd.end_of_burst;
+
+        return received;
+    }
+
+    struct RxQueue::State
+    {
+        rx_streamer::sptr streamer;
+        boost::shared_ptr<RxCounters> counters;
+        size_t blockCount;
+        size_t samplesPerBlock;
+        size_t bytesPerSample;
+        size_t channels;
+        size_t blockBytes;
+
+        // blockCount slots of channels blocks each, plus the spare slot the producer drops blocks into
+        unsigned char* memory;
+        std::vector<RxQueueBlock> blocks;
+
+        // Sequence numbers of the next block to queue and of the oldest block not yet popped. written is only
+        // changed by the producer, released only by the consumer.
+        std::atomic<unsigned long long> written;
+        std::atomic<unsigned long long> released;
+
+        std::mutex mutex;
+        std::condition_variable queued;
+
+        std::thread thread;
+        std::atomic<bool> stopping;
+        std::atomic<bool> failed;
+        std::string error;
+
+        std::atomic<unsigned long long> dropped;
+        std::atomic<unsigned long long> overflows;
+        std::atomic<unsigned long long> errors;
+
+        void* Samples(size_t slot, size_t channel) const
+        {
+            return memory + (((slot * channels) + channel) * blockBytes);
+        }
+
+        void Produce(double recvTimeout)
+        {
+            std::vector<void*> buffs(channels);
+            rx_metadata_t nmd;
+
+            try
+            {
+                while (!stopping)
+                {
+                    unsigned long long sequence = written;
+                    bool full = sequence - released >= blockCount;
+                    size_t slot = full ? blockCount : static_cast<size_t>(sequence % blockCount);
+
+                    for (size_t channel = 0; channel < channels; channel++)
+                    {
+                        buffs[channel] = Samples(slot, channel);
+                    }
+
+                    size_t sampleCount = FillBlocks(*streamer, *counters, buffs, bytesPerSample, samplesPerBlock, nmd, recvTimeout);
+
+                    if (nmd.error_code == rx_metadata_t::ERROR_CODE_OVERFLOW)
+                    {
+                        overflows++;
+                    }
+                    else if (nmd.error_code != rx_metadata_t::ERROR_CODE_NONE && nmd.error_code != rx_metadata_t::ERROR_CODE_TIMEOUT)
+                    {
+                        errors++;
+                    }
+
+                    // Idle, nothing is streaming
+                    if (sampleCount == 0 && nmd.error_code == rx_metadata_t::ERROR_CODE_TIMEOUT)
+                    {
+                        continue;
+                    }
+
+                    if (full)
+                    {
+                        dropped++;
+                        continue;
+                    }
+
+                    RxQueueBlock& block = blocks[slot];
+                    block.sequence = sequence;
+                    block.slot = slot;
+                    block.sampleCount = sampleCount;
+                    block.metadata = nmd;
+
+                    {
+                        std::lock_guard<std::mutex> lock(mutex);
+                        written = sequence + 1;
+                    }
+
+                    queued.notify_one();
+                }
+            }
+            catch (const std::exception& ex)
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                error = ex.what();
+                failed = true;
+            }
+
+            queued.notify_one();
+        }
+    };
+
+    RxQueue::RxQueue(rx_streamer::sptr streamer, boost::shared_ptr<RxCounters> counters, size_t blockCount, size_t samplesPerBlock, size_t bytesPerSample)
+    {
+        if (streamer == NULL || counters == NULL || blockCount < 1 || samplesPerBlock < 1 || bytesPerSample < 1)
+        {
+            throw std::invalid_argument("RxQueue needs a streamer, counters and at least one block of one sample");
+        }
+
+        state = new State();
+        state->streamer = streamer;
+        state->counters = counters;
+        state->blockCount = blockCount;
+        state->samplesPerBlock = samplesPerBlock;
+        state->bytesPerSample = bytesPerSample;
+        state->channels = streamer->get_num_channels();
+        state->blockBytes = (((samplesPerBlock * bytesPerSample) + Alignment - 1) / Alignment) * Alignment;
+        state->written = 0;
+        state->released = 0;
+        state->stopping = false;
+        state->failed = false;
+        state->dropped = 0;
+        state->overflows = 0;
+        state->errors = 0;
+
+        state->memory = static_cast<unsigned char*>(_aligned_malloc(state->blockBytes * state->channels * (blockCount + 1), Alignment));
+        if (state->memory == NULL)
+        {
+            delete state;
+            throw std::bad_alloc();
+        }
+
+        state->blocks.resize(blockCount);
+    }
+
+    RxQueue::~RxQueue()
+    {
+        Stop();
+
+        _aligned_free(state->memory);
+        delete state;
+    }
+
+    void RxQueue::Start(double recvTimeout)
+    {
+        if (state->thread.joinable())
+        {
+            return;
+        }
+
+        state->stopping = false;
+        state->failed = false;
+        state->error.clear();
+
+        State* s = state;
+        state->thread = std::thread([s, recvTimeout]() { s->Produce(recvTimeout); });
+    }
+
+    void RxQueue::Stop()
+    {
+        if (!state->thread.joinable())
+        {
+            return;
+        }
+
+        state->stopping = true;
+        state->thread.join();
+    }
+
+    bool RxQueue::IsRunning() const
+    {
+        return state->thread.joinable() && !state->failed;
+    }
+
+    bool RxQueue::HasFailed() const
+    {
+        return state->failed;
+    }
+
+    std::string RxQueue::Error() const
+    {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        return state->error;
+    }
+
+    bool RxQueue::Front(RxQueueBlock& block, double timeout)
+    {
+        unsigned long long sequence = state->released;
+
+        if (state->written == sequence)
+        {
+            std::unique_lock<std::mutex> lock(state->mutex);
+            std::chrono::duration<double> wait(timeout);
+
+            if (!state->queued.wait_for(lock, wait, [this, sequence]() { return state->written != sequence || state->failed; })
+                || state->written == sequence)
+            {
+                return false;
+            }
+        }
+
+        block = state->blocks[static_cast<size_t>(sequence % state->blockCount)];
+        return true;
+    }
+
+    void RxQueue::PopFront()
+    {
+        if (state->written != state->released)
+        {
+            state->released++;
+        }
+    }
+
+    void RxQueue::Clear()
+    {
+        state->released = state->written.load();
+    }
+
+    void* RxQueue::Samples(size_t slot, size_t channel) const
+    {
+        return state->Samples(slot, channel);
+    }
+
+    size_t RxQueue::Count() const
+    {
+        return static_cast<size_t>(state->written - state->released);
+    }
+
+    size_t RxQueue::BlockCount() const
+    {
+        return state->blockCount;
+    }
+
+    size_t RxQueue::SamplesPerBlock() const
+    {
+        return state->samplesPerBlock;
+    }
+
+    size_t RxQueue::BytesPerSample() const
+    {
+        return state->bytesPerSample;
+    }
+
+    size_t RxQueue::Channels() const
+    {
+        return state->channels;
+    }
+
+    unsigned long long RxQueue::QueuedBlocks() const
+    {
+        return state->written;
+    }
+
+    unsigned long long RxQueue::DroppedBlocks() const
+    {
+        return state->dropped;
+    }
+
+    unsigned long long RxQueue::Overflows() const
+    {
+        return state->overflows;
+    }
+
+    unsigned long long RxQueue::Errors() const
+    {
+        return state->errors;
+    }
+}}}}}
@@ -0,0 +1,89 @@
+#pragma once
+
+// Native receive side: a producer thread that drains an rx_streamer into a bounded single producer, single
+// consumer queue of blocks. RxQueue.cpp is compiled as native code because <thread>, <mutex> and <atomic> can't
+// be used under /clr, which is also why the thread and its synchronization stay hidden behind State.
+
+#include <string>
+#include <vector>
+#include <uhd/stream.hpp>
+#include <uhd/types/metadata.hpp>
+#include "RxCounters.h"
+
+namespace Microsoft { namespace Spectrum { namespace Devices { namespace Usrp { namespace Native {
+
+    // Receives into one block per channel (blocks) until samplesPerBlock samples arrived, an error (e.g. a timeout
+    // or an overflow) occurred or the burst ended. first gets the metadata of the first fragment, with the first
+    // error and the burst flags of the last one. Returns the number of samples per channel received. Every recv
+    // is counted in counters.
+    size_t FillBlocks(uhd::rx_streamer& streamer, RxCounters& counters, const std::vector<void*>& blocks, size_t bytesPerSample, size_t samplesPerBlock, uhd::rx_metadata_t& first, double timeout);
+
+    struct RxQueueBlock
+    {
+        // Counts the blocks queued since the queue was created
+        unsigned long long sequence;
+
+        // Pass to RxQueue::Samples
+        size_t slot;
+
+        size_t sampleCount;
+        uhd::rx_metadata_t metadata;
+    };
+
+    // Bounded queue of fixed size blocks filled by a thread of its own, in the spirit of
+    // uhd/transport/bounded_buffer.hpp but without copying: the producer receives straight into the next free
+    // block and the consumer reads it in place until PopFront.
+    //
+    // The producer never waits for the consumer. When the consumer still holds every block, the producer keeps
+    // draining the streamer into a spare block and drops it, so a slow consumer shows up in DroppedBlocks
+    // instead of overflowing the device. Overflows the device reports anyway are counted in Overflows.
+    class RxQueue
+    {
+        public:
+            RxQueue(uhd::rx_streamer::sptr streamer, boost::shared_ptr<RxCounters> counters, size_t blockCount, size_t samplesPerBlock, size_t bytesPerSample);
+            ~RxQueue();
+
+            // Starts the producer thread. Every recv waits at most recvTimeout seconds, which bounds how long Stop
+            // takes; a timeout with nothing received (no stream command outstanding) is not an error.
+            void Start(double recvTimeout);
+
+            // Stops and joins the producer thread, the blocks queued so far stay queued
+            void Stop();
+
+            bool IsRunning() const;
+
+            // Set when recv threw, the thread has stopped then and Error says why
+            bool HasFailed() const;
+            std::string Error() const;
+
+            // Waits up to timeout seconds for a block, block is the oldest one queued. False if none arrived in
+            // time or the producer failed.
+            bool Front(RxQueueBlock& block, double timeout);
+
+            // Frees the oldest block for the producer
+            void PopFront();
+
+            // Frees every queued block
+            void Clear();
+
+            void* Samples(size_t slot, size_t channel) const;
+
+            size_t Count() const;
+            size_t BlockCount() const;
+            size_t SamplesPerBlock() const;
+            size_t BytesPerSample() const;
+            size_t Channels() const;
+
+            unsigned long long QueuedBlocks() const;
+            unsigned long long DroppedBlocks() const;
+            unsigned long long Overflows() const;
+            unsigned long long Errors() const;
+
+        private:
+            struct State;
+            State* state;
+
+            RxQueue(const RxQueue&);
+            RxQueue& operator=(const RxQueue&);
+    };
+}}}}}
\ No newline at end of file
@@ -0,0 +1,183 @@
+#pragma once
+
+#include "RxBlockRing.h"
+#include "RxQueue.h"
+#include "RxStreamer.h"
+
+using namespace System;
+using namespace System::Runtime::InteropServices;
+
+namespace Microsoft { namespace Spectrum { namespace Devices { namespace Usrp {
+
+    // Receives on a native thread of its own, so the device keeps streaming while the caller processes.
+    //
+    // The thread drains the streamer into a bounded queue of blockCount blocks (see Native::RxQueue). The caller
+    // takes blocks in order with TryGetBlock, reads them in place and hands them back with Release. When the
+    // caller falls behind and holds every block, further blocks are dropped and counted in DroppedBlocks, the
+    // device itself does not overflow. Only one thread may consume.
+    public ref class RxReceiveThread : IDisposable
+    {
+        private:
+            Native::RxQueue* queue;
+
+            // Keeps the streamer alive as long as the thread uses it
+            RxStreamer^ streamer;
+
+        public:
+            // cpuFormat is the CpuFormat of the streamer, samplesPerBlock the samples per channel of every block
+            RxReceiveThread(RxStreamer^ streamer, size_t blockCount, size_t samplesPerBlock, String^ cpuFormat)
+            {
+                if (streamer == nullptr)
+                {
+                    throw gcnew ArgumentNullException("streamer");
+                }
+
+                if (blockCount < 1)
+                {
+                    throw gcnew ArgumentOutOfRangeException("blockCount");
+                }
+
+                if (samplesPerBlock < 1)
+                {
+                    throw gcnew ArgumentOutOfRangeException("samplesPerBlock");
+                }
+
+                size_t bytesPerSample = RxBlockRing::BytesPerSampleOf(cpuFormat);
+
+                this->streamer = streamer;
+
+                try
+                {
+                    queue = new Native::RxQueue(*streamer->pStreamer, *streamer->pCounters, blockCount, samplesPerBlock, bytesPerSample);
+                }
+                catch (const std::bad_alloc&)
+                {
+                    throw gcnew OutOfMemoryException("Unable to allocate the receive queue");
+                }
+            }
+
+            ~RxReceiveThread() { this->!RxReceiveThread(); }
+
+            !RxReceiveThread()
+            {
+                // Stops the thread first
+                delete queue;
+                queue = NULL;
+            }
+
+            // Every recv of the thread waits at most recvTimeout seconds, that is also how long Stop can take
+            void Start(double recvTimeout)
+            {
+                queue->Start(recvTimeout);
+            }
+
+            void Stop()
+            {
+                queue->Stop();
+            }
+
+            // The oldest block received, waiting up to timeout seconds for one. False if none arrived in time.
+            // Throws if the thread stopped because the streamer failed.
+            bool TryGetBlock([Out] RxBlock% block, double timeout)
+            {
+                Native::RxQueueBlock nBlock;
+                if (!queue->Front(nBlock, timeout))
+                {
+                    block = RxBlock();
+
+                    if (queue->HasFailed())
+                    {
+                        throw gcnew InvalidOperationException(String::Format("The receive thread failed: {0}", gcnew String(queue->Error().c_str())));
+                    }
+
+                    return false;
+                }
+
+                block.Sequence = nBlock.sequence;
+                block.Samples = IntPtr(queue->Samples(nBlock.slot, 0));
+                block.SampleCount = nBlock.sampleCount;
+                block.Metadata.Set(nBlock.metadata);
+
+                return true;
+            }
+
+            // The samples of one channel of a multi-channel block, block.Samples is channel 0
+            IntPtr GetSamples(RxBlock block, size_t channel)
+            {
+                if (channel >= queue->Channels())
+                {
+                    throw gcnew ArgumentOutOfRangeException("channel");
+                }
+
+                return IntPtr(queue->Samples(static_cast<size_t>(block.Sequence % queue->BlockCount()), channel));
+            }
+
+            // Hands the oldest block back to the thread. Blocks are released in the order they were received.
+            void Release(RxBlock block)
+            {
+                Native::RxQueueBlock nBlock;
+                if (!queue->Front(nBlock, 0) || static_cast<Int64>(nBlock.sequence) != block.Sequence)
+                {
+                    throw gcnew InvalidOperationException(String::Format("Block {0} is not the oldest block held", block.Sequence));
+                }
+
+                queue->PopFront();
+            }
+
+            // Drops every block received so far, e.g. after a retune
+            void Clear()
+            {
+                queue->Clear();
+            }
+
+            property bool IsRunning
+            {
+                bool get() { return queue->IsRunning(); }
+            }
+
+            property size_t BlockCount
+            {
+                size_t get() { return queue->BlockCount(); }
+            }
+
+            property size_t SamplesPerBlock
+            {
+                size_t get() { return queue->SamplesPerBlock(); }
+            }
+
+            property size_t Channels
+            {
+                size_t get() { return queue->Channels(); }
+            }
+
+            // Blocks waiting to be taken or released
+            property int Count
+            {
+                int get() { return static_cast<int>(queue->Count()); }
+            }
+
+            // Blocks queued since the thread was created
+            property UInt64 QueuedBlocks
+            {
+                UInt64 get() { return queue->QueuedBlocks(); }
+            }
+
+            // Blocks received while every block was held and thrown away
+            property UInt64 DroppedBlocks
+            {
+                UInt64 get() { return queue->DroppedBlocks(); }
+            }
+
+            // Overflows the device reported, i.e. samples lost before they reached the thread
+            property UInt64 Overflows
+            {
+                UInt64 get() { return queue->Overflows(); }
+            }
+
+            // Other receive errors (late command, broken chain, alignment, bad packet)
+            property UInt64 Errors
+            {
+                UInt64 get() { return queue->Errors(); }
+            }
+    };
+}}}}
\ No newline at end of file
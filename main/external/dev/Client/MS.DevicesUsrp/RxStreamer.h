@@ -1,6 +1,10 @@
 #pragma once
 
 #include "RxMetadata.h"
+#include "RxBlockRing.h"
+#include "RxQueue.h"
+#include "RxCounters.h"
+#include "RxStreamerCounters.h"
 
 using namespace System;
 using namespace System::Runtime::InteropServices;
@@ -32,18 +36,239 @@ namespace Microsoft { namespace Spectrum { namespace Devices { namespace Usrp {
                 nBuffs.push_back(np);
 
                 rx_metadata_t nmd;
-                size_t sampleCount = (*pStreamer)->recv(nBuffs, samplesPerBuffer, nmd, timeout, onePacket);
+                size_t sampleCount = (*pCounters)->Recv(**pStreamer, nBuffs, samplesPerBuffer, nmd, timeout, onePacket);
 
-                md = gcnew RxMetadata();
+                md = ToRxMetadata(nmd);
+
+                return sampleCount;
+            }
+
+            // Receives straight into native memory (e.g. an FftwInterop SampleBuffer), so nothing has to be pinned per call.
+            // The buffer must hold samplesPerBuffer samples of the CpuFormat the streamer was created with.
+            size_t Receive(IntPtr buff, size_t samplesPerBuffer, [Out] RxMetadata^% md, double timeout, bool onePacket)
+            {
+                std::vector<void*> nBuffs;
+                nBuffs.push_back(buff.ToPointer());
+
+                rx_metadata_t nmd;
+                size_t sampleCount = (*pCounters)->Recv(**pStreamer, nBuffs, samplesPerBuffer, nmd, timeout, onePacket);
+
+                md = ToRxMetadata(nmd);
+
+                return sampleCount;
+            }
+
+            // Receive into native memory without allocating: md is preallocated by the caller and filled in place,
+            // including its TimeSpec, so a receive loop can reuse one RxMetadata for every call.
+            size_t Receive(IntPtr buff, size_t samplesPerBuffer, RxMetadata^ md, double timeout, bool onePacket)
+            {
+                if (md == nullptr)
+                {
+                    throw gcnew ArgumentNullException("md");
+                }
+
+                rx_metadata_t nmd;
+                size_t sampleCount = (*pCounters)->Recv(**pStreamer, rx_streamer::buffs_type(buff.ToPointer()), samplesPerBuffer, nmd, timeout, onePacket);
+
+                SetRxMetadata(md, nmd);
+
+                return sampleCount;
+            }
+
+            // Receive into native memory without allocating, the metadata is returned by value
+            size_t Receive(IntPtr buff, size_t samplesPerBuffer, [Out] RxBlockMetadata% md, double timeout, bool onePacket)
+            {
+                rx_metadata_t nmd;
+                size_t sampleCount = (*pCounters)->Recv(**pStreamer, rx_streamer::buffs_type(buff.ToPointer()), samplesPerBuffer, nmd, timeout, onePacket);
+
+                md.Set(nmd);
+
+                return sampleCount;
+            }
+
+            // Receives samplesPerBuffer samples of every channel in one call, with one buffer per channel in the order
+            // of StreamArgs::Channels (see get_num_channels). UHD keeps the channels time aligned.
+            size_t Receive(cli::array<IntPtr>^ buffs, size_t samplesPerBuffer, [Out] RxMetadata^% md, double timeout, bool onePacket)
+            {
+                CheckChannelCount(buffs->Length, "buffs");
+
+                std::vector<void*> nBuffs(buffs->Length);
+                for (int i = 0; i < buffs->Length; i++)
+                {
+                    nBuffs[i] = buffs[i].ToPointer();
+                }
+
+                rx_metadata_t nmd;
+                size_t sampleCount = (*pCounters)->Recv(**pStreamer, nBuffs, samplesPerBuffer, nmd, timeout, onePacket);
+
+                md = ToRxMetadata(nmd);
+
+                return sampleCount;
+            }
+
+            // Multi-channel Receive without allocating, the metadata is returned by value
+            size_t Receive(cli::array<IntPtr>^ buffs, size_t samplesPerBuffer, [Out] RxBlockMetadata% md, double timeout, bool onePacket)
+            {
+                CheckChannelCount(buffs->Length, "buffs");
+
+                // An IntPtr is laid out as a void*, so the pinned array is handed to UHD as it is instead of being
+                // copied into a vector
+                pin_ptr<IntPtr> mpBuffs = &buffs[0];
+                rx_streamer::buffs_type nBuffs(reinterpret_cast<void* const*>(mpBuffs), buffs->Length);
+
+                rx_metadata_t nmd;
+                size_t sampleCount = (*pCounters)->Recv(**pStreamer, nBuffs, samplesPerBuffer, nmd, timeout, onePacket);
+
+                md.Set(nmd);
+
+                return sampleCount;
+            }
+
+            // Receives the next block of ring->SamplesPerBlock samples into the ring, UHD writes straight into the
+            // ring's native memory. Fragments are received until the block is full or an error (e.g. a timeout or
+            // an overflow) or the end of the burst ends it early; the block's metadata has the time spec of its first
+            // sample and the first error. The block is published even when it's short, its SampleCount says how much arrived.
+            // The ring must have been created with the CpuFormat of the streamer.
+            size_t ReceiveBlock(RxBlockRing^ ring, double timeout)
+            {
+                CheckChannelCount(1, "ring");
+
+                std::vector<void*> blocks(1);
+                blocks[0] = BeginWrite(ring);
+
+                rx_metadata_t nmd;
+                size_t received = Native::FillBlocks(**pStreamer, **pCounters, blocks, ring->BytesPerSample, ring->SamplesPerBlock, nmd, timeout);
+
+                ring->EndWrite(received, nmd);
+
+                return received;
+            }
+
+            // ReceiveBlock for a multi-channel streamer: one ring per channel, in the order of StreamArgs::Channels,
+            // all with the same block size. Every ring gets a block with the same samples count and metadata.
+            size_t ReceiveBlock(cli::array<RxBlockRing^>^ rings, double timeout)
+            {
+                CheckChannelCount(rings->Length, "rings");
+
+                std::vector<void*> blocks(rings->Length);
+                for (int i = 0; i < rings->Length; i++)
+                {
+                    if (rings[i]->SamplesPerBlock != rings[0]->SamplesPerBlock || rings[i]->BytesPerSample != rings[0]->BytesPerSample)
+                    {
+                        throw gcnew ArgumentException("The rings of all channels need the same block size", "rings");
+                    }
+
+                    blocks[i] = BeginWrite(rings[i]);
+                }
+
+                rx_metadata_t nmd;
+                size_t received = Native::FillBlocks(**pStreamer, **pCounters, blocks, rings[0]->BytesPerSample, rings[0]->SamplesPerBlock, nmd, timeout);
+
+                for (int i = 0; i < rings->Length; i++)
+                {
+                    rings[i]->EndWrite(received, nmd);
+                }
+
+                return received;
+            }
+
+            // Number of channels the streamer receives, i.e. the number of buffers every receive takes
+            size_t get_num_channels()
+            {
+                return (*pStreamer)->get_num_channels();
+            }
+
+            // The CpuFormat the streamer was created with
+            property String^ CpuFormat
+            {
+                String^ get()
+                {
+                    return cpuFormat;
+                }
+            }
+
+            // Largest number of samples a single packet carries
+            size_t get_max_num_samps()
+            {
+                return (*pStreamer)->get_max_num_samps();
+            }
+
+            // What every receive so far (including those of an RxReceiveThread on this streamer) counted: samples,
+            // bytes, fragments, errors by kind and a histogram of recv latencies. Reading them costs no more than
+            // copying a few dozen integers.
+            RxStreamerCounters^ GetCounters()
+            {
+                RxStreamerCounters^ ret = gcnew RxStreamerCounters();
+                GetCounters(ret);
+
+                return ret;
+            }
+
+            // GetCounters into a preallocated instance, so that polling them allocates nothing
+            void GetCounters(RxStreamerCounters^ values)
+            {
+                if (values == nullptr)
+                {
+                    throw gcnew ArgumentNullException("values");
+                }
+
+                Native::RxCounterValues nValues;
+                (*pCounters)->Read(nValues);
+
+                values->Set(nValues);
+            }
+
+            void ResetCounters()
+            {
+                (*pCounters)->Reset();
+            }
+
+        private:
+            void CheckChannelCount(int buffers, String^ paramName)
+            {
+                if (static_cast<size_t>(buffers) != (*pStreamer)->get_num_channels())
+                {
+                    throw gcnew ArgumentException(String::Format("The streamer receives {0} channels, {1} buffers were given",
+                        (*pStreamer)->get_num_channels(), buffers), paramName);
+                }
+            }
+
+            static void* BeginWrite(RxBlockRing^ ring)
+            {
+                unsigned char* block = ring->BeginWrite();
+                if (block == NULL)
+                {
+                    throw gcnew InvalidOperationException("Every block of the ring is still held, release one first");
+                }
+
+                return block;
+            }
+
+            static RxMetadata^ ToRxMetadata(const rx_metadata_t& nmd)
+            {
+                RxMetadata^ md = gcnew RxMetadata();
+                SetRxMetadata(md, nmd);
+
+                return md;
+            }
+
+            // Fills md in place, it only allocates a TimeSpec the first time
+            static void SetRxMetadata(RxMetadata^ md, const rx_metadata_t& nmd)
+            {
                 md->EndOfBurst = nmd.end_of_burst;
                 md->ErrorCode = static_cast<RxErrorCode>(nmd.error_code);
                 md->FragmentOffset = nmd.fragment_offset;
                 md->HasTimeSpec = nmd.has_time_spec;
                 md->MoreFragments = nmd.more_fragments;
                 md->StartOfBurst = nmd.start_of_burst;
-                md->TimeSpec = gcnew TimeSpec(nmd.time_spec.get_full_secs(), nmd.time_spec.get_frac_secs());
 
-                return sampleCount;
+                if (md->TimeSpec == nullptr)
+                {
+                    md->TimeSpec = gcnew TimeSpec();
+                }
+
+                md->TimeSpec->FullSeconds = nmd.time_spec.get_full_secs();
+                md->TimeSpec->FractionalSeconds = nmd.time_spec.get_frac_secs();
             }
 
         internal:
@@ -52,13 +277,29 @@ namespace Microsoft { namespace Spectrum { namespace Devices { namespace Usrp {
             // Therefore, we create a ptr to a shared_ptr in order to make everyone happy
             boost::shared_ptr<rx_streamer>* pStreamer;
 
-            RxStreamer(boost::shared_ptr<rx_streamer> pStreamer)
+            // Counts every recv on the streamer, whichever way it receives. Shared with the RxQueue of an
+            // RxReceiveThread, whose thread may still be receiving when this is finalized.
+            boost::shared_ptr<Native::RxCounters>* pCounters;
+
+            String^ cpuFormat;
+
+            // cpuFormat is the CpuFormat the streamer was created with
+            RxStreamer(boost::shared_ptr<rx_streamer> pStreamer, const std::string& cpuFormat)
             {
+                this->pCounters = new boost::shared_ptr<Native::RxCounters>(new Native::RxCounters(cpuFormat, pStreamer->get_num_channels()));
+                this->cpuFormat = gcnew String(cpuFormat.c_str());
                 this->pStreamer = new  boost::shared_ptr<rx_streamer>();
                 pStreamer.swap(*(this->pStreamer));
             }
 
             ~RxStreamer() { this->!RxStreamer(); }
-            !RxStreamer() { delete pStreamer; }
+            !RxStreamer()
+            {
+                delete pStreamer;
+                pStreamer = NULL;
+
+                delete pCounters;
+                pCounters = NULL;
+            }
     };
 }}}}
\ No newline at end of file
@@ -0,0 +1,85 @@
+#pragma once
+
+#include "RxCounters.h"
+
+using namespace System;
+
+namespace Microsoft { namespace Spectrum { namespace Devices { namespace Usrp {
+
+    // What an RxStreamer received so far, see RxStreamer::GetCounters. Rising Overflows or Timeouts, or recv
+    // latencies piling up in the top buckets, show the transport saturating before a receive fails outright.
+    public ref class RxStreamerCounters
+    {
+        public:
+            literal int LatencyBuckets = static_cast<int>(Native::LatencyBuckets);
+
+            RxStreamerCounters()
+            {
+                RecvLatency = gcnew cli::array<UInt64>(LatencyBuckets);
+            }
+
+            UInt64 RecvCalls;
+            UInt64 Samples;
+            UInt64 Bytes;
+
+            // recv calls that returned part of a packet
+            UInt64 Fragments;
+
+            UInt64 Overflows;
+            UInt64 Timeouts;
+            UInt64 LateCommands;
+
+            // Broken chain, alignment and bad packet errors
+            UInt64 OtherErrors;
+
+            // Histogram of how long recv calls took, see LatencyBucketUpperBoundSeconds
+            cli::array<UInt64>^ RecvLatency;
+
+            // recv calls in RecvLatency[bucket] took less than this, the last bucket has no bound
+            static double LatencyBucketUpperBoundSeconds(int bucket)
+            {
+                if (bucket < 0 || bucket >= LatencyBuckets)
+                {
+                    throw gcnew ArgumentOutOfRangeException("bucket");
+                }
+
+                return bucket == LatencyBuckets - 1 ? Double::PositiveInfinity : Math::Pow(2, bucket) * 1e-6;
+            }
+
+            virtual String^ ToString() override
+            {
+                // Only the buckets in use, as "< bound: count"
+                Text::StringBuilder^ latency = gcnew Text::StringBuilder();
+                for (int i = 0; i < LatencyBuckets; i++)
+                {
+                    if (RecvLatency[i] != 0)
+                    {
+                        latency->AppendFormat("{0}< {1} s: {2}", latency->Length == 0 ? "" : ", ", LatencyBucketUpperBoundSeconds(i), RecvLatency[i]);
+                    }
+                }
+
+                return String::Format("RecvCalls: {0}, Samples: {1}, Bytes: {2}, Fragments: {3}, Overflows: {4}, " +
+                    "Timeouts: {5}, LateCommands: {6}, OtherErrors: {7}, RecvLatency: [{8}]",
+                    gcnew cli::array<Object^> {RecvCalls, Samples, Bytes, Fragments, Overflows, Timeouts,
+                    LateCommands, OtherErrors, latency});
+            }
+
+        internal:
+            void Set(const Native::RxCounterValues& values)
+            {
+                RecvCalls = values.recvCalls;
+                Samples = values.samples;
+                Bytes = values.bytes;
+                Fragments = values.fragments;
+                Overflows = values.overflows;
+                Timeouts = values.timeouts;
+                LateCommands = values.lateCommands;
+                OtherErrors = values.otherErrors;
+
+                for (int i = 0; i < LatencyBuckets; i++)
+                {
+                    RecvLatency[i] = values.latency[i];
+                }
+            }
+    };
+}}}}
\ No newline at end of file
@@ -0,0 +1,24 @@
+#pragma once
+
+#include "TimeSpec.h"
+#include "TuneResult.h"
+
+using namespace System;
+
+namespace Microsoft { namespace Spectrum { namespace Devices { namespace Usrp {
+
+    // What MultiUsrp::schedule_rx_tune set up: the tune happens at TuneTime on the device clock, the capture
+    // starts at StreamTime, once the LO settled
+    public ref class ScheduledTune
+    {
+        public:
+            TuneResult^ Result;
+            TimeSpec^ TuneTime;
+            TimeSpec^ StreamTime;
+
+            virtual String^ ToString() override
+            {
+                return String::Format("TuneTime: {0}, StreamTime: {1}, Result: {2}", TuneTime, StreamTime, Result);
+            }
+    };
+}}}}
\ No newline at end of file
@@ -0,0 +1,354 @@
+// SignalGenerator.cpp
+
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+#include <emmintrin.h>
+#include <uhd/exception.hpp>
+#include "SignalGenerator.h"
+
+namespace Microsoft { namespace Spectrum { namespace Devices { namespace Usrp { namespace Native {
+
+    static const double Pi = 3.14159265358979323846;
+
+    // Samples generated per pass: the scratch stays in the cache and the tone phasors, which are rotated in
+    // single precision, are set up again from the double precision phase before they drift
+    static const size_t ChunkSamples = 1024;
+
+    // The DC spike varies by up to this many dB around its level with the tuned frequency
+    static const double DcSpikeSpreadDb = 3;
+
+    // Emitter states are looked up this fraction of a sample late, so a sample right at a change falls on the same
+    // side of it whatever time the call started at
+    static const double StateNudge = 1e-6;
+
+    // splitmix64, the random source of everything that's a function of time
+    static unsigned long long Hash(unsigned long long x)
+    {
+        x += 0x9E3779B97F4A7C15ULL;
+        x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+
+        return x ^ (x >> 31);
+    }
+
+    // In [0, 1)
+    static double HashUniform(unsigned long long seed, unsigned long long salt, long long index)
+    {
+        return (Hash(seed ^ Hash(salt ^ Hash(static_cast<unsigned long long>(index)))) >> 11) * (1.0 / 9007199254740992.0);
+    }
+
+    // Whether e is on at time t and at which frequency, until is when that changes next
+    static bool EmitterAt(const Emitter& e, unsigned long long seed, size_t index, double t, double& freq, double& until)
+    {
+        freq = e.freq;
+
+        if (e.kind == Emitter::Tone)
+        {
+            until = std::numeric_limits<double>::infinity();
+            return true;
+        }
+
+        double slot = std::floor(t / e.period);
+        double start = slot * e.period;
+
+        if (e.kind == Emitter::Pulsed)
+        {
+            double off = start + (e.duty * e.period);
+            until = t < off ? off : start + e.period;
+
+            return t < off;
+        }
+
+        until = start + e.period;
+        double u = HashUniform(seed, index, static_cast<long long>(slot));
+
+        if (e.kind == Emitter::Bursty)
+        {
+            return u < e.duty;
+        }
+
+        freq = e.freq + (std::min(static_cast<unsigned>(u * e.channels), e.channels - 1) * e.spacing);
+        return true;
+    }
+
+    // xorshift32 in each lane
+    static inline __m128i NextLanes(__m128i x)
+    {
+        x = _mm_xor_si128(x, _mm_slli_epi32(x, 13));
+        x = _mm_xor_si128(x, _mm_srli_epi32(x, 17));
+
+        return _mm_xor_si128(x, _mm_slli_epi32(x, 5));
+    }
+
+    // The sum of 4 uniforms of 24 bits each, 4 lanes at a time
+    static inline __m128 SumOfUniforms(__m128i& x)
+    {
+        __m128 sum = _mm_setzero_ps();
+
+        for (int k = 0; k < 4; k++)
+        {
+            x = NextLanes(x);
+            sum = _mm_add_ps(sum, _mm_cvtepi32_ps(_mm_srli_epi32(x, 8)));
+        }
+
+        return sum;
+    }
+
+    // re, im = Gaussian noise of sigma per component for count samples rounded up to 4. A sum of 4 uniforms on
+    // [0, 1) has mean 2 and variance 1/3.
+    static void FillNoise(float* re, float* im, size_t count, float sigma, unsigned* lanes)
+    {
+        const __m128 mean = _mm_set1_ps(2 * 16777216.0f);
+        const __m128 scale = _mm_set1_ps(sigma * std::sqrt(3.0f) / 16777216.0f);
+        __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(lanes));
+
+        for (size_t i = 0; i < count; i += 4)
+        {
+            _mm_storeu_ps(re + i, _mm_mul_ps(_mm_sub_ps(SumOfUniforms(x), mean), scale));
+            _mm_storeu_ps(im + i, _mm_mul_ps(_mm_sub_ps(SumOfUniforms(x), mean), scale));
+        }
+
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(lanes), x);
+    }
+
+    // Adds amplitude * e^(j * 2 * pi * (cycles + n * step)) for n in [0, count). Lane k of the phasor holds sample
+    // n + k, which all advance by 4 steps per pass.
+    static void AddTone(float* re, float* im, size_t count, double amplitude, double step, double cycles)
+    {
+        float lanesRe[4];
+        float lanesIm[4];
+
+        for (int k = 0; k < 4; k++)
+        {
+            double phase = 2 * Pi * (cycles + (k * step));
+            lanesRe[k] = static_cast<float>(amplitude * std::cos(phase));
+            lanesIm[k] = static_cast<float>(amplitude * std::sin(phase));
+        }
+
+        __m128 pr = _mm_loadu_ps(lanesRe);
+        __m128 pi = _mm_loadu_ps(lanesIm);
+        const __m128 sr = _mm_set1_ps(static_cast<float>(std::cos(2 * Pi * 4 * step)));
+        const __m128 si = _mm_set1_ps(static_cast<float>(std::sin(2 * Pi * 4 * step)));
+
+        size_t i = 0;
+        for (; i + 4 <= count; i += 4)
+        {
+            _mm_storeu_ps(re + i, _mm_add_ps(_mm_loadu_ps(re + i), pr));
+            _mm_storeu_ps(im + i, _mm_add_ps(_mm_loadu_ps(im + i), pi));
+
+            __m128 nr = _mm_sub_ps(_mm_mul_ps(pr, sr), _mm_mul_ps(pi, si));
+            pi = _mm_add_ps(_mm_mul_ps(pr, si), _mm_mul_ps(pi, sr));
+            pr = nr;
+        }
+
+        _mm_storeu_ps(lanesRe, pr);
+        _mm_storeu_ps(lanesIm, pi);
+
+        for (int k = 0; i < count; i++, k++)
+        {
+            re[i] += lanesRe[k];
+            im[i] += lanesIm[k];
+        }
+    }
+
+    // out = re + j * im, 4 samples per pass
+    static void Interleave(const float* re, const float* im, size_t count, std::complex<float>* out)
+    {
+        float* dst = reinterpret_cast<float*>(out);
+        size_t i = 0;
+
+        for (; i + 4 <= count; i += 4)
+        {
+            __m128 r = _mm_loadu_ps(re + i);
+            __m128 q = _mm_loadu_ps(im + i);
+
+            _mm_storeu_ps(dst + (2 * i), _mm_unpacklo_ps(r, q));
+            _mm_storeu_ps(dst + (2 * i) + 4, _mm_unpackhi_ps(r, q));
+        }
+
+        for (; i < count; i++)
+        {
+            out[i] = std::complex<float>(re[i], im[i]);
+        }
+    }
+
+    static std::vector<double> ParseFields(const std::string& key, const std::string& entry, size_t count)
+    {
+        std::vector<double> fields;
+        std::istringstream in(entry);
+        std::string field;
+
+        try
+        {
+            while (std::getline(in, field, ':'))
+            {
+                fields.push_back(std::stod(field));
+            }
+        }
+        catch (const std::exception&)
+        {
+            fields.clear();
+        }
+
+        if (fields.size() != count)
+        {
+            throw uhd::value_error("The " + key + " entry " + entry + " does not have " + std::to_string(count) + " numeric fields");
+        }
+
+        return fields;
+    }
+
+    static void ParseEmitters(const uhd::device_addr_t& args, const std::string& key, Emitter::Kind kind, size_t fieldCount, std::vector<Emitter>& emitters)
+    {
+        if (!args.has_key(key))
+        {
+            return;
+        }
+
+        std::istringstream in(args[key]);
+        std::string entry;
+
+        while (std::getline(in, entry, ';'))
+        {
+            std::vector<double> fields = ParseFields(key, entry, fieldCount);
+
+            Emitter e;
+            e.kind = kind;
+            e.freq = fields[0];
+            e.level = fields[1];
+            e.period = fieldCount > 2 ? fields[2] : 0;
+            e.duty = kind == Emitter::Pulsed || kind == Emitter::Bursty ? fields[3] : 1;
+            e.spacing = kind == Emitter::Hopper ? fields[3] : 0;
+            e.channels = kind == Emitter::Hopper ? static_cast<unsigned>(fields[4]) : 1;
+
+            if ((kind != Emitter::Tone && !(e.period > 0)) || e.duty < 0 || e.duty > 1 || e.channels < 1)
+            {
+                throw uhd::value_error("The " + key + " entry " + entry + " is out of range");
+            }
+
+            emitters.push_back(e);
+        }
+    }
+
+    void SignalConfig::Parse(const uhd::device_addr_t& args)
+    {
+        try
+        {
+            if (args.has_key("noise"))
+            {
+                noise = std::stod(args["noise"]);
+            }
+
+            if (args.has_key("dc"))
+            {
+                dc = std::stod(args["dc"]);
+            }
+
+            if (args.has_key("seed"))
+            {
+                seed = std::stoull(args["seed"]);
+            }
+        }
+        catch (const std::exception&)
+        {
+            throw uhd::value_error("The noise, dc and seed of a synthetic signal must be numbers");
+        }
+
+        ParseEmitters(args, "tones", Emitter::Tone, 2, emitters);
+        ParseEmitters(args, "pulses", Emitter::Pulsed, 4, emitters);
+        ParseEmitters(args, "bursts", Emitter::Bursty, 4, emitters);
+        ParseEmitters(args, "hoppers", Emitter::Hopper, 5, emitters);
+    }
+
+    SignalGenerator::SignalGenerator(const SignalConfig& config) : config(config), re(ChunkSamples), im(ChunkSamples)
+    {
+        for (unsigned k = 0; k < 4; k++)
+        {
+            // xorshift32 must not start at 0
+            lanes[k] = static_cast<unsigned>(Hash(config.seed + k)) | 1;
+        }
+    }
+
+    const SignalConfig& SignalGenerator::Config() const
+    {
+        return config;
+    }
+
+    std::complex<float> SignalGenerator::DcSpike(double freq) const
+    {
+        if (!(config.dc > -std::numeric_limits<double>::infinity()))
+        {
+            return 0;
+        }
+
+        long long hz = static_cast<long long>(std::floor(freq + 0.5));
+        double level = config.dc + (DcSpikeSpreadDb * ((2 * HashUniform(config.seed, 0xDC, hz)) - 1));
+        double phase = 2 * Pi * HashUniform(config.seed, 0xDC + 1, hz);
+
+        return std::polar(static_cast<float>(std::pow(10, level / 20)), static_cast<float>(phase));
+    }
+
+    void SignalGenerator::Generate(std::complex<float>* out, size_t count, double rate, double time, double freq)
+    {
+        for (size_t done = 0; done < count; done += ChunkSamples)
+        {
+            Chunk(out + done, std::min(ChunkSamples, count - done), rate, time + (done / rate), freq);
+        }
+    }
+
+    void SignalGenerator::Chunk(std::complex<float>* out, size_t count, double rate, double time, double freq)
+    {
+        if (config.noise > -std::numeric_limits<double>::infinity())
+        {
+            FillNoise(re.data(), im.data(), count, static_cast<float>(std::sqrt(std::pow(10, config.noise / 10) / 2)), lanes);
+        }
+        else
+        {
+            std::fill(re.begin(), re.begin() + count, 0.0f);
+            std::fill(im.begin(), im.begin() + count, 0.0f);
+        }
+
+        for (size_t k = 0; k < config.emitters.size(); k++)
+        {
+            const Emitter& e = config.emitters[k];
+            double amplitude = std::pow(10, e.level / 20);
+
+            // Run by run of the same state
+            for (size_t i = 0; i < count;)
+            {
+                double t = time + (i / rate);
+                double f;
+                double until;
+                bool on = EmitterAt(e, config.seed, k, time + ((i + StateNudge) / rate), f, until);
+
+                size_t end = count;
+                if (until < time + (count / rate))
+                {
+                    end = std::max(i + 1, std::min(count, static_cast<size_t>(std::ceil(((until - time) * rate) - StateNudge))));
+                }
+
+                double offset = f - freq;
+                if (on && std::abs(offset) < rate / 2)
+                {
+                    double cycles = offset * t;
+                    AddTone(re.data() + i, im.data() + i, end - i, amplitude, offset / rate, cycles - std::floor(cycles));
+                }
+
+                i = end;
+            }
+        }
+
+        std::complex<float> spike = DcSpike(freq);
+        if (spike != std::complex<float>(0))
+        {
+            for (size_t i = 0; i < count; i++)
+            {
+                re[i] += spike.real();
+                im[i] += spike.imag();
+            }
+        }
+
+        Interleave(re.data(), im.data(), count, out);
+    }
+}}}}}
\ No newline at end of file
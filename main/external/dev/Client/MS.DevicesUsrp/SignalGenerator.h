@@ -0,0 +1,97 @@
+#pragma once
+
+// Synthetic RX samples for the replay device (see ReplayUsrp.h), generated with SSE2 intrinsics.
+
+#include <complex>
+#include <limits>
+#include <vector>
+#include <uhd/types/device_addr.hpp>
+
+namespace Microsoft { namespace Spectrum { namespace Devices { namespace Usrp { namespace Native {
+
+    // A CW emitter at an absolute RF frequency, keyed on and off by one of the patterns below. Levels are in dBFS,
+    // i.e. power relative to a full scale of 1.
+    struct Emitter
+    {
+        enum Kind
+        {
+            // Always on
+            Tone,
+
+            // On for duty * period seconds at the start of every period
+            Pulsed,
+
+            // Time is split in slots of period seconds, each is on with probability duty
+            Bursty,
+
+            // Hops every period seconds to one of channels frequencies, freq + k * spacing, picked at random
+            Hopper
+        };
+
+        Kind kind;
+        double freq;
+        double level;
+        double period;
+        double duty;
+        double spacing;
+        unsigned channels;
+    };
+
+    struct SignalConfig
+    {
+        SignalConfig() : noise(-std::numeric_limits<double>::infinity()), dc(-std::numeric_limits<double>::infinity()), seed(1)
+        {
+        }
+
+        // Reads the keys below from a device address, the ones missing keep their defaults. Lists are separated by
+        // ';' and the fields of an entry by ':'.
+        //   noise      noise floor in dBFS
+        //   tones      freq:dBFS
+        //   pulses     freq:dBFS:period:duty
+        //   bursts     freq:dBFS:slot:probability
+        //   hoppers    freq:dBFS:dwell:spacing:channels
+        //   dc         DC spike in dBFS, its level (+-3 dB) and phase change with the tuned frequency like an LO
+        //              leakage does
+        //   seed       random seed of the noise, bursts and hops
+        // Throws uhd::value_error for a malformed entry.
+        void Parse(const uhd::device_addr_t& args);
+
+        double noise;
+        std::vector<Emitter> emitters;
+        double dc;
+        unsigned long long seed;
+    };
+
+    // Generates the samples a receiver tuned to a frequency would see, at any rate and from any device time.
+    // Everything but the noise is a function of the absolute time, so signals stay phase continuous and bursts
+    // and hops stay put across calls, retunes and separate generators with the same seed.
+    //
+    // The noise is a sum of 4 uniforms per component (a Gaussian to within its +-3.5 sigma tails) so it can be
+    // drawn 4 lanes at a time with integer SSE2; tones are rotated 4 samples at a time. Not thread safe, use one
+    // generator per thread.
+    class SignalGenerator
+    {
+        public:
+            explicit SignalGenerator(const SignalConfig& config);
+
+            // Fills out with count samples at rate samples per second, the first at time seconds, tuned to freq Hz
+            void Generate(std::complex<float>* out, size_t count, double rate, double time, double freq);
+
+            const SignalConfig& Config() const;
+
+            // The DC spike the configured dc leaves at freq
+            std::complex<float> DcSpike(double freq) const;
+
+        private:
+            SignalConfig config;
+
+            // 4 xorshift32 lanes
+            unsigned lanes[4];
+
+            // Planar scratch, I and Q
+            std::vector<float> re;
+            std::vector<float> im;
+
+            void Chunk(std::complex<float>* out, size_t count, double rate, double time, double freq);
+    };
+}}}}}
\ No newline at end of file
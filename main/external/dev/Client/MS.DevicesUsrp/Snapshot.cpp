@@ -0,0 +1,69 @@
+// Snapshot.cpp
+
+#include "Snapshot.h"
+
+using namespace uhd;
+using namespace uhd::usrp;
+
+namespace Microsoft { namespace Spectrum { namespace Devices { namespace Usrp { namespace Native {
+
+    void TakeSnapshot(multi_usrp& usrp, DeviceSnapshot& snapshot)
+    {
+        snapshot.ppString = usrp.get_pp_string();
+        snapshot.timeSynchronized = usrp.get_time_synchronized();
+
+        snapshot.mboards.resize(usrp.get_num_mboards());
+        for (size_t mboard = 0; mboard < snapshot.mboards.size(); mboard++)
+        {
+            MboardSnapshot& m = snapshot.mboards[mboard];
+
+            m.name = usrp.get_mboard_name(mboard);
+            m.timeSources = usrp.get_time_sources(mboard);
+            m.timeSource = usrp.get_time_source(mboard);
+            m.clockSources = usrp.get_clock_sources(mboard);
+            m.clockSource = usrp.get_clock_source(mboard);
+
+            std::vector<std::string> sensorNames = usrp.get_mboard_sensor_names(mboard);
+            for (size_t i = 0; i < sensorNames.size(); i++)
+            {
+                m.sensors.push_back(usrp.get_mboard_sensor(sensorNames[i], mboard));
+            }
+
+            m.rxSubdevSpec = usrp.get_rx_subdev_spec(mboard);
+        }
+
+        snapshot.channels.resize(usrp.get_rx_num_channels());
+        for (size_t chan = 0; chan < snapshot.channels.size(); chan++)
+        {
+            RxChannelSnapshot& c = snapshot.channels[chan];
+
+            c.subdevName = usrp.get_rx_subdev_name(chan);
+            c.rate = usrp.get_rx_rate(chan);
+            c.feFreqRange = usrp.get_fe_rx_freq_range(chan);
+            c.freqRange = usrp.get_rx_freq_range(chan);
+            c.freq = usrp.get_rx_freq(chan);
+
+            std::vector<std::string> gainNames = usrp.get_rx_gain_names(chan);
+            c.gains.resize(gainNames.size());
+            for (size_t i = 0; i < gainNames.size(); i++)
+            {
+                c.gains[i].name = gainNames[i];
+                c.gains[i].range = usrp.get_rx_gain_range(gainNames[i], chan);
+                c.gains[i].gain = usrp.get_rx_gain(gainNames[i], chan);
+            }
+
+            c.gainRange = usrp.get_rx_gain_range(chan);
+            c.gain = usrp.get_rx_gain(chan);
+            c.antennas = usrp.get_rx_antennas(chan);
+            c.antenna = usrp.get_rx_antenna(chan);
+            c.bandwidthRange = usrp.get_rx_bandwidth_range(chan);
+            c.bandwidth = usrp.get_rx_bandwidth(chan);
+
+            std::vector<std::string> sensorNames = usrp.get_rx_sensor_names(chan);
+            for (size_t i = 0; i < sensorNames.size(); i++)
+            {
+                c.sensors.push_back(usrp.get_rx_sensor(sensorNames[i], chan));
+            }
+        }
+    }
+}}}}}
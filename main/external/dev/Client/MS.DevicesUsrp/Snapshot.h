@@ -0,0 +1,60 @@
+#pragma once
+
+// Native side of MultiUsrp::snapshot: everything DumpDevice shows, gathered in one native pass so that the
+// managed side crosses into native code once and marshals the result in one go.
+
+#include <string>
+#include <vector>
+#include <uhd/types/ranges.hpp>
+#include <uhd/types/sensors.hpp>
+#include <uhd/usrp/multi_usrp.hpp>
+#include <uhd/usrp/subdev_spec.hpp>
+
+namespace Microsoft { namespace Spectrum { namespace Devices { namespace Usrp { namespace Native {
+
+    struct MboardSnapshot
+    {
+        std::string name;
+        std::vector<std::string> timeSources;
+        std::string timeSource;
+        std::vector<std::string> clockSources;
+        std::string clockSource;
+        std::vector<uhd::sensor_value_t> sensors;
+        uhd::usrp::subdev_spec_t rxSubdevSpec;
+    };
+
+    struct RxGainSnapshot
+    {
+        std::string name;
+        uhd::meta_range_t range;
+        double gain;
+    };
+
+    struct RxChannelSnapshot
+    {
+        std::string subdevName;
+        double rate;
+        uhd::meta_range_t feFreqRange;
+        uhd::meta_range_t freqRange;
+        double freq;
+        std::vector<RxGainSnapshot> gains;
+        uhd::meta_range_t gainRange;
+        double gain;
+        std::vector<std::string> antennas;
+        std::string antenna;
+        uhd::meta_range_t bandwidthRange;
+        double bandwidth;
+        std::vector<uhd::sensor_value_t> sensors;
+    };
+
+    struct DeviceSnapshot
+    {
+        std::string ppString;
+        bool timeSynchronized;
+        std::vector<MboardSnapshot> mboards;
+        std::vector<RxChannelSnapshot> channels;
+    };
+
+    // Reads every motherboard and RX channel of usrp into snapshot
+    void TakeSnapshot(uhd::usrp::multi_usrp& usrp, DeviceSnapshot& snapshot);
+}}}}}
\ No newline at end of file
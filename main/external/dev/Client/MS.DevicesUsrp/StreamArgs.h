@@ -17,11 +17,25 @@ namespace Microsoft { namespace Spectrum { namespace Devices { namespace Usrp {
             String^ CpuFormat;
             String^ OtwFormat;
             DeviceAddr^ Args;
+
+            // Channels (in the order of the RX subdevice spec) to stream, one receive buffer per channel in this
+            // order. Null streams channel 0 only.
             List<size_t>^ Channels;
 
             virtual String^ ToString() override
             {
-                return String::Format("CPU format: {0}, OTW format: {1}", CpuFormat, OtwFormat);
+                if (Channels == nullptr || Channels->Count == 0)
+                {
+                    return String::Format("CPU format: {0}, OTW format: {1}", CpuFormat, OtwFormat);
+                }
+
+                cli::array<String^>^ channels = gcnew cli::array<String^>(Channels->Count);
+                for (int i = 0; i < Channels->Count; i++)
+                {
+                    channels[i] = Channels[i].ToString();
+                }
+
+                return String::Format("CPU format: {0}, OTW format: {1}, Channels: {2}", CpuFormat, OtwFormat, String::Join(",", channels));
             }
     };
 }}}}
\ No newline at end of file
@@ -23,6 +23,19 @@ namespace Microsoft { namespace Spectrum { namespace Devices { namespace Usrp {
             UInt64 FullSeconds;
             double FractionalSeconds;
 
+            static TimeSpec^ FromSeconds(double seconds)
+            {
+                double fullSeconds = Math::Floor(seconds);
+
+                return gcnew TimeSpec(static_cast<UInt64>(fullSeconds), seconds - fullSeconds);
+            }
+
+            // Seconds as one double, loses precision below a microsecond after a few years of device time
+            property double RealSeconds
+            {
+                double get() { return FullSeconds + FractionalSeconds; }
+            }
+
             virtual String^ ToString() override
             {
                 return String::Format("FullSeconds: {0}, FractionalSeconds: {1}", 
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "Range.h"
+#include "SensorValue.h"
+#include "SubDevSpecPair.h"
+
+using namespace System;
+using namespace System::Collections::Generic;
+
+namespace Microsoft { namespace Spectrum { namespace Devices { namespace Usrp {
+
+    // One gain element of an RX channel, e.g. "PGA0"
+    public ref class RxGainSnapshot
+    {
+        public:
+            String^ Name;
+            List<Range^>^ GainRange;
+            double Gain;
+    };
+
+    public ref class MboardSnapshot
+    {
+        public:
+            String^ Name;
+            List<String^>^ TimeSources;
+            String^ TimeSource;
+            List<String^>^ ClockSources;
+            String^ ClockSource;
+            List<SensorValue^>^ Sensors;
+            List<SubDevSpecPair^>^ RxSubdevSpec;
+    };
+
+    public ref class RxChannelSnapshot
+    {
+        public:
+            String^ SubdevName;
+            double Rate;
+            List<Range^>^ FeFreqRange;
+            List<Range^>^ FreqRange;
+            double Freq;
+            List<RxGainSnapshot^>^ Gains;
+            List<Range^>^ GainRange;
+            double Gain;
+            List<String^>^ Antennas;
+            String^ Antenna;
+            List<Range^>^ BandwidthRange;
+            double Bandwidth;
+            List<SensorValue^>^ Sensors;
+    };
+
+    // What MultiUsrp::snapshot read: the motherboards, indexed by mboard, and the RX channels, indexed by chan
+    public ref class UsrpSnapshot
+    {
+        public:
+            String^ PpString;
+            bool TimeSynchronized;
+            List<MboardSnapshot^>^ Mboards;
+            List<RxChannelSnapshot^>^ RxChannels;
+    };
+}}}}
\ No newline at end of file
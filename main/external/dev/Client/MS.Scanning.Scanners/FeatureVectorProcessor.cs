@@ -18,6 +18,7 @@ namespace Microsoft.Spectrum.Scanning.Scanners
     using System.Collections.Generic;
     using System.Globalization;
     using System.Numerics;
+    using FftwInterop;
     using Microsoft.Spectrum.Common;
     using Microsoft.Spectrum.IO.ScanFile;
 
@@ -115,6 +116,27 @@ namespace Microsoft.Spectrum.Scanning.Scanners
             }
         }
 
+        /// <summary>
+        /// Same result as ProcessData(FFT of the samples), but the spectral estimator (e.g. SpectrumPipeline's window,
+        /// FFT, power and fftshift, a PolyphaseFilterBank, or a SparseSpectrum for a watch list) runs in one native call,
+        /// straight into this processor's accumulators.
+        /// </summary>
+        public void ProcessSamples(ISpectrumAccumulator estimator, ISampleBuffer samples, int sampleOffset, int instantPowerStartIndex)
+        {
+            if (estimator == null)
+            {
+                throw new ArgumentNullException("estimator");
+            }
+
+            // A SparseSpectrum produces fewer bins than an FFT, never more
+            if (estimator.FftLength > this.samplesPerFft)
+            {
+                throw new ArgumentException(string.Format(CultureInfo.InvariantCulture, "The estimator produces {0} bins but this processor expects at most {1}", estimator.FftLength, this.samplesPerFft), "estimator");
+            }
+
+            estimator.Accumulate(samples, sampleOffset, this.itemsInAverage, this.avgData, this.minData, this.maxData, instantPowerStartIndex);
+        }
+
         public void ProcessDataDCSpikeScan(Complex[] fftDataFirst, Complex[] fftDataSecond, int instantPowerStartIndex)
         {
             int fftHalfLength = fftDataFirst.Length / 2;
@@ -168,6 +190,17 @@ namespace Microsoft.Spectrum.Scanning.Scanners
             }
         }
 
+        /// <summary>
+        /// Accumulates linear power that is already in frequency order and normalized, e.g. the output of IDevice.PerformPsd
+        /// </summary>
+        public void ProcessPowerData(double[] instantPowerData, int instantPowerStartIndex)
+        {
+            for (int instantPowerIndex = 0; instantPowerIndex < instantPowerData.Length; instantPowerIndex++)
+            {
+                this.ProcessData(instantPowerData[instantPowerIndex], instantPowerStartIndex + instantPowerIndex);
+            }
+        }
+
         public void ProcessDbData(double[] instantPowerData, int instantPowerStartIndex)
         {
             for (int instantPowerIndex = 0; instantPowerIndex < instantPowerData.Length; instantPowerIndex++)
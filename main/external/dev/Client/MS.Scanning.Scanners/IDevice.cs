@@ -30,24 +30,68 @@ namespace Microsoft.Spectrum.Scanning.Scanners
 
         int SamplesPerScan { get; }
 
+        /// <summary>
+        /// Number of complex samples ReceiveSamples delivers per call. Equal to SamplesPerScan unless the
+        /// spectral estimator needs a longer capture (e.g. Welch).
+        /// </summary>
+        int SamplesPerCapture { get; }
+
+        SpectralEstimator SpectralEstimator { get; }
+
         bool RawIqDataAvailable { get; }
 
         bool SamplesAsDb { get; }
 
         string NmeaGpggaLocation { get; }
 
+        /// <summary>
+        /// The watched channels (RFSensorConfigurationEndToEnd.WatchChannelsHz) between the start and stop frequency in
+        /// increasing order, one per Fvp data point. Null if the device measures the whole band.
+        /// </summary>
+        double[] WatchedChannelsHz { get; }
+
         void ConfigureDevice(RFSensorConfigurationEndToEnd deviceConfiguration);
 
         string DumpDevice();
 
         double TuneToFrequency(double startFrequencyHz);
 
+        /// <summary>
+        /// Called once the last capture of a band was received, before it is processed, with the band the scanner tunes
+        /// to next. A device may start tuning and capturing there in the meantime. TuneToFrequency is still called for
+        /// that band, and has to tune it properly if the scheduled tune didn't happen.
+        /// </summary>
+        void ScheduleNextFrequency(double startFrequencyHz);
+
         void ReceiveSamples(double[] samples);
 
         Complex[] PerformFFT(double[] samples);
 
+        /// <summary>
+        /// Power spectrum of samples (periodogram or polyphase filter bank, per SpectralEstimator) accumulated straight
+        /// into Fvp. For the periodogram this is Fvp.ProcessData(PerformFFT(samples), instantPowerStartIndex) without
+        /// the intermediate arrays.
+        /// </summary>
+        void ProcessSamples(double[] samples, int instantPowerStartIndex);
+
+        /// <summary>
+        /// Spectrum of the centerFrequencyWidthInHz wide band around the tuned frequency, at the bin spacing of a full
+        /// size FFT over that band (a zoom FFT). Bins are window compensated and in FFTW order, like PerformFFT.
+        /// </summary>
         Complex[] PerformFFTForCenterFrequency(double[] samples, double centerFrequencyWidthInHz);
 
+        /// <summary>
+        /// Computes the power spectrum of a capture with the configured SpectralEstimator. The result has
+        /// SamplesPerScan bins, already in frequency order and normalized like FeatureVectorProcessor.ProcessData.
+        /// </summary>
+        double[] PerformPsd(double[] samples);
+
         int InstantPowerStartIndex(double currentStartFrequency);
+
+        /// <summary>
+        /// False if the device only measures a watch list of channels (RFSensorConfigurationEndToEnd.WatchChannelsHz)
+        /// and none of them is in the band starting at currentStartFrequency. Nothing in such a band goes into Fvp.
+        /// </summary>
+        bool IsBandWatched(double currentStartFrequency);
     }
 }
@@ -99,6 +99,22 @@ namespace Microsoft.Spectrum.Scanning.Scanners
             }
         }
 
+        public int SamplesPerCapture
+        {
+            get
+            {
+                return this.SamplesPerScan;
+            }
+        }
+
+        public SpectralEstimator SpectralEstimator
+        {
+            get
+            {
+                return SpectralEstimator.Periodogram;
+            }
+        }
+
         public bool RawIqDataAvailable
         {
             get 
@@ -123,6 +139,14 @@ namespace Microsoft.Spectrum.Scanning.Scanners
             }
         }
 
+        public double[] WatchedChannelsHz
+        {
+            get
+            {
+                return null;
+            }
+        }
+
         private static int MinSamplesPerScan
         {
             get { return 112; }
@@ -266,6 +290,12 @@ namespace Microsoft.Spectrum.Scanning.Scanners
             return null;
         }
 
+        public void ProcessSamples(double[] samples, int instantPowerStartIndex)
+        {
+            // This device already returns power in dB, see SamplesAsDb
+            throw new NotSupportedException("The RF Explorer does not return raw samples");
+        }
+
         public Complex[] PerformFFTForCenterFrequency(double[] samples, double centerFrequencyWidthInHz)
         {
 
@@ -273,12 +303,28 @@ namespace Microsoft.Spectrum.Scanning.Scanners
             return null;
         }
 
+        public double[] PerformPsd(double[] samples)
+        {
+            // This device doesn't return raw samples, so it doesn't need to do an FFT
+            return null;
+        }
+
         public int InstantPowerStartIndex(double currentStartFrequency)
         {
             // TODO: When we fix the fact that the scan need to be in bandwidth channels, we will need to fix this as well
             return (int)(Math.Truncate((currentStartFrequency - this.dce.CurrentStartFrequencyHz) / this.BandwidthHz) * this.dce.SamplesPerScan);
         }
 
+        public bool IsBandWatched(double currentStartFrequency)
+        {
+            return true;
+        }
+
+        public void ScheduleNextFrequency(double startFrequencyHz)
+        {
+            // Sweeps are requested one at a time, there is nothing to schedule ahead
+        }
+
         protected virtual void Dispose(bool disposing)
         {
             if (disposing)
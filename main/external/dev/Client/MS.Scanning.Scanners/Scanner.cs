@@ -57,6 +57,7 @@ namespace Microsoft.Spectrum.Scanning.Scanners
         private DateTime settingsConfigurationReadTime;
         private DateTime currentRawIqDataBlockTimeStamp;
         private ICalibrationDataSource calibrationDataSource;
+        private bool fftwWisdomLoaded;
 
         //[NOTE:] For the purpose of debugging
         //private bool displayPsdOnTime = true;
@@ -188,7 +189,7 @@ namespace Microsoft.Spectrum.Scanning.Scanners
                 }
                 else
                 {
-                    this.samples.Add(new double[ComplexWidth * this.devices[i].SamplesPerScan]);
+                    this.samples.Add(new double[ComplexWidth * this.devices[i].SamplesPerCapture]);
                 }
             }
 
@@ -269,12 +270,40 @@ namespace Microsoft.Spectrum.Scanning.Scanners
                     throw new ConfigurationErrorsException("The start frequency must be less than the stop frequency");
                 }
 
+                // A USRP that corrects its own DC offset has no spike to scan around
+                if (device.DcOffsetCalibration && device.DeviceType == DeviceType.USRP.ToString()
+                    && (ScanTypes)Enum.Parse(typeof(ScanTypes), device.ScanPattern, true) == ScanTypes.DCSpikeAdaptiveScan)
+                {
+                    device.ScanPattern = ScanTypes.StandardScan.ToString();
+
+                    this.logger.Log(TraceEventType.Information, LoggingMessageId.Scanner, "ScanPattern was set to StandardScan, DcOffsetCalibration removes the DC spike so one capture per band is enough");
+                }
+
+                // The DC spike scans work on whole FFTs, a watch list is only evaluated by StandardScan's ProcessSamples
+                bool usesDCSpikeScan = (ScanTypes)Enum.Parse(typeof(ScanTypes), device.ScanPattern, true) == ScanTypes.DCSpikeAdaptiveScan
+                    || !(this.aggregationConfiguration.OutputData || (this.rawIqConfig.OutputData && !this.rawIqConfig.OuputPSDDataInDutyCycleOffTime));
+                if (device.WatchChannelsHz != null && device.WatchChannelsHz.Count > 0 && usesDCSpikeScan)
+                {
+                    throw new ConfigurationErrorsException("WatchChannelsHz needs the StandardScan pattern with aggregated output");
+                }
+
+                // A continuously streaming USRP drops the samples taken while it retunes by their timestamp, with pipelined
+                // tuning the capture is timed to start after the LO settled
+                if ((device.ContinuousStreaming || device.PipelinedTuning) && device.NumberOfSampleBlocksToThrowAway > 0)
+                {
+                    device.NumberOfSampleBlocksToThrowAway = 0;
+
+                    this.logger.Log(TraceEventType.Information, LoggingMessageId.Scanner, "NumberOfSampleBlocksToThrowAway was set to 0, timed retunes only keep the samples received after the LO settled");
+                }
+
                 double frequencyDifference = device.CurrentStopFrequencyHz - device.CurrentStartFrequencyHz;
                 device.CurrentStopFrequencyHz = device.CurrentStartFrequencyHz + (device.BandwidthHz * Math.Truncate(frequencyDifference / device.BandwidthHz));
 
                 this.logger.Log(TraceEventType.Warning, LoggingMessageId.Scanner, string.Format(CultureInfo.InvariantCulture, "The configuration values for start and stop frequency were automatically adjusted to {0} - {1}", device.CurrentStartFrequencyHz, device.CurrentStopFrequencyHz));
             }
 
+            this.PrePlanFfts();
+
             // wait 2 seconds before tryingo to restart the file writer threads and trying to restart the RF sensors
             Thread.Sleep(2000);
 
@@ -323,6 +352,9 @@ namespace Microsoft.Spectrum.Scanning.Scanners
                 }
             }
 
+            // Any FFTW planning the devices did (FFTW_MEASURE) is kept, so the next start or reconfiguration is a lookup
+            this.SaveFftwWisdom();
+
             // Allow some time for device setup
             Thread.Sleep(1000);
 
@@ -334,6 +366,99 @@ namespace Microsoft.Spectrum.Scanning.Scanners
             ScanFileWriterManager.EndToEndConfiguration = this.endToEndConfiguration;
         }
 
+        /// <summary>
+        /// Loads the FFTW wisdom file once per process and starts planning every FFT the configured USRPs need on
+        /// a background thread, so that by the time ConfigureDevice builds its plans they are only a lookup.
+        /// </summary>
+        [System.Diagnostics.CodeAnalysis.SuppressMessage("Microsoft.Design", "CA1031:DoNotCatchGeneralExceptionTypes",
+            Justification = "A bad wisdom file only costs planning time, it must not stop the scanner")]
+        private void PrePlanFfts()
+        {
+            string wisdomFile = this.settingsConfiguration.FftwWisdomFileFullPath;
+
+            if (!this.fftwWisdomLoaded)
+            {
+                // Has to happen before anything is planned, threaded and single threaded wisdom are different
+                if (this.settingsConfiguration.FftwThreads != 1
+                    && !Fftw.EnableThreads(this.settingsConfiguration.FftwThreads, this.settingsConfiguration.FftwThreadingMinimumSize))
+                {
+                    this.logger.Log(TraceEventType.Warning, LoggingMessageId.Scanner, "Unable to initialize FFTW threads, FFTs will be single threaded");
+                }
+
+                try
+                {
+                    if (!FftwWisdom.Load(wisdomFile))
+                    {
+                        this.logger.Log(TraceEventType.Information, LoggingMessageId.Scanner, string.Format(CultureInfo.InvariantCulture, "No usable FFTW wisdom in {0}, FFTs will be planned from scratch", wisdomFile));
+                    }
+                }
+                catch (Exception ex)
+                {
+                    this.logger.Log(TraceEventType.Warning, LoggingMessageId.Scanner, string.Format(CultureInfo.InvariantCulture, "Unable to load FFTW wisdom from {0}: {1}", wisdomFile, ex.Message));
+                }
+
+                this.fftwWisdomLoaded = true;
+            }
+
+            List<FftwPlanKey> planKeys = new List<FftwPlanKey>();
+            foreach (RFSensorConfigurationEndToEnd dce in this.sensorConfig)
+            {
+                if (dce.DeviceType == DeviceType.USRP.ToString())
+                {
+                    this.CheckFftSize(dce);
+                    planKeys.AddRange(UsrpDevice.GetPlanKeys(dce));
+                }
+            }
+
+            FftwWisdom.PrePlanAsync(planKeys, wisdomFile).ContinueWith(
+                t => this.logger.Log(TraceEventType.Warning, LoggingMessageId.Scanner, string.Format(CultureInfo.InvariantCulture, "FFTW pre-planning failed: {0}", t.Exception.InnerException.Message)),
+                TaskContinuationOptions.OnlyOnFaulted);
+        }
+
+        /// <summary>
+        /// Applies the FftSizePolicy to a USRP's SamplesPerScan before anything is planned for it. A size with a large
+        /// prime factor can make every scan several times slower, the policy either warns about it or replaces it by
+        /// the nearest fast size (which changes the resolution bandwidth slightly).
+        /// </summary>
+        private void CheckFftSize(RFSensorConfigurationEndToEnd dce)
+        {
+            if (this.settingsConfiguration.FftSizePolicy == FftSizePolicy.Off)
+            {
+                return;
+            }
+
+            FftSizeAdvice advice = UsrpDevice.AdviseFftSize(dce);
+            if (advice.IsFast)
+            {
+                return;
+            }
+
+            if (this.settingsConfiguration.FftSizePolicy == FftSizePolicy.Snap)
+            {
+                dce.SamplesPerScan = advice.Size;
+
+                this.logger.Log(TraceEventType.Warning, LoggingMessageId.Scanner, string.Format(CultureInfo.InvariantCulture, "SamplesPerScan was automatically adjusted from {0} to {1}, a fast FFT size ({2})", advice.RequestedSize, advice.Size, advice));
+            }
+            else if (advice.IsSlow)
+            {
+                this.logger.Log(TraceEventType.Warning, LoggingMessageId.Scanner, string.Format(CultureInfo.InvariantCulture, "SamplesPerScan {0} is a slow FFT size, {1} would be faster ({2})", advice.RequestedSize, advice.Size, advice));
+            }
+        }
+
+        [System.Diagnostics.CodeAnalysis.SuppressMessage("Microsoft.Design", "CA1031:DoNotCatchGeneralExceptionTypes",
+            Justification = "A wisdom file that can't be written only costs planning time, it must not stop the scanner")]
+        private void SaveFftwWisdom()
+        {
+            try
+            {
+                FftwWisdom.Save(this.settingsConfiguration.FftwWisdomFileFullPath);
+            }
+            catch (Exception ex)
+            {
+                this.logger.Log(TraceEventType.Warning, LoggingMessageId.Scanner, string.Format(CultureInfo.InvariantCulture, "Unable to save FFTW wisdom to {0}: {1}", this.settingsConfiguration.FftwWisdomFileFullPath, ex.Message));
+            }
+        }
+
         private void ScanThread()
         {
             this.logger.Log(TraceEventType.Information, LoggingMessageId.ScanningStarted, "Scanner Started");
@@ -582,6 +707,14 @@ namespace Microsoft.Spectrum.Scanning.Scanners
                         break;
                     }
 
+                    // A watch list device has nothing to measure in a band without channels, only raw I/Q output still needs it
+                    bool bandWatched = device.IsBandWatched(this.currentStartFrequencies[deviceIndex]);
+                    if (!bandWatched && !this.rawIqConfig.OutputData)
+                    {
+                        this.NextFrequencies(deviceIndex);
+                        continue;
+                    }
+
                     device.TuneToFrequency(this.currentStartFrequencies[deviceIndex]);
 
                     for (int throwAwayBlocks = 0; throwAwayBlocks < this.sensorConfig[deviceIndex].NumberOfSampleBlocksToThrowAway; throwAwayBlocks++)
@@ -589,19 +722,33 @@ namespace Microsoft.Spectrum.Scanning.Scanners
                         device.ReceiveSamples(currentSamples);
                     }
 
-                    for (int j = 0; j < this.sensorConfig[deviceIndex].NumberOfSampleBlocksPerScan; j++)
+                    // A Welch capture already averages NumberOfSampleBlocksPerScan windows, so it is received only once
+                    int sampleBlocksPerScan = this.sensorConfig[deviceIndex].NumberOfSampleBlocksPerScan;
+                    if (device.SpectralEstimator == SpectralEstimator.Welch)
+                    {
+                        sampleBlocksPerScan = 1;
+                    }
+
+                    for (int j = 0; j < sampleBlocksPerScan; j++)
                     {
                         device.ReceiveSamples(currentSamples);
 
+                        // The device can tune to the next band while this one is processed
+                        if (j == sampleBlocksPerScan - 1)
+                        {
+                            device.ScheduleNextFrequency(this.NextScannedFrequency(device, deviceIndex));
+                        }
+
                         if (device.SamplesAsDb)
                         {
                             device.Fvp.ProcessDbData(currentSamples, device.InstantPowerStartIndex(this.currentStartFrequencies[deviceIndex]));
                         }
-                        else if (this.aggregationConfiguration.OutputData
-                                 || (this.rawIqConfig.OutputData
-                                     && this.rawIqConfig.OuputPSDDataInDutyCycleOffTime
-                                     && currentRawIqDataBlockTimeStamp.ToUniversalTime().Ticks >= RawIqFileWriterManager.CurrentDutyCycleOffStartTime.Ticks
-                                     && currentRawIqDataBlockTimeStamp.ToUniversalTime().Ticks < RawIqFileWriterManager.NextDutyCycleOnTimeStamp.Ticks))
+                        else if (bandWatched
+                                 && (this.aggregationConfiguration.OutputData
+                                     || (this.rawIqConfig.OutputData
+                                         && this.rawIqConfig.OuputPSDDataInDutyCycleOffTime
+                                         && currentRawIqDataBlockTimeStamp.ToUniversalTime().Ticks >= RawIqFileWriterManager.CurrentDutyCycleOffStartTime.Ticks
+                                         && currentRawIqDataBlockTimeStamp.ToUniversalTime().Ticks < RawIqFileWriterManager.NextDutyCycleOnTimeStamp.Ticks)))
                         {
                             //if (displayPsdOnTime)
                             //{
@@ -610,9 +757,14 @@ namespace Microsoft.Spectrum.Scanning.Scanners
                             //}
 
 
-                            Complex[] fftData = device.PerformFFT(currentSamples);
-
-                            device.Fvp.ProcessData(fftData, device.InstantPowerStartIndex(this.currentStartFrequencies[deviceIndex]));
+                            if (device.SpectralEstimator != SpectralEstimator.Welch)
+                            {
+                                device.ProcessSamples(currentSamples, device.InstantPowerStartIndex(this.currentStartFrequencies[deviceIndex]));
+                            }
+                            else
+                            {
+                                device.Fvp.ProcessPowerData(device.PerformPsd(currentSamples), device.InstantPowerStartIndex(this.currentStartFrequencies[deviceIndex]));
+                            }
                         }
                         //else if (this.rawIqConfig.OutputData
                         //        && this.rawIqConfig.OuputPSDDataInDutyCycleOffTime)
@@ -780,7 +932,7 @@ namespace Microsoft.Spectrum.Scanning.Scanners
                         //    item.Data.Length);
 
 
-                        ScanFileWriterManager.AddDataBlockToQueue(new SpectralPsdDataBlock(this.currentTimeStamp, this.sensorConfig[i].CurrentStartFrequencyHz, this.sensorConfig[i].CurrentStopFrequencyHz, item.ReadingKind, item.Data, i, gpsLocation));
+                        ScanFileWriterManager.AddDataBlockToQueue(new SpectralPsdDataBlock(this.currentTimeStamp, this.sensorConfig[i].CurrentStartFrequencyHz, this.sensorConfig[i].CurrentStopFrequencyHz, this.devices[i].WatchedChannelsHz, item.ReadingKind, item.Data, i, gpsLocation));
                     }
 
                     this.currentTimeStamp = roundedTimeStamp;
@@ -816,6 +968,28 @@ namespace Microsoft.Spectrum.Scanning.Scanners
             }
         }
 
+        /// <summary>
+        /// The band StandardScan tunes to after the current one, skipping the bands it skips
+        /// </summary>
+        private double NextScannedFrequency(IDevice device, int deviceIndex)
+        {
+            double current = this.currentStartFrequencies[deviceIndex];
+            double next = current;
+
+            do
+            {
+                next += this.bandwidths[deviceIndex];
+
+                if (next >= this.stopFrequencies[deviceIndex])
+                {
+                    next = this.startFrequencies[deviceIndex];
+                }
+            }
+            while (!this.rawIqConfig.OutputData && !device.IsBandWatched(next) && next != current);
+
+            return next;
+        }
+
         /// <summary>
         /// We only advance bandwidth - a configurable overlap, so that we have overlap between chunks in order to avoid gaps / seams
         /// </summary>
@@ -43,6 +43,39 @@ namespace Microsoft.Spectrum.Scanning.Scanners
             get { return (string)base["cityscapeCalibrationFile"]; }
         }
 
+        [ConfigurationProperty("fftwWisdomFile", IsRequired = false, DefaultValue = "fftwWisdom.dat")]
+        public string FftwWisdomFile
+        {
+            get { return (string)base["fftwWisdomFile"]; }
+        }
+
+        /// <summary>
+        /// Threads per FFTW plan for large FFTs, 0 means one per processor and 1 turns threading off
+        /// </summary>
+        [ConfigurationProperty("fftwThreads", IsRequired = false, DefaultValue = 0)]
+        public int FftwThreads
+        {
+            get { return (int)base["fftwThreads"]; }
+        }
+
+        /// <summary>
+        /// Smallest FFT (in samples) that is planned with FftwThreads threads
+        /// </summary>
+        [ConfigurationProperty("fftwThreadingMinimumSize", IsRequired = false, DefaultValue = 262144)]
+        public int FftwThreadingMinimumSize
+        {
+            get { return (int)base["fftwThreadingMinimumSize"]; }
+        }
+
+        /// <summary>
+        /// What to do when a USRP's SamplesPerScan is an FFT size FFTW is slow at
+        /// </summary>
+        [ConfigurationProperty("fftSizePolicy", IsRequired = false, DefaultValue = FftSizePolicy.Warn)]
+        public FftSizePolicy FftSizePolicy
+        {
+            get { return (FftSizePolicy)base["fftSizePolicy"]; }
+        }
+
         public string MeasurementStationConfigurationFileFullPath
         {
             get
@@ -58,5 +91,13 @@ namespace Microsoft.Spectrum.Scanning.Scanners
                 return Environment.ExpandEnvironmentVariables(this.SettingsDirectory) + "\\" + this.CityscapeCalibrationFile;
             }
         }
+
+        public string FftwWisdomFileFullPath
+        {
+            get
+            {
+                return Environment.ExpandEnvironmentVariables(this.SettingsDirectory) + "\\" + this.FftwWisdomFile;
+            }
+        }
     }
 }
\ No newline at end of file
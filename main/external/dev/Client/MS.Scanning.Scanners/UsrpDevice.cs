@@ -19,6 +19,8 @@ namespace Microsoft.Spectrum.Scanning.Scanners
     using System.Configuration;
     using System.Diagnostics;
     using System.Globalization;
+    using System.IO;
+    using System.Linq;
     using System.Numerics;
     using System.Text;
     using System.Threading;
@@ -27,19 +29,102 @@ namespace Microsoft.Spectrum.Scanning.Scanners
     using Microsoft.Spectrum.Common;
     using Microsoft.Spectrum.Devices.Usrp;
     using Microsoft.Spectrum.IO.MeasurementStationSettings;
+    using Microsoft.Spectrum.IO.RawIqFile;
 
     public class UsrpDevice : IDevice
     {
         private const int ComplexWidth = 2;
         private const string GpsSensorName = "gps_gpgga";
+        private const double DefaultWelchOverlapPercent = 50;
+        private const string DefaultCpuFormat = "fc64";
+
+        // sc16 samples are converted to the same full scale of +-1 as UHD's own conversion to fc32 / fc64
+        private const double Sc16FullScale = 32767;
+
+        // Samples received ahead of every capture and dropped, while the front end settles after the stream starts
+        private const int TransientSamples = 150;
+        private const int CaptureBufferCount = 2;
+
+        // How long a receive waits for a capture, and how often the receive thread checks whether it should stop
+        private const double ReceiveTimeoutSeconds = 3;
+        private const double ReceiveThreadPollSeconds = 0.1;
+
+        // Continuous streaming: the receive queue used when ReceiveQueueBlocks isn't set, how far ahead of the device
+        // time a retune is scheduled (get_time_now and the tune commands have to reach the device first) and how
+        // long the LO takes to settle after it
+        private const int DefaultStreamingQueueBlocks = 8;
+        private const double TimedTuneLeadSeconds = 0.005;
+        private const double TimedTuneSettleSeconds = 0.001;
+
+        // Samples of every DC offset / IQ balance calibration capture (DcOffsetCalibration), a few of them are taken
+        // the first time the device tunes to a frequency and gain
+        private const ulong DcCalibrationSamples = 16384;
+
+        // The LO gets LoLockPolls times TuneSleep to lock, but never less than MinimumLoLockSeconds
+        private const int LoLockPolls = 50;
+        private const double MinimumLoLockSeconds = 0.1;
+
+        // With this CommunicationsChannel the DeviceAddress is a whole UHD device address ("key=value,key=value"),
+        // e.g. "type=replay,rate=10e6,tones=915e6:-30" for the simulated device
+        private const string DeviceArgsChannel = "args";
+
+        // Key of such a device address naming a RawIQ file to replay, it is loaded here and not passed to UHD
+        private const string ReplayRawIqKey = "rawiq";
 
         private ILogger logger;
         private StreamCmd streamCmd;
         private StreamArgs streamArgs;
         private MultiUsrp usrp;
         private RxStreamer streamer;
+
+        // Receive thread mode (ReceiveQueueBlocks > 0): whether the stream command of the next capture is already
+        // out, how many more captures the scanner takes at the tuned frequency, and the losses logged so far
+        private RxReceiveThread receiveThread;
+        private bool capturePending;
+        private int capturesLeftAtFrequency;
+        private ulong loggedDroppedBlocks;
+        private ulong loggedOverflows;
+
+        // The streamer's receive counters, read into the same instance after every capture, and its transport errors
+        // (overflows, late commands and other errors, not timeouts) logged so far
+        private RxStreamerCounters streamerCounters = new RxStreamerCounters();
+        private ulong loggedTransportErrors;
+
+        // Continuous streaming (ContinuousStreaming): the device time from which samples are at the tuned frequency, and
+        // the block being taken apart across receives, with how much of it was used
+        private double streamValidFromSeconds;
+        private double streamRateHz;
+        private int streamBytesPerSample;
+        private RxBlock streamBlock;
+        private bool holdingStreamBlock;
+        private int streamBlockOffset;
+
+        // Pipelined tuning (PipelinedTuning): the band the device was tuned to ahead of TuneToFrequency, NaN if none
+        private double scheduledStartFrequencyHz = double.NaN;
         private RFSensorConfigurationEndToEnd dce;
         private Fftw fftw;
+        private Dictionary<int, ZoomFft> zoomFftByDecimation = new Dictionary<int, ZoomFft>();
+        private SampleBufferPool capturePool;
+        private ISampleBuffer currentCapture;
+        private double[] currentCaptureSamples;
+        private ISampleBuffer windowBuffer;
+        private ISampleBuffer fftBuffer;
+        private ISpectrumAccumulator spectrumAccumulator;
+        private WelchPsd welch;
+        private double[] psdData;
+        private SpectralEstimator spectralEstimator;
+
+        // Watch list mode (WatchChannelsHz): the channels in increasing order, and the sparse spectrum of every band
+        // that has channels, by the index of its first channel
+        private double[] watchChannelsHz;
+        private Dictionary<int, SparseSpectrum> watchSpectrumByChannelIndex;
+        private SamplePrecision samplePrecision;
+
+        // sc16 CPU format: the receive block for when there is no receive thread, and the scale (calibration included)
+        // the capture being received is converted with
+        private bool receivesSc16;
+        private RxBlockRing sc16Ring;
+        private double captureScale;
         private ulong gpsMboard;
         private double rxLinearGain;
 
@@ -113,6 +198,32 @@ namespace Microsoft.Spectrum.Scanning.Scanners
             }
         }
 
+        public int SamplesPerCapture
+        {
+            get
+            {
+                if (this.welch != null)
+                {
+                    return this.welch.SamplesPerCapture;
+                }
+
+                if (this.spectrumAccumulator != null)
+                {
+                    return this.spectrumAccumulator.SamplesPerBlock;
+                }
+
+                return this.SamplesPerScan;
+            }
+        }
+
+        public SpectralEstimator SpectralEstimator
+        {
+            get
+            {
+                return this.spectralEstimator;
+            }
+        }
+
         public bool RawIqDataAvailable
         {
             get
@@ -144,6 +255,14 @@ namespace Microsoft.Spectrum.Scanning.Scanners
             }
         }
 
+        public double[] WatchedChannelsHz
+        {
+            get
+            {
+                return this.watchChannelsHz;
+            }
+        }
+
         private static int MinSamplesPerScan
         {
             get { return 2; }
@@ -154,53 +273,101 @@ namespace Microsoft.Spectrum.Scanning.Scanners
             get { return 50000000; }
         }
 
+        // The scan patterns take the throw away blocks and then the blocks of one scan at every frequency
+        private int CapturesPerFrequency
+        {
+            get
+            {
+                return this.dce.NumberOfSampleBlocksToThrowAway + (this.spectralEstimator == SpectralEstimator.Welch ? 1 : this.dce.NumberOfSampleBlocksPerScan);
+            }
+        }
+
         public void Dispose()
         {
             this.Dispose(true);
             GC.SuppressFinalize(this);
         }
 
+        /// <summary>
+        /// The FFTW problems ConfigureDevice will plan for this configuration, so they can be pre-planned
+        /// (see FftwWisdom.PrePlanAsync) before the device is even created.
+        /// </summary>
+        public static IEnumerable<FftwPlanKey> GetPlanKeys(RFSensorConfigurationEndToEnd deviceConfiguration)
+        {
+            if (deviceConfiguration == null)
+            {
+                throw new ArgumentNullException("deviceConfiguration");
+            }
+
+            SamplePrecision precision = UsrpDevice.ParseSamplePrecision(deviceConfiguration.CpuFormat);
+
+            yield return Fftw.PlanKey(deviceConfiguration.SamplesPerScan, precision);
+
+            if (UsrpDevice.ParseSpectralEstimator(deviceConfiguration.SpectralEstimator) == SpectralEstimator.Welch)
+            {
+                yield return WelchPsd.PlanKey(deviceConfiguration.SamplesPerScan, Math.Max(1, deviceConfiguration.NumberOfSampleBlocksPerScan));
+            }
+        }
+
+        /// <summary>
+        /// Whether SamplesPerScan is a size FFTW is fast at for this configuration's sample precision, and if not,
+        /// the nearest size that is. Measuring plans through the plan registry, run it before ConfigureDevice.
+        /// </summary>
+        public static FftSizeAdvice AdviseFftSize(RFSensorConfigurationEndToEnd deviceConfiguration)
+        {
+            if (deviceConfiguration == null)
+            {
+                throw new ArgumentNullException("deviceConfiguration");
+            }
+
+            return FftSizeAdvisor.Advise(deviceConfiguration.SamplesPerScan, UsrpDevice.ParseSamplePrecision(deviceConfiguration.CpuFormat));
+        }
+
         public string DumpDevice()
         {
             StringBuilder sb = new StringBuilder();
 
+            // Everything is read natively in one call, the labels still name the UHD call each value comes from
+            UsrpSnapshot snapshot = this.usrp.snapshot();
+
             sb.AppendLine("DumpDevices...\r\n");
-            sb.AppendLine(this.usrp.get_pp_string());
+            sb.AppendLine(snapshot.PpString);
 
-            ulong mboardCount = this.usrp.get_num_mboards();
-            sb.AppendFormat("usrp.get_num_mboards(): {0}\r\n", mboardCount);
+            sb.AppendFormat("usrp.get_num_mboards(): {0}\r\n", snapshot.Mboards.Count);
 
-            for (ulong mboard = 0; mboard < mboardCount; mboard++)
+            for (int mboard = 0; mboard < snapshot.Mboards.Count; mboard++)
             {
-                sb.AppendFormat("usrp.get_mboard_name(mboard[{0}]): {1}\r\n", mboard, this.usrp.get_mboard_name(mboard));
+                MboardSnapshot mboardSnapshot = snapshot.Mboards[mboard];
+
+                sb.AppendFormat("usrp.get_mboard_name(mboard[{0}]): {1}\r\n", mboard, mboardSnapshot.Name);
 
                 sb.AppendFormat("usrp.get_time_sources(mboard[{0}])...\r\n", mboard);
-                foreach (string source in this.usrp.get_time_sources(mboard))
+                foreach (string source in mboardSnapshot.TimeSources)
                 {
                     sb.AppendFormat("\t{0}\r\n", source);
                 }
 
-                sb.AppendFormat("usrp.get_time_source(mboard[{0}]): {1}\r\n", mboard, this.usrp.get_time_source(mboard));
-                sb.AppendFormat("usrp.get_time_synchronized(): {0}\r\n", this.usrp.get_time_synchronized());
+                sb.AppendFormat("usrp.get_time_source(mboard[{0}]): {1}\r\n", mboard, mboardSnapshot.TimeSource);
+                sb.AppendFormat("usrp.get_time_synchronized(): {0}\r\n", snapshot.TimeSynchronized);
 
                 sb.AppendFormat("usrp.get_clock_sources(mboard[{0}])...\r\n", mboard);
-                foreach (string source in this.usrp.get_clock_sources(mboard))
+                foreach (string source in mboardSnapshot.ClockSources)
                 {
                     sb.AppendFormat("\t{0}\r\n", source);
                 }
 
-                sb.AppendFormat("usrp.get_clock_source(mboard[{0}]): {1}\r\n", mboard, this.usrp.get_clock_source(mboard));
+                sb.AppendFormat("usrp.get_clock_source(mboard[{0}]): {1}\r\n", mboard, mboardSnapshot.ClockSource);
 
                 sb.AppendFormat("usrp.get_mboard_sensor_names(mboard[{0}])...\r\n", mboard);
-                foreach (string name in this.usrp.get_mboard_sensor_names(mboard))
+                foreach (SensorValue sensor in mboardSnapshot.Sensors)
                 {
-                    sb.AppendFormat("\tName: {0}\r\n", name);
-                    sb.AppendFormat("\tusrp.get_mboard_sensor(name[{0}], mboard[{1}]): {2}\r\n", name, mboard, this.usrp.get_mboard_sensor(name, mboard));
+                    sb.AppendFormat("\tName: {0}\r\n", sensor.Name);
+                    sb.AppendFormat("\tusrp.get_mboard_sensor(name[{0}], mboard[{1}]): {2}\r\n", sensor.Name, mboard, sensor);
                 }
 
                 // Rx
                 sb.AppendFormat("usrp.get_rx_subdev_spec(mboard[{0}])...\r\n", mboard);
-                foreach (SubDevSpecPair specPair in this.usrp.get_rx_subdev_spec(mboard))
+                foreach (SubDevSpecPair specPair in mboardSnapshot.RxSubdevSpec)
                 {
                     sb.AppendFormat("\tsubdev_spec_pair_t.db_name: {0}", specPair.DaughterboardName);
                     sb.AppendFormat("\tsubdev_spec_pair_t.sd_name: {0}\r\n", specPair.SubDeviceName);
@@ -209,85 +376,71 @@ namespace Microsoft.Spectrum.Scanning.Scanners
                 sb.AppendLine();
             }
 
-            ulong channelCount = this.usrp.get_rx_num_channels();
-            sb.AppendFormat("usrp.get_rx_num_channels(): {0}\r\n", channelCount);
+            sb.AppendFormat("usrp.get_rx_num_channels(): {0}\r\n", snapshot.RxChannels.Count);
 
-            for (ulong channel = 0; channel < channelCount; channel++)
+            for (int channel = 0; channel < snapshot.RxChannels.Count; channel++)
             {
-                ////sb.AppendFormat("usrp.get_usrp_rx_info(channel[{0}])...\r\n", channel);
-                ////Dictionary<string, string> data = usrp.get_usrp_rx_info(channel);
-                ////foreach (var item in data)
-                ////{
-                ////    sb.AppendFormat("\t{0}: {1}\r\n", item.Key, item.Value);
-                ////}
-
-                sb.AppendFormat("usrp.get_rx_subdev_name(channel[{0}]): {1}\r\n", channel, this.usrp.get_rx_subdev_name(channel));
+                RxChannelSnapshot channelSnapshot = snapshot.RxChannels[channel];
 
-                ////sb.AppendFormat("usrp.get_rx_rates(channel[{0}])...\r\n", channel);
-                ////foreach (Range range in usrp.get_rx_rates(channel))
-                ////{
-                ////    sb.AppendFormat("\t{0}\r\n", range.ToString());
-                ////}
-
-                sb.AppendFormat("usrp.get_rx_rate(channel[{0}]): {1}\r\n", channel, this.usrp.get_rx_rate(channel));
+                sb.AppendFormat("usrp.get_rx_subdev_name(channel[{0}]): {1}\r\n", channel, channelSnapshot.SubdevName);
+                sb.AppendFormat("usrp.get_rx_rate(channel[{0}]): {1}\r\n", channel, channelSnapshot.Rate);
 
                 sb.AppendFormat("usrp.get_fe_rx_freq_range(channel[{0}])...\r\n", channel);
-                foreach (Range range in this.usrp.get_fe_rx_freq_range(channel))
+                foreach (Range range in channelSnapshot.FeFreqRange)
                 {
                     sb.AppendFormat("\t{0}\r\n", range.ToString());
                 }
 
                 sb.AppendFormat("usrp.get_rx_freq_range(channel[{0}])...\r\n", channel);
-                foreach (Range range in this.usrp.get_rx_freq_range(channel))
+                foreach (Range range in channelSnapshot.FreqRange)
                 {
                     sb.AppendFormat("\t{0}\r\n", range.ToString());
                 }
 
-                sb.AppendFormat("usrp.get_rx_freq(channel[{0}]): {1}\r\n", channel, this.usrp.get_rx_freq(channel));
+                sb.AppendFormat("usrp.get_rx_freq(channel[{0}]): {1}\r\n", channel, channelSnapshot.Freq);
 
                 sb.AppendFormat("usrp.get_rx_gain_names(channel[{0}])...\r\n", channel);
-                List<string> gainRangeNames = this.usrp.get_rx_gain_names(channel);
-                foreach (string name in gainRangeNames)
+                foreach (RxGainSnapshot gain in channelSnapshot.Gains)
                 {
-                    sb.AppendFormat("\tName: {0}", name);
+                    sb.AppendFormat("\tName: {0}", gain.Name);
 
-                    foreach (Range range in this.usrp.get_rx_gain_range(name, channel))
+                    foreach (Range range in gain.GainRange)
                     {
                         sb.AppendFormat("\t{0}\r\n", range);
                     }
 
-                    sb.AppendFormat("\tActual: {0}\r\n", this.usrp.get_rx_gain(name, channel));
+                    sb.AppendFormat("\tActual: {0}\r\n", gain.Gain);
                 }
 
                 sb.AppendFormat("usrp.get_rx_gain_range(channel[{0}])...\r\n", channel);
-                foreach (Range range in this.usrp.get_rx_gain_range(channel))
+                foreach (Range range in channelSnapshot.GainRange)
                 {
                     sb.AppendFormat("\tRange: {0}\r\n", range);
                 }
 
-                sb.AppendFormat("usrp.get_rx_gain(channel[{0}]): {1}\r\n", channel, this.usrp.get_rx_gain(channel));
+                sb.AppendFormat("usrp.get_rx_gain(channel[{0}]): {1}\r\n", channel, channelSnapshot.Gain);
 
                 sb.AppendFormat("usrp.get_rx_antennas(channel[{0}])...\r\n", channel);
-                foreach (string name in this.usrp.get_rx_antennas(channel))
+                foreach (string name in channelSnapshot.Antennas)
                 {
                     sb.AppendFormat("\t{0}\r\n", name);
                 }
 
-                sb.AppendFormat("usrp.get_rx_antenna(channel[{0}]): {1}\r\n", channel, this.usrp.get_rx_antenna(channel));
+                sb.AppendFormat("usrp.get_rx_antenna(channel[{0}]): {1}\r\n", channel, channelSnapshot.Antenna);
 
                 sb.AppendFormat("usrp.get_rx_bandwidth_range(channel[{0}])...\r\n", channel);
-                foreach (Range range in this.usrp.get_rx_bandwidth_range(channel))
+                foreach (Range range in channelSnapshot.BandwidthRange)
                 {
                     sb.AppendFormat("\t{0}\r\n", range.ToString());
                 }
 
-                sb.AppendFormat("usrp.get_rx_bandwidth(channel[{0}]): {1}\r\n", channel, this.usrp.get_rx_bandwidth(channel));
+                sb.AppendFormat("usrp.get_rx_bandwidth(channel[{0}]): {1}\r\n", channel, channelSnapshot.Bandwidth);
 
                 sb.AppendFormat("usrp.get_rx_sensor_names(channel[{0}])...\r\n", channel);
-                foreach (string name in this.usrp.get_rx_sensor_names(channel))
+                foreach (SensorValue sensor in channelSnapshot.Sensors)
                 {
-                    sb.AppendFormat("\tName: {0}", name);
-                    sb.AppendFormat("\tusrp.get_rx_sensor(name[{0}], channel[{1}]): {2}\r\n", name, channel, this.usrp.get_rx_sensor(name, channel));
+                    sb.AppendFormat("\tName: {0}", sensor.Name);
+                    sb.AppendFormat("\tusrp.get_rx_sensor(name[{0}], channel[{1}]): {2}\r\n", sensor.Name, channel, sensor);
                 }
             }
 
@@ -303,12 +456,57 @@ namespace Microsoft.Spectrum.Scanning.Scanners
             this.dce = deviceConfiguration;
             double frequencyBuckets = (this.dce.CurrentStopFrequencyHz - this.dce.CurrentStartFrequencyHz) / this.BandwidthHz;
 
+            this.samplePrecision = UsrpDevice.ParseSamplePrecision(this.dce.CpuFormat);
+            this.receivesSc16 = UsrpDevice.ParseCpuFormat(this.dce.CpuFormat) == "sc16";
+
             this.fftw = new Fftw();
-            this.fftw.BuildPlan1d(this.dce.SamplesPerScan);
+            this.fftw.BuildPlan1d(this.dce.SamplesPerScan, this.samplePrecision);
+            this.fftBuffer = SampleBufferPool.CreateBuffer(this.samplePrecision, this.dce.SamplesPerScan);
+            this.windowBuffer = SampleBufferPool.CreateBuffer(this.samplePrecision, this.dce.SamplesPerScan);
+
+            this.spectralEstimator = UsrpDevice.ParseSpectralEstimator(this.dce.SpectralEstimator);
+
+            bool hasWatchList = this.dce.WatchChannelsHz != null && this.dce.WatchChannelsHz.Count > 0;
+            if (hasWatchList && this.spectralEstimator != SpectralEstimator.Periodogram)
+            {
+                throw new ConfigurationErrorsException(string.Format(CultureInfo.InvariantCulture, "WatchChannelsHz can't be combined with the {0} spectral estimator", this.spectralEstimator));
+            }
+
+            if (this.spectralEstimator == SpectralEstimator.Welch)
+            {
+                double overlapPercent = this.dce.WelchOverlapPercent > 0 ? this.dce.WelchOverlapPercent : UsrpDevice.DefaultWelchOverlapPercent;
 
-            this.Fvp = new FeatureVectorProcessor((int)(frequencyBuckets * this.dce.SamplesPerScan), this.dce.SamplesPerScan);
+                // One capture per tuned frequency covers what used to be NumberOfSampleBlocksPerScan separate blocks
+                this.welch = new WelchPsd(this.SamplesPerScan, Math.Max(1, this.dce.NumberOfSampleBlocksPerScan), overlapPercent / 100);
+                this.psdData = new double[this.SamplesPerScan];
+            }
+            else if (this.spectralEstimator == SpectralEstimator.PolyphaseFilterBank)
+            {
+                int tapsPerBranch = this.dce.PolyphaseTapsPerBranch > 0 ? this.dce.PolyphaseTapsPerBranch : PolyphaseFilterBank.DefaultTapsPerBranch;
 
-            this.usrp = new MultiUsrp(new DeviceAddr() { { this.dce.CommunicationsChannel, this.dce.DeviceAddress } });
+                this.spectrumAccumulator = new PolyphaseFilterBank(this.dce.SamplesPerScan, tapsPerBranch, this.samplePrecision);
+            }
+            else if (hasWatchList)
+            {
+                this.ConfigureWatchList();
+            }
+            else
+            {
+                this.spectrumAccumulator = UsrpDevice.CreateSpectrumPipeline(this.dce.SamplesPerScan, WindowFctType_current, this.samplePrecision);
+            }
+
+            this.capturePool = new SampleBufferPool(UsrpDevice.CaptureBufferCount, this.SamplesPerCapture + UsrpDevice.TransientSamples, this.samplePrecision);
+
+            int featureCount = this.watchChannelsHz != null ? this.watchChannelsHz.Length : (int)(frequencyBuckets * this.dce.SamplesPerScan);
+            this.Fvp = new FeatureVectorProcessor(featureCount, this.dce.SamplesPerScan);
+
+            string rawIqPath;
+            this.usrp = new MultiUsrp(UsrpDevice.ParseDeviceAddr(this.dce.CommunicationsChannel, this.dce.DeviceAddress, out rawIqPath));
+
+            if (rawIqPath != null)
+            {
+                this.LoadReplayCaptures(rawIqPath);
+            }
 
             this.usrp.set_rx_bandwidth(this.BandwidthHz, 0);
             this.usrp.set_rx_rate(this.dce.BandwidthHz, 0);
@@ -333,7 +531,7 @@ namespace Microsoft.Spectrum.Scanning.Scanners
                 }
             }
 
-            this.streamArgs = new StreamArgs("fc64", "sc16");
+            this.streamArgs = new StreamArgs(UsrpDevice.ParseCpuFormat(this.dce.CpuFormat), "sc16");
             this.streamArgs.Args = new DeviceAddr();
 
             /* We are getting errors from this API occasionally, so commenting this out for now
@@ -345,11 +543,47 @@ namespace Microsoft.Spectrum.Scanning.Scanners
             */
 
             this.streamCmd = new StreamCmd(StreamMode.NumSampsAndDone);
-            this.streamCmd.NumSamps = (ulong)this.dce.SamplesPerScan;
+            this.streamCmd.NumSamps = (ulong)(this.SamplesPerCapture + UsrpDevice.TransientSamples);
             this.streamCmd.StreamNow = true;
             this.streamCmd.TimeSpec = new TimeSpec();
 
             this.streamer = this.usrp.get_rx_stream(this.streamArgs);
+
+            if (this.dce.ContinuousStreaming && this.dce.PipelinedTuning)
+            {
+                throw new ConfigurationErrorsException("ContinuousStreaming and PipelinedTuning can't be combined, continuous streaming retunes without stopping anyway");
+            }
+
+            int receiveQueueBlocks = this.dce.ReceiveQueueBlocks;
+            if ((this.dce.ContinuousStreaming || this.dce.PipelinedTuning) && receiveQueueBlocks <= 0)
+            {
+                receiveQueueBlocks = UsrpDevice.DefaultStreamingQueueBlocks;
+            }
+
+            if (this.dce.DcOffsetCalibration && receiveQueueBlocks > 0)
+            {
+                throw new ConfigurationErrorsException("DcOffsetCalibration can't be combined with ReceiveQueueBlocks, ContinuousStreaming or PipelinedTuning, the calibration receives on the scanning thread");
+            }
+
+            if (receiveQueueBlocks > 0)
+            {
+                this.receiveThread = new RxReceiveThread(this.streamer, (ulong)receiveQueueBlocks, (ulong)(this.SamplesPerCapture + UsrpDevice.TransientSamples), this.streamArgs.CpuFormat);
+                this.receiveThread.Start(UsrpDevice.ReceiveThreadPollSeconds);
+            }
+
+            if (this.receivesSc16 && this.receiveThread == null)
+            {
+                this.sc16Ring = new RxBlockRing(1, (ulong)(this.SamplesPerCapture + UsrpDevice.TransientSamples), this.streamArgs.CpuFormat);
+            }
+
+            if (this.dce.ContinuousStreaming)
+            {
+                this.streamRateHz = this.usrp.get_rx_rate(0);
+                this.streamBytesPerSample = (int)RxBlockRing.BytesPerSampleOf(this.streamArgs.CpuFormat);
+
+                this.usrp.issue_stream_cmd(UsrpDevice.CreateStreamCmd(StreamMode.StartContinuous), 0);
+            }
+
             this.rxLinearGain = MathLibrary.ToRawIQLinearGain(this.dce.Gain);
             this.cityscapeCalibrations = this.calibrationDataSource.LoadCalibrations();
         }
@@ -374,6 +608,9 @@ namespace Microsoft.Spectrum.Scanning.Scanners
         /// 
         /// Chose to iterate 50 times checking for the Local Oscillator (LO) lock, since Sleep(0) isn't a well-defined time, and we
         /// would, on occasion, not lock within 20 attempts.
+        /// 
+        /// The lock is now polled natively by MultiUsrp.wait_for_lo_lock, which yields for microseconds between polls
+        /// rather than sleeping, for up to 50 times TuneSleep.
         /// </summary>
         public double TuneToFrequency(double startFrequencyHz)
         {
@@ -382,6 +619,23 @@ namespace Microsoft.Spectrum.Scanning.Scanners
             bool tuning = true;
             int tuneAttempts = 0;
 
+            if (this.dce.ContinuousStreaming)
+            {
+                return this.RetuneStreaming(centerFreq);
+            }
+
+            // Tuned, and capturing, while the scanner processed the previous band
+            if (startFrequencyHz == this.scheduledStartFrequencyHz)
+            {
+                this.scheduledStartFrequencyHz = double.NaN;
+                this.capturesLeftAtFrequency = this.CapturesPerFrequency;
+
+                return centerFreq;
+            }
+
+            this.scheduledStartFrequencyHz = double.NaN;
+            this.DiscardQueuedCaptures();
+
             // Try tuning 10 times and if we can't then error out
             while (tuning && tuneAttempts < 10)
             {
@@ -389,24 +643,16 @@ namespace Microsoft.Spectrum.Scanning.Scanners
 
                 if (this.dce.LockingCommunicationsChannel)
                 {
-                    // Wait for the frequency to lock
-                    bool locked = false;
-                    for (int i = 0; i < 50; i++)
-                    {
-                        SensorValue val = this.usrp.get_rx_sensor("lo_locked", Channel);
-                        if (bool.Parse(val.Value))
-                        {
-                            locked = true;
-                            break;
-                        }
+                    // Wait for the frequency to lock, the sensor is polled natively
+                    double lockTimeoutSeconds = Math.Max(UsrpDevice.LoLockPolls * this.dce.TuneSleep / 1000.0, UsrpDevice.MinimumLoLockSeconds);
 
-                        // PLL Flag Poll Delay
-                        Thread.Sleep(this.dce.TuneSleep);
+                    try
+                    {
+                        this.usrp.wait_for_lo_lock(Channel, lockTimeoutSeconds);
                     }
-
-                    if (!locked)
+                    catch (TimeoutException ex)
                     {
-                        throw new InvalidOperationException("Unable to successfully get a sensor lock!");
+                        throw new InvalidOperationException("Unable to successfully get a sensor lock!", ex);
                     }
                 }
 
@@ -427,45 +673,113 @@ namespace Microsoft.Spectrum.Scanning.Scanners
                 this.logger.Log(TraceEventType.Error, LoggingMessageId.ScanningBadFrequency, string.Format(CultureInfo.InvariantCulture, "Tuning Error to {0} Hz tried {1} attempts", centerFreq, tuneAttempts));
             }
 
+            if (this.dce.DcOffsetCalibration)
+            {
+                this.ApplyRxCorrection(centerFreq);
+            }
+
+            this.capturesLeftAtFrequency = this.CapturesPerFrequency;
+
             return centerFreq;
         }
 
+        /// <summary>
+        /// Applies the DC offset and IQ balance correction of the tuned frequency and gain, measuring it the first time
+        /// </summary>
+        private void ApplyRxCorrection(double centerFreq)
+        {
+            RxCorrection correction = this.usrp.apply_rx_correction(this.streamer, 0, UsrpDevice.DcCalibrationSamples, UsrpDevice.ReceiveTimeoutSeconds);
+
+            if (correction.Rejected)
+            {
+                this.logger.Log(TraceEventType.Warning, LoggingMessageId.Scanner, string.Format(CultureInfo.InvariantCulture, "Kept the previous DC offset and IQ balance at {0} Hz, the mean looks like an emitter at the center rather than LO leakage: {1}", centerFreq, correction));
+            }
+            else if (!correction.Cached)
+            {
+                this.logger.Log(TraceEventType.Information, LoggingMessageId.Scanner, string.Format(CultureInfo.InvariantCulture, "Calibrated the DC offset and IQ balance at {0} Hz: {1}", centerFreq, correction));
+            }
+        }
+
         public void ReceiveSamples(double[] samples)
         {
-            //temp buffer to store I-Q data.
-            int TransientLength = 300;  //TODO: Make this a knob.
-            double[] tempbuf = new double[samples.Length + TransientLength];
+            // The previous capture is only kept around for PerformFFT, so it can go back to the pool now
+            if (this.currentCapture != null)
+            {
+                this.capturePool.Return(this.currentCapture);
+                this.currentCapture = null;
+                this.currentCaptureSamples = null;
+            }
 
-            this.usrp.issue_stream_cmd(this.streamCmd, 0);
+            ISampleBuffer capture = this.capturePool.Take();
+            int samplesToReceive = this.SamplesPerCapture + UsrpDevice.TransientSamples;
 
-            RxMetadata md;
             int receivedSamplesCount = 0;
 
-            //Get I-Q data.
-            while (receivedSamplesCount < this.dce.SamplesPerScan)
+            // The capture goes back to the pool on any failure, the pool only holds CaptureBufferCount of them
+            try
             {
-                int samplesCount = (int)this.streamer.Receive(
-                    tempbuf, (ulong)this.dce.SamplesPerScan, UsrpDevice.ComplexWidth, out md, 3, false);
-
-                receivedSamplesCount += samplesCount;
+                // Calibration is applied by the conversion, instead of a pass of its own (AdjustSnapshotAmplitudes)
+                if (this.receivesSc16)
+                {
+                    double amplitudeAdjustment = this.cityscapeCalibrations != null ? this.FindOrMakeAmpliutdeAdjustment(this.usrp.get_rx_freq((ulong)0)) / this.rxLinearGain : 1;
+                    this.captureScale = amplitudeAdjustment / UsrpDevice.Sc16FullScale;
+                }
 
-                if (md.ErrorCode != RxErrorCode.None)
+                if (this.dce.ContinuousStreaming)
                 {
-                    string detailedError = string.Format(CultureInfo.InvariantCulture, "streamer.Receive returned error code: {0}, Number of samples passed as args {1}, Received samples from RxStreamer {2}, RxMetadata {3}, Dce Samples per scan {4}", md.ErrorCode, samples.Length, receivedSamplesCount, (md != null ? md.ToString() : "Null"), (ulong)this.dce.SamplesPerScan);
-                    throw new ScanningErrorException(detailedError);
+                    receivedSamplesCount = this.ReceiveStreamedCapture(capture, samplesToReceive);
+                }
+                else if (this.receiveThread != null)
+                {
+                    receivedSamplesCount = this.ReceiveQueuedCapture(capture, samplesToReceive);
+                }
+                else if (this.receivesSc16)
+                {
+                    receivedSamplesCount = this.ReceiveSc16Capture(capture, samplesToReceive);
+                }
+                else
+                {
+                    this.usrp.issue_stream_cmd(this.streamCmd, 0);
+
+                    RxBlockMetadata md;
+
+                    //Get I-Q data straight into the aligned native buffer, continuing wherever the last fragment ended.
+                    while (receivedSamplesCount < samplesToReceive)
+                    {
+                        int samplesCount = (int)this.streamer.Receive(
+                            capture.PointerAt(receivedSamplesCount), (ulong)(samplesToReceive - receivedSamplesCount), out md, UsrpDevice.ReceiveTimeoutSeconds, false);
+
+                        receivedSamplesCount += samplesCount;
+
+                        if (md.ErrorCode != RxErrorCode.None)
+                        {
+                            string detailedError = string.Format(CultureInfo.InvariantCulture, "streamer.Receive returned error code: {0}, Number of samples passed as args {1}, Received samples from RxStreamer {2}, RxMetadata {3}, Dce Samples per scan {4}, Streamer counters {5}", md.ErrorCode, samples.Length, receivedSamplesCount, md, (ulong)this.SamplesPerCapture, this.streamer.GetCounters());
+                            throw new ScanningErrorException(detailedError);
+                        }
+                    }
                 }
-            }
 
-            //temp buffer -> output buffer
-            Array.Copy(tempbuf, TransientLength, samples, 0, samples.Length);
+                //Adjust amplitudes using calibration info
+                if (this.cityscapeCalibrations != null && !this.receivesSc16)
+                {
+                    this.AdjustSnapshotAmplitudes(capture, this.usrp.get_rx_freq((ulong)0), this.rxLinearGain);
+                }
 
-            //Adjust amplitudes using calibration info
-            if (this.cityscapeCalibrations != null)
+                //native buffer -> output buffer, skipping the transient
+                capture.CopyTo(UsrpDevice.TransientSamples, samples);
+            }
+            catch
             {
-                this.AdjustSnapshotAmplitudes(samples, this.usrp.get_rx_freq((ulong)0), this.rxLinearGain);
+                this.capturePool.Return(capture);
+                throw;
             }
 
-            Debug.Assert(receivedSamplesCount == this.dce.SamplesPerScan, "Did not receive the expected number of samples");
+            this.currentCapture = capture;
+            this.currentCaptureSamples = samples;
+
+            Debug.Assert(receivedSamplesCount == samplesToReceive, "Did not receive the expected number of samples");
+
+            this.LogTransportErrors();
         }
 
         public Complex[] PerformFFT(double[] samples)
@@ -478,32 +792,79 @@ namespace Microsoft.Spectrum.Scanning.Scanners
             //}
 
             //Update the Window function If Necessary.
-            if (WindowFct.Length != samples.Length || WindowFctType != WindowFctType_current)
+            //A Welch capture is longer than one FFT block, the periodogram only looks at its first SamplesPerScan samples.
+            int windowLength = ComplexWidth * this.dce.SamplesPerScan;
+            if (WindowFct.Length != windowLength || WindowFctType != WindowFctType_current)
             {
                 WindowFctType = WindowFctType_current;
-                WindowFct = MathLibrary.GetWindowFunction(WindowFctType_current, samples.Length);
+                WindowFct = MathLibrary.GetWindowFunction(WindowFctType_current, windowLength);
+                this.windowBuffer.CopyFrom(WindowFct, windowLength);
+            }
+
+            // The samples normally are the capture just received, which is still in its native buffer. Anything
+            // else is copied in first.
+            if (samples == this.currentCaptureSamples)
+            {
+                this.fftBuffer.Multiply(this.currentCapture, UsrpDevice.TransientSamples, this.windowBuffer);
+            }
+            else
+            {
+                this.fftBuffer.CopyFrom(samples, windowLength);
+                this.fftBuffer.Multiply(this.fftBuffer, 0, this.windowBuffer);
             }
 
-            double[] newSamples = MathLibrary.ApplyWindowFunction(samples, WindowFct);
+            this.fftw.Execute1d(this.fftBuffer);
 
             Complex[] fftData = new Complex[this.dce.SamplesPerScan];
+            this.fftBuffer.CopyTo(fftData);
+
+            FFTAmplitudeCompensation(fftData, WindowFctType);
+
+            return fftData;
+        }
 
-            for (int i = 0; i < this.dce.SamplesPerScan; i++)
+
+        public void ProcessSamples(double[] samples, int instantPowerStartIndex)
+        {
+            ISpectrumAccumulator estimator = this.spectrumAccumulator;
+
+            if (this.watchSpectrumByChannelIndex != null)
             {
-                int index = ComplexWidth * i;
-                fftData[i] = new Complex(
-                    Convert.ToDouble(newSamples[index], CultureInfo.InvariantCulture),
-                    Convert.ToDouble(newSamples[index + 1], CultureInfo.InvariantCulture));
+                SparseSpectrum sparseSpectrum;
+                if (!this.watchSpectrumByChannelIndex.TryGetValue(instantPowerStartIndex, out sparseSpectrum))
+                {
+                    throw new ArgumentOutOfRangeException("instantPowerStartIndex", "There are no watched channels in this band, see IsBandWatched");
+                }
 
-                // double currentFreq = currentFrequencies[deviceIndex] + (i / this.config.SamplesPerScan * this.bandwidths[deviceIndex]);                
+                estimator = sparseSpectrum;
             }
 
-            this.fftw.Execute1d(fftData);
-            FFTAmplitudeCompensation(fftData, WindowFctType);
+            if (estimator == null)
+            {
+                throw new InvalidOperationException(string.Format(CultureInfo.InvariantCulture, "ProcessSamples is not supported by the {0} spectral estimator", this.spectralEstimator));
+            }
 
-            return fftData;
-        }
+            // Like PerformFFT, the capture just received is used where it already is
+            if (samples == this.currentCaptureSamples)
+            {
+                this.Fvp.ProcessSamples(estimator, this.currentCapture, UsrpDevice.TransientSamples, instantPowerStartIndex);
+            }
+            else
+            {
+                // The other capture buffer is free while currentCapture is held
+                ISampleBuffer scratch = this.capturePool.Take();
 
+                try
+                {
+                    scratch.CopyFrom(samples, Math.Min(samples.Length, ComplexWidth * estimator.SamplesPerBlock));
+                    this.Fvp.ProcessSamples(estimator, scratch, 0, instantPowerStartIndex);
+                }
+                finally
+                {
+                    this.capturePool.Return(scratch);
+                }
+            }
+        }
 
         public Complex[] PerformFFTForCenterFrequency(double[] samples, double centerFrequencyWidthInHz)
         {
@@ -512,35 +873,33 @@ namespace Microsoft.Spectrum.Scanning.Scanners
                 throw new ArgumentOutOfRangeException("centerFrequencyWidthInHz", "Center frequency width out of range");
             }
 
-            double midFrequency = this.dce.CurrentStartFrequencyHz + (this.BandwidthHz / 2);
-            double centralFrequencyEqualPartInHz = centerFrequencyWidthInHz / 2;
-
-            double startFrequency = midFrequency - centralFrequencyEqualPartInHz;
-            double endFrequency = midFrequency + centralFrequencyEqualPartInHz;
+            // Decimate as far as the requested width allows, the zoom FFT then covers at least that width
+            int decimation = Math.Max(1, (int)Math.Floor(this.BandwidthHz / centerFrequencyWidthInHz));
 
-            Func<double, int> frequencyValueIndex = (currentStartFrequency) =>
-             {
-                 return (int)(((currentStartFrequency - this.dce.CurrentStartFrequencyHz) / this.BandwidthHz) * this.dce.SamplesPerScan);
-             };
+            ZoomFft zoomFft;
+            if (!this.zoomFftByDecimation.TryGetValue(decimation, out zoomFft))
+            {
+                zoomFft = new ZoomFft(this.dce.SamplesPerScan, decimation);
+                this.zoomFftByDecimation.Add(decimation, zoomFft);
+            }
 
-            int startIndex = frequencyValueIndex(startFrequency);
-            int endIndex = frequencyValueIndex(endFrequency);
+            // The band of interest is centered on the tuned frequency, so there is no offset to mix away
+            Complex[] fftData = new Complex[zoomFft.OutputLength];
+            zoomFft.Transform(samples, 0, fftData);
 
-            Complex[] fftData = new Complex[endIndex - startIndex + 1];
+            return fftData;
+        }
 
-            for (int i = 0; i < fftData.Length; i++)
+        public double[] PerformPsd(double[] samples)
+        {
+            if (this.welch == null)
             {
-                int index = ComplexWidth * (i + startIndex);
-                fftData[i] = new Complex(
-                    Convert.ToDouble(samples[index], CultureInfo.InvariantCulture),
-                    Convert.ToDouble(samples[index + 1], CultureInfo.InvariantCulture));
-
-                //double currentFreq = currentFrequencies[deviceIndex] + (i / this.config.SamplesPerScan * this.bandwidths[deviceIndex]);                
+                throw new InvalidOperationException(string.Format(CultureInfo.InvariantCulture, "PerformPsd is not supported by the {0} spectral estimator", this.spectralEstimator));
             }
 
-            this.fftw.Execute1d(fftData);
+            this.welch.Compute(samples, this.psdData);
 
-            return fftData;
+            return this.psdData;
         }
 
         public void FFTAmplitudeCompensation(Complex[] data, MathLibrary.WindowFunctions fct)
@@ -554,10 +913,68 @@ namespace Microsoft.Spectrum.Scanning.Scanners
 
         public int InstantPowerStartIndex(double currentStartFrequency)
         {
+            // A watch list has one feature per channel, the band's features start at its first channel
+            if (this.watchChannelsHz != null)
+            {
+                int channelIndex = 0;
+                while (channelIndex < this.watchChannelsHz.Length && this.watchChannelsHz[channelIndex] < currentStartFrequency)
+                {
+                    channelIndex++;
+                }
+
+                return channelIndex;
+            }
+
             // TODO: When we fix the fact that the scan need to be in bandwidth channels, we will need to fix this as well
             return (int)(Math.Truncate((currentStartFrequency - this.dce.CurrentStartFrequencyHz) / this.BandwidthHz) * this.dce.SamplesPerScan);
         }
 
+        public bool IsBandWatched(double currentStartFrequency)
+        {
+            if (this.watchChannelsHz == null)
+            {
+                return true;
+            }
+
+            int channelIndex = this.InstantPowerStartIndex(currentStartFrequency);
+
+            return channelIndex < this.watchChannelsHz.Length && this.watchChannelsHz[channelIndex] < currentStartFrequency + this.BandwidthHz;
+        }
+
+        /// <summary>
+        /// With PipelinedTuning, tunes to startFrequencyHz at a device time just ahead and times the first capture there
+        /// to start once the LO settled, without waiting for either (see MultiUsrp.schedule_rx_tune). The receive thread
+        /// picks the capture up while the scanner processes the current band.
+        /// </summary>
+        public void ScheduleNextFrequency(double startFrequencyHz)
+        {
+            if (!this.dce.PipelinedTuning)
+            {
+                return;
+            }
+
+            // A capture requested ahead at the current frequency that the scanner didn't take
+            this.DiscardQueuedCaptures();
+
+            ScheduledTune tune = this.usrp.schedule_rx_tune(
+                startFrequencyHz + (this.BandwidthHz / 2),
+                0,
+                UsrpDevice.TimedTuneLeadSeconds,
+                UsrpDevice.TimedTuneSettleSeconds + (this.dce.AdditionalTuneDelayInMilliSecs / 1000.0),
+                (ulong)(this.SamplesPerCapture + UsrpDevice.TransientSamples));
+
+            this.capturePending = true;
+
+            double actFreqRatio = tune.Result.ActualRfFreqHz / tune.Result.TargetRfFreqHz;
+            double actDspRatio = tune.Result.ActualDspFreqHz / tune.Result.TargetDspFreqHz;
+
+            // Otherwise TuneToFrequency tunes again the usual way
+            if ((actFreqRatio > 0.9999 && actFreqRatio < 1.0001) || (actDspRatio > 0.9999 && actDspRatio < 1.0001))
+            {
+                this.scheduledStartFrequencyHz = startFrequencyHz;
+            }
+        }
+
         protected virtual void Dispose(bool disposing)
         {
             if (disposing)
@@ -567,6 +984,69 @@ namespace Microsoft.Spectrum.Scanning.Scanners
                     this.Fvp.Dispose();
                 }
 
+                if (this.welch != null)
+                {
+                    this.welch.Dispose();
+                }
+
+                if (this.fftw != null)
+                {
+                    this.fftw.Dispose();
+                }
+
+                foreach (ZoomFft zoomFft in this.zoomFftByDecimation.Values)
+                {
+                    zoomFft.Dispose();
+                }
+
+                this.zoomFftByDecimation.Clear();
+
+                if (this.spectrumAccumulator != null)
+                {
+                    this.spectrumAccumulator.Dispose();
+                }
+
+                if (this.watchSpectrumByChannelIndex != null)
+                {
+                    foreach (SparseSpectrum sparseSpectrum in this.watchSpectrumByChannelIndex.Values)
+                    {
+                        sparseSpectrum.Dispose();
+                    }
+
+                    this.watchSpectrumByChannelIndex.Clear();
+                }
+
+                if (this.fftBuffer != null)
+                {
+                    this.fftBuffer.Dispose();
+                }
+
+                if (this.windowBuffer != null)
+                {
+                    this.windowBuffer.Dispose();
+                }
+
+                if (this.capturePool != null)
+                {
+                    this.capturePool.Dispose();
+                }
+
+                if (this.sc16Ring != null)
+                {
+                    this.sc16Ring.Dispose();
+                }
+
+                if (this.usrp != null && this.dce != null && this.dce.ContinuousStreaming)
+                {
+                    this.usrp.issue_stream_cmd(UsrpDevice.CreateStreamCmd(StreamMode.StopContinuous), 0);
+                }
+
+                // Stops the thread, before the streamer it receives from goes away
+                if (this.receiveThread != null)
+                {
+                    this.receiveThread.Dispose();
+                }
+
                 if (this.streamer != null)
                 {
                     this.streamer.Dispose();
@@ -580,14 +1060,458 @@ namespace Microsoft.Spectrum.Scanning.Scanners
         }
 
 
-        private void AdjustSnapshotAmplitudes(double[] samples, double rxRxOFreqHz, double rxGain)
+        private static SpectralEstimator ParseSpectralEstimator(string spectralEstimator)
         {
-            double amplitudeAdjustment = this.FindOrMakeAmpliutdeAdjustment(rxRxOFreqHz);
+            if (string.IsNullOrEmpty(spectralEstimator))
+            {
+                return SpectralEstimator.Periodogram;
+            }
+
+            return (SpectralEstimator)Enum.Parse(typeof(SpectralEstimator), spectralEstimator, true);
+        }
+
+        private static SamplePrecision ParseSamplePrecision(string cpuFormat)
+        {
+            switch (UsrpDevice.ParseCpuFormat(cpuFormat))
+            {
+                case "fc64":
+                    return SamplePrecision.Double;
+
+                case "fc32":
+                case "sc16":
+                    if (!Fftw.SinglePrecisionAvailable)
+                    {
+                        throw new ConfigurationErrorsException(string.Format(CultureInfo.InvariantCulture, "CpuFormat {0} needs libfftw3f-3.dll next to the service, use fc64 or deploy the single precision FFTW library", cpuFormat));
+                    }
+
+                    return SamplePrecision.Single;
+
+                default:
+                    throw new ConfigurationErrorsException(string.Format(CultureInfo.InvariantCulture, "Unsupported CpuFormat {0}, expected fc64, fc32 or sc16", cpuFormat));
+            }
+        }
+
+        private static string ParseCpuFormat(string cpuFormat)
+        {
+            return string.IsNullOrEmpty(cpuFormat) ? UsrpDevice.DefaultCpuFormat : cpuFormat.ToLowerInvariant();
+        }
+
+        private static DeviceAddr ParseDeviceAddr(string channel, string address, out string rawIqPath)
+        {
+            rawIqPath = null;
+
+            if (channel != UsrpDevice.DeviceArgsChannel)
+            {
+                return new DeviceAddr() { { channel, address } };
+            }
+
+            DeviceAddr args = new DeviceAddr();
+
+            foreach (string pair in (address ?? string.Empty).Split(new char[] { ',' }, StringSplitOptions.RemoveEmptyEntries))
+            {
+                int equals = pair.IndexOf('=');
+                if (equals < 1)
+                {
+                    throw new ConfigurationErrorsException(string.Format(CultureInfo.InvariantCulture, "The device address entry \"{0}\" is not of the form key=value", pair));
+                }
+
+                string key = pair.Substring(0, equals).Trim();
+                string value = pair.Substring(equals + 1).Trim();
+
+                if (key == UsrpDevice.ReplayRawIqKey)
+                {
+                    rawIqPath = value;
+                }
+                else
+                {
+                    args[key] = value;
+                }
+            }
+
+            return args;
+        }
+
+        private static SpectrumPipeline CreateSpectrumPipeline(int samplesPerScan, MathLibrary.WindowFunctions windowFunction, SamplePrecision precision)
+        {
+            return new SpectrumPipeline(samplesPerScan, UsrpDevice.GetSampleWindow(windowFunction, samplesPerScan), MathLibrary.GetWindowCompensationFactor(windowFunction), precision);
+        }
+
+        private static double[] GetSampleWindow(MathLibrary.WindowFunctions windowFunction, int samplesPerScan)
+        {
+            // GetWindowFunction works on interleaved I/Q, so every other value is the factor of one complex sample
+            double[] interleavedWindow = MathLibrary.GetWindowFunction(windowFunction, ComplexWidth * samplesPerScan);
+            double[] window = new double[samplesPerScan];
+
+            for (int i = 0; i < samplesPerScan; i++)
+            {
+                window[i] = interleavedWindow[ComplexWidth * i];
+            }
+
+            return window;
+        }
+
+        /// <summary>
+        /// Hands every block of a RawIQ file to the replay device, each is served while it's tuned near the block's
+        /// center frequency.
+        /// </summary>
+        private void LoadReplayCaptures(string rawIqPath)
+        {
+            if (!this.usrp.is_replay)
+            {
+                throw new ConfigurationErrorsException(string.Format(CultureInfo.InvariantCulture, "{0} can only be used with type=replay", UsrpDevice.ReplayRawIqKey));
+            }
+
+            RawIqFile file;
+            using (FileStream stream = File.OpenRead(rawIqPath))
+            using (RawIqFileReader reader = new RawIqFileReader(stream))
+            {
+                file = reader.Read();
+            }
+
+            foreach (SpectralIqDataBlock block in file.SpectralIqData)
+            {
+                this.usrp.add_replay_capture(block.CenterFrequencyHz, block.DataPoints);
+            }
+
+            this.logger.Log(TraceEventType.Information, LoggingMessageId.Scanner, string.Format(CultureInfo.InvariantCulture, "Replaying {0} blocks of {1}", file.SpectralIqData.Count, rawIqPath));
+        }
+
+        /// <summary>
+        /// Receives an sc16 capture into the native receive block and converts it into the capture buffer.
+        /// </summary>
+        private int ReceiveSc16Capture(ISampleBuffer capture, int samplesToReceive)
+        {
+            this.usrp.issue_stream_cmd(this.streamCmd, 0);
+            this.streamer.ReceiveBlock(this.sc16Ring, UsrpDevice.ReceiveTimeoutSeconds);
+
+            RxBlock block;
+            this.sc16Ring.TryGetBlock(out block);
+
+            try
+            {
+                if (block.Metadata.ErrorCode != RxErrorCode.None || (int)block.SampleCount != samplesToReceive)
+                {
+                    string detailedError = string.Format(CultureInfo.InvariantCulture, "streamer.ReceiveBlock returned error code: {0}, Received samples {1}, Expected samples {2}, RxMetadata {3}, Streamer counters {4}", block.Metadata.ErrorCode, block.SampleCount, samplesToReceive, block.Metadata, this.streamer.GetCounters());
+                    throw new ScanningErrorException(detailedError);
+                }
+
+                this.CopyToCapture(capture, block.Samples, 0, samplesToReceive);
+            }
+            finally
+            {
+                this.sc16Ring.Release(block);
+            }
+
+            return samplesToReceive;
+        }
+
+        /// <summary>
+        /// Copies received samples into the capture, converting sc16 with captureScale on the way
+        /// </summary>
+        private void CopyToCapture(ISampleBuffer capture, IntPtr samples, int destinationOffset, int count)
+        {
+            if (this.receivesSc16)
+            {
+                capture.ConvertFromSc16(samples, destinationOffset, count, this.captureScale);
+            }
+            else
+            {
+                capture.CopyFrom(samples, destinationOffset, count);
+            }
+        }
+
+        /// <summary>
+        /// Takes the next capture from the receive thread. While the scanner processes it the device already captures
+        /// the one after, if the scanner takes more at this frequency, so receiving overlaps processing.
+        /// </summary>
+        private int ReceiveQueuedCapture(ISampleBuffer capture, int samplesToReceive)
+        {
+            if (!this.capturePending)
+            {
+                this.usrp.issue_stream_cmd(this.streamCmd, 0);
+            }
+
+            this.capturePending = false;
+
+            RxBlock block;
+            if (!this.receiveThread.TryGetBlock(out block, UsrpDevice.ReceiveTimeoutSeconds))
+            {
+                throw new ScanningErrorException(string.Format(CultureInfo.InvariantCulture, "No capture arrived from the receive thread within {0} seconds", UsrpDevice.ReceiveTimeoutSeconds));
+            }
+
+            try
+            {
+                if (block.Metadata.ErrorCode != RxErrorCode.None || (int)block.SampleCount != samplesToReceive)
+                {
+                    string detailedError = string.Format(CultureInfo.InvariantCulture, "The receive thread returned error code: {0}, Received samples {1}, Expected samples {2}, RxMetadata {3}", block.Metadata.ErrorCode, block.SampleCount, samplesToReceive, block.Metadata);
+                    throw new ScanningErrorException(detailedError);
+                }
+
+                this.CopyToCapture(capture, block.Samples, 0, samplesToReceive);
+
+                // The look-ahead request is inside the try, so the block is released even if it throws
+                if (--this.capturesLeftAtFrequency > 0)
+                {
+                    this.usrp.issue_stream_cmd(this.streamCmd, 0);
+                    this.capturePending = true;
+                }
+            }
+            finally
+            {
+                this.receiveThread.Release(block);
+            }
+
+            this.LogReceiveLosses();
+
+            return samplesToReceive;
+        }
+
+        /// <summary>
+        /// Drops whatever the receive thread still has from the previous frequency, waiting for a capture that was
+        /// requested ahead but not taken.
+        /// </summary>
+        private void DiscardQueuedCaptures()
+        {
+            if (this.receiveThread == null)
+            {
+                return;
+            }
+
+            if (this.capturePending)
+            {
+                RxBlock block;
+                if (this.receiveThread.TryGetBlock(out block, UsrpDevice.ReceiveTimeoutSeconds))
+                {
+                    this.receiveThread.Release(block);
+                }
+
+                this.capturePending = false;
+            }
+
+            this.receiveThread.Clear();
+        }
+
+        /// <summary>
+        /// Continuous streaming retune: the tune is scheduled a little ahead on the device clock, and everything received
+        /// before it and the LO settle time after it is dropped by its timestamp in ReceiveStreamedCapture. Front ends
+        /// that can't time their LO tune retune right away, which only moves the tune earlier than the samples dropped.
+        /// </summary>
+        private double RetuneStreaming(double centerFreq)
+        {
+            const ulong Channel = 0;
+            const ulong Mboard = 0;
+
+            // Whatever is queued or held is from the previous frequency
+            this.ReleaseStreamBlock();
+            this.receiveThread.Clear();
+
+            double tuneSeconds = this.usrp.get_time_now(Mboard).RealSeconds + UsrpDevice.TimedTuneLeadSeconds;
+
+            TuneResult result;
+            this.usrp.set_command_time(TimeSpec.FromSeconds(tuneSeconds), Mboard);
+            try
+            {
+                result = this.usrp.set_rx_freq(centerFreq, Channel);
+            }
+            finally
+            {
+                this.usrp.clear_command_time(Mboard);
+            }
+
+            this.streamValidFromSeconds = tuneSeconds + UsrpDevice.TimedTuneSettleSeconds + (this.dce.AdditionalTuneDelayInMilliSecs / 1000.0);
+
+            double actFreqRatio = result.ActualRfFreqHz / result.TargetRfFreqHz;
+            double actDspRatio = result.ActualDspFreqHz / result.TargetDspFreqHz;
 
-            for (int i = 0; i < samples.Length; i++)
+            if (!(actFreqRatio > 0.9999 && actFreqRatio < 1.0001) && !(actDspRatio > 0.9999 && actDspRatio < 1.0001))
             {
-                samples[i] *= amplitudeAdjustment / rxGain;
+                this.logger.Log(TraceEventType.Error, LoggingMessageId.ScanningBadFrequency, string.Format(CultureInfo.InvariantCulture, "Timed tuning to {0} Hz ended at {1} Hz", centerFreq, result.ActualRfFreqHz));
             }
+
+            return centerFreq;
+        }
+
+        /// <summary>
+        /// Assembles a capture from the continuous stream: samples from before streamValidFromSeconds are skipped, and a
+        /// gap in the timestamps (an overflow, or blocks the thread dropped) starts the capture over, so every capture is
+        /// contiguous and at the tuned frequency. What is left of the last block is kept for the next receive.
+        /// </summary>
+        private int ReceiveStreamedCapture(ISampleBuffer capture, int samplesToReceive)
+        {
+            int filled = 0;
+            double expectedSeconds = 0;
+
+            while (filled < samplesToReceive)
+            {
+                if (!this.holdingStreamBlock)
+                {
+                    if (!this.receiveThread.TryGetBlock(out this.streamBlock, UsrpDevice.ReceiveTimeoutSeconds))
+                    {
+                        throw new ScanningErrorException(string.Format(CultureInfo.InvariantCulture, "No samples arrived from the receive thread within {0} seconds", UsrpDevice.ReceiveTimeoutSeconds));
+                    }
+
+                    this.holdingStreamBlock = true;
+                    this.streamBlockOffset = 0;
+
+                    // An overflow only shows as a gap in the timestamps
+                    RxErrorCode errorCode = this.streamBlock.Metadata.ErrorCode;
+                    if (errorCode == RxErrorCode.Overflow && this.streamBlock.SampleCount == 0)
+                    {
+                        this.ReleaseStreamBlock();
+                        continue;
+                    }
+
+                    if ((errorCode != RxErrorCode.None && errorCode != RxErrorCode.Overflow) || !this.streamBlock.Metadata.HasTimeSpec)
+                    {
+                        string detailedError = string.Format(CultureInfo.InvariantCulture, "The receive thread returned error code: {0}, RxMetadata {1}", errorCode, this.streamBlock.Metadata);
+
+                        this.ReleaseStreamBlock();
+                        throw new ScanningErrorException(detailedError);
+                    }
+                }
+
+                RxBlockMetadata md = this.streamBlock.Metadata;
+                int blockSamples = (int)this.streamBlock.SampleCount;
+                double blockSeconds = md.FullSeconds + md.FractionalSeconds;
+                int offset = this.streamBlockOffset;
+
+                // Samples from before the retune settled
+                double offsetSeconds = blockSeconds + (offset / this.streamRateHz);
+                if (offsetSeconds < this.streamValidFromSeconds)
+                {
+                    offset = (int)Math.Min(blockSamples, Math.Ceiling((this.streamValidFromSeconds - blockSeconds) * this.streamRateHz));
+                    offsetSeconds = blockSeconds + (offset / this.streamRateHz);
+                }
+
+                // Less than half a sample off is the same sample
+                if (filled > 0 && Math.Abs(offsetSeconds - expectedSeconds) * this.streamRateHz > 0.5)
+                {
+                    filled = 0;
+                }
+
+                int count = Math.Min(blockSamples - offset, samplesToReceive - filled);
+                if (count > 0)
+                {
+                    this.CopyToCapture(capture, IntPtr.Add(this.streamBlock.Samples, offset * this.streamBytesPerSample), filled, count);
+
+                    filled += count;
+                    offset += count;
+                    expectedSeconds = blockSeconds + (offset / this.streamRateHz);
+                }
+
+                if (offset >= blockSamples)
+                {
+                    this.ReleaseStreamBlock();
+                }
+                else
+                {
+                    this.streamBlockOffset = offset;
+                }
+            }
+
+            this.LogReceiveLosses();
+
+            return samplesToReceive;
+        }
+
+        private void ReleaseStreamBlock()
+        {
+            if (this.holdingStreamBlock)
+            {
+                this.receiveThread.Release(this.streamBlock);
+                this.holdingStreamBlock = false;
+            }
+        }
+
+        private static StreamCmd CreateStreamCmd(StreamMode mode)
+        {
+            StreamCmd streamCmd = new StreamCmd(mode);
+            streamCmd.StreamNow = true;
+            streamCmd.TimeSpec = new TimeSpec();
+
+            return streamCmd;
+        }
+
+        private void LogReceiveLosses()
+        {
+            // Streaming continuously, the thread dropping what arrives while the scanner is busy is expected
+            ulong droppedBlocks = this.dce.ContinuousStreaming ? this.loggedDroppedBlocks : this.receiveThread.DroppedBlocks;
+            ulong overflows = this.receiveThread.Overflows;
+
+            if (droppedBlocks != this.loggedDroppedBlocks || overflows != this.loggedOverflows)
+            {
+                this.logger.Log(TraceEventType.Warning, LoggingMessageId.ScanningError, string.Format(CultureInfo.InvariantCulture, "The receive thread dropped {0} captures the scanner was too slow for and the device reported {1} overflows so far", droppedBlocks, overflows));
+
+                this.loggedDroppedBlocks = droppedBlocks;
+                this.loggedOverflows = overflows;
+            }
+        }
+
+        /// <summary>
+        /// Warns when the streamer counted transport errors since the last capture, with all its counters, so a saturated
+        /// transport shows before receives start failing. Timeouts aren't errors here, the receive thread times out
+        /// whenever nothing is streaming.
+        /// </summary>
+        private void LogTransportErrors()
+        {
+            this.streamer.GetCounters(this.streamerCounters);
+
+            ulong transportErrors = this.streamerCounters.Overflows + this.streamerCounters.LateCommands + this.streamerCounters.OtherErrors;
+            if (transportErrors != this.loggedTransportErrors)
+            {
+                this.logger.Log(TraceEventType.Warning, LoggingMessageId.ScanningError, string.Format(CultureInfo.InvariantCulture, "The streamer counted {0} transport errors so far: {1}", transportErrors, this.streamerCounters));
+
+                this.loggedTransportErrors = transportErrors;
+            }
+        }
+
+        /// <summary>
+        /// Sets up a SparseSpectrum (Goertzel at the channel frequencies) for every band that has watched channels.
+        /// Channels are evaluated at their exact frequency, relative to the band's tuned center frequency.
+        /// </summary>
+        [System.Diagnostics.CodeAnalysis.SuppressMessage("Microsoft.Reliability", "CA2000:Dispose objects before losing scope",
+            Justification = "The sparse spectra are disposed with the device")]
+        private void ConfigureWatchList()
+        {
+            double startHz = this.dce.CurrentStartFrequencyHz;
+            double stopHz = this.dce.CurrentStopFrequencyHz;
+
+            this.watchChannelsHz = this.dce.WatchChannelsHz.Where(f => f >= startHz && f < stopHz).Distinct().OrderBy(f => f).ToArray();
+            if (this.watchChannelsHz.Length == 0)
+            {
+                throw new ConfigurationErrorsException(string.Format(CultureInfo.InvariantCulture, "None of the WatchChannelsHz are between {0} and {1} Hz", startHz, stopHz));
+            }
+
+            double[] window = UsrpDevice.GetSampleWindow(WindowFctType_current, this.dce.SamplesPerScan);
+            double compensation = MathLibrary.GetWindowCompensationFactor(WindowFctType_current);
+
+            this.watchSpectrumByChannelIndex = new Dictionary<int, SparseSpectrum>();
+
+            int first = 0;
+            while (first < this.watchChannelsHz.Length)
+            {
+                double bandStartHz = startHz + (Math.Truncate((this.watchChannelsHz[first] - startHz) / this.BandwidthHz) * this.BandwidthHz);
+                double centerHz = bandStartHz + (this.BandwidthHz / 2);
+
+                List<double> normalizedFrequencies = new List<double>();
+                int next = first;
+                while (next < this.watchChannelsHz.Length && this.watchChannelsHz[next] < bandStartHz + this.BandwidthHz)
+                {
+                    // The sample rate is BandwidthHz, see set_rx_rate
+                    normalizedFrequencies.Add((this.watchChannelsHz[next] - centerHz) / this.dce.BandwidthHz);
+                    next++;
+                }
+
+                this.watchSpectrumByChannelIndex.Add(first, new SparseSpectrum(this.dce.SamplesPerScan, window, compensation, normalizedFrequencies.ToArray(), this.samplePrecision));
+                first = next;
+            }
+        }
+
+        private void AdjustSnapshotAmplitudes(ISampleBuffer samples, double rxRxOFreqHz, double rxGain)
+        {
+            double amplitudeAdjustment = this.FindOrMakeAmpliutdeAdjustment(rxRxOFreqHz);
+
+            samples.Scale(amplitudeAdjustment / rxGain);
         }
 
         private double FindOrMakeAmpliutdeAdjustment(double rxFrequencyHz)
@@ -0,0 +1,30 @@
+﻿// Copyright (c) Microsoft Corporation
+//
+// All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in compliance 
+// with the License.  You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0 
+//
+// THIS CODE IS PROVIDED ON AN *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, EITHER
+// EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE,
+// FITNESS FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+//
+// See the Apache Version 2.0 License for specific language governing permissions and limitations under the License.
+
+namespace Microsoft.Spectrum.Common
+{
+    /// <summary>
+    /// How a USRP turns the I/Q samples captured at one tuned frequency into a power spectrum.
+    /// </summary>
+    public enum SpectralEstimator
+    {
+        // One Hann windowed FFT per sample block (the original behavior)
+        Periodogram,
+
+        // One long capture per tuned frequency, averaged over NumberOfSampleBlocksPerScan overlapping windows
+        Welch,
+
+        // Polyphase filter bank channelizer, PolyphaseTapsPerBranch FFTs worth of samples per block
+        PolyphaseFilterBank
+    }
+}
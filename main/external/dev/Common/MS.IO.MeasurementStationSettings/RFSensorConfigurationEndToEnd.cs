@@ -28,6 +28,7 @@ namespace Microsoft.Spectrum.IO.MeasurementStationSettings
             this.Cables = new List<CableConfiguration>();
             this.Connectors = new List<ConnectorConfiguration>();
             this.Antennas = new List<AntennaConfiguration>();
+            this.WatchChannelsHz = new List<double>();
         }
 
         [ProtoMember(1)]
@@ -69,6 +70,11 @@ namespace Microsoft.Spectrum.IO.MeasurementStationSettings
         [ProtoMember(13)]
         public string ScanPattern { get; set; }      
 
+        /// <summary>
+        /// For USRP devices the UHD device address key DeviceAddress is the value of (e.g. "addr"), or "args" for a whole
+        /// device address in DeviceAddress, e.g. "type=replay,rate=10e6,rawiq=capture.dsor" to replay a RawIQ file
+        /// without hardware
+        /// </summary>
         [ProtoMember(14)]
         public string CommunicationsChannel { get; set; }            
 
@@ -95,5 +101,71 @@ namespace Microsoft.Spectrum.IO.MeasurementStationSettings
         
         [ProtoMember(22)]
         public int AdditionalTuneDelayInMilliSecs { get; set; }  
+
+        /// <summary>
+        /// Name of a Microsoft.Spectrum.Common.SpectralEstimator value, empty means Periodogram
+        /// </summary>
+        [ProtoMember(23)]
+        public string SpectralEstimator { get; set; }
+
+        /// <summary>
+        /// Overlap between consecutive Welch windows in percent of a window, values &lt;= 0 mean 50
+        /// </summary>
+        [ProtoMember(24)]
+        public double WelchOverlapPercent { get; set; }
+
+        /// <summary>
+        /// UHD host sample format for USRP devices: "fc64" (double precision, fftw_), "fc32" (single precision, fftwf_) or "sc16"
+        /// (16 bit integers as sent over the wire, converted to single precision on the host), empty means fc64
+        /// </summary>
+        [ProtoMember(25)]
+        public string CpuFormat { get; set; }
+
+        /// <summary>
+        /// Prototype filter length of the PolyphaseFilterBank estimator in FFTs, values &lt;= 0 mean 4
+        /// </summary>
+        [ProtoMember(26)]
+        public int PolyphaseTapsPerBranch { get; set; }
+
+        /// <summary>
+        /// Center frequencies of the channels a watch list station measures. When not empty only these frequencies are
+        /// evaluated (Goertzel, see FftwInterop.SparseSpectrum), and the feature vectors hold one value per channel in
+        /// increasing frequency order instead of the whole spectrum
+        /// </summary>
+        [ProtoMember(27)]
+        public List<double> WatchChannelsHz { get; set; }
+
+        /// <summary>
+        /// Captures a USRP's receive thread can queue ahead of processing, 0 receives on the scanning thread instead
+        /// </summary>
+        [ProtoMember(28)]
+        public int ReceiveQueueBlocks { get; set; }
+
+        /// <summary>
+        /// Keeps a USRP streaming continuously and hops with timed tune commands, dropping the samples received while
+        /// the LO settles by their timestamp instead of throwing away whole blocks
+        /// </summary>
+        [ProtoMember(29)]
+        public bool ContinuousStreaming { get; set; }
+
+        /// <summary>
+        /// Has a USRP tune to the next band with timed commands, and capture there, while the scanner is still
+        /// processing the current band
+        /// </summary>
+        [ProtoMember(30)]
+        public bool PipelinedTuning { get; set; }
+
+        /// <summary>
+        /// Has a USRP null its DC spike and IQ image with the front end's DC offset and IQ balance corrections, measured
+        /// once per frequency and gain and cached, so a DCSpikeAdaptiveScan station scans with a single capture per band
+        /// (StandardScan). Calibrating receives on the scanning thread, so it can't be combined with ReceiveQueueBlocks,
+        /// ContinuousStreaming or PipelinedTuning.
+        /// The DC offset is measured as the mean of the antenna samples, so an emitter right at a tuned center frequency
+        /// is measured along with it. A correction that would remove more than -25 dBFS is rejected and logged, and
+        /// corrections are measured again after 10 minutes, but a weaker emitter there during a calibration is removed
+        /// from that band until then
+        /// </summary>
+        [ProtoMember(31)]
+        public bool DcOffsetCalibration { get; set; }
     }
 }
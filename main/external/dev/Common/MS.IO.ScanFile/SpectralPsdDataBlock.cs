@@ -29,10 +29,21 @@ namespace Microsoft.Spectrum.IO.ScanFile
         private short[] outputDataPoints;
 
         public SpectralPsdDataBlock(DateTime timestamp, double startFrequencyHz, double stopFrequencyHz, ReadingKind readingKind, FixedShort[] dataPoints, int deviceId, string nmeaGpggaLocation)
+            : this(timestamp, startFrequencyHz, stopFrequencyHz, null, readingKind, dataPoints, deviceId, nmeaGpggaLocation)
         {
+        }
+
+        public SpectralPsdDataBlock(DateTime timestamp, double startFrequencyHz, double stopFrequencyHz, double[] frequenciesHz, ReadingKind readingKind, FixedShort[] dataPoints, int deviceId, string nmeaGpggaLocation)
+        {
+            if (frequenciesHz != null && frequenciesHz.Length != dataPoints.Length)
+            {
+                throw new ArgumentException("There has to be one frequency per data point", "frequenciesHz");
+            }
+
             this.Timestamp = timestamp;
             this.StartFrequencyHz = startFrequencyHz;
             this.StopFrequencyHz = stopFrequencyHz;
+            this.FrequenciesHz = frequenciesHz;
             this.ReadingKind = readingKind;            
             this.DataPoints = dataPoints;
             this.DeviceId = deviceId;
@@ -80,6 +91,15 @@ namespace Microsoft.Spectrum.IO.ScanFile
             }
         }
 
+        /// <summary>
+        /// The frequency of every data point, for a block that only covers some channels of the band (a watch list).
+        /// Null if the data points are evenly spaced from StartFrequencyHz to StopFrequencyHz.
+        /// </summary>
+        [System.Diagnostics.CodeAnalysis.SuppressMessage("Microsoft.Performance", "CA1819:PropertiesShouldNotReturnArrays",
+            Justification = "Performance is important")]
+        [ProtoMember(6, IsPacked = true)]
+        public double[] FrequenciesHz { get; set; }
+
         [ProtoMember(8)]
         public string NmeaGpggaLocation { get; private set; }
         
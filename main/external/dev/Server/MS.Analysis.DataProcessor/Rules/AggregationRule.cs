@@ -15,6 +15,7 @@ namespace Microsoft.Spectrum.Analysis.DataProcessor.Rules
 {
     using System;
     using System.Collections.Generic;
+    using System.Globalization;
     using System.Linq;
     using System.Threading.Tasks;
     using Microsoft.Spectrum.Common;
@@ -68,7 +69,8 @@ namespace Microsoft.Spectrum.Analysis.DataProcessor.Rules
             SpectrumCalibration spectrumMeasurement = new SpectrumCalibration(measurementStationKey, timeRangeKind, timeStart);
 
             // In case, multiple spectral blocks per sample with different frequency range group them by frequency and process.
-            var spectralDataByFrequencyRange = aggregatedRawSpectralData.GroupBy(spectralData => new { StartFrequency = spectralData.StartFrequencyHz, StopFrequency = spectralData.StopFrequencyHz });
+            // Blocks of a watch list carry their channel frequencies, which are part of the range.
+            var spectralDataByFrequencyRange = aggregatedRawSpectralData.GroupBy(spectralData => new { StartFrequency = spectralData.StartFrequencyHz, StopFrequency = spectralData.StopFrequencyHz, Channels = AggregationRule.GetChannelsKey(spectralData.FrequenciesHz) });
 
             if (spectralDataByFrequencyRange.Any())
             {
@@ -80,7 +82,7 @@ namespace Microsoft.Spectrum.Analysis.DataProcessor.Rules
                     // Should we expect same data points length for all the SPBs ?
                     int dataPointsCount = spectralDataByFrequency.Select(spectralData => spectralData.DataPoints.Length).Only();
 
-                    double[] frequencyDivisions = MathLibrary.GetLinearSpace(startFrequency, stopFrequency, dataPointsCount).ToArray();
+                    double[] frequencyDivisions = spectralDataByFrequency.First().FrequenciesHz ?? MathLibrary.GetLinearSpace(startFrequency, stopFrequency, dataPointsCount).ToArray();
 
                     // Resolve SpectralDataBlock samples into an array and then use them in further iteration.
                     var spectralDataByReadingKind = spectralDataByFrequency.GroupBy(spectralData => spectralData.ReadingKind)
@@ -157,5 +159,16 @@ namespace Microsoft.Spectrum.Analysis.DataProcessor.Rules
 
             return spectrumMeasurement;
         }
+
+        // Null for evenly spaced data points, otherwise the channel frequencies as text so equal lists compare equal
+        private static string GetChannelsKey(double[] frequenciesHz)
+        {
+            if (frequenciesHz == null)
+            {
+                return null;
+            }
+
+            return string.Join(",", frequenciesHz.Select(frequency => frequency.ToString("R", CultureInfo.InvariantCulture)));
+        }
     }
 }